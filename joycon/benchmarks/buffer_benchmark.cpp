@@ -0,0 +1,117 @@
+#include "benchmark/benchmark.h"
+
+#include "buffer.h"
+
+namespace {
+
+InputBuffer reply_report() {
+	InputBuffer buff_in;
+	buff_in.data()[0] = 0x21;
+	buff_in.data()[13] = 0x90;
+	buff_in.data()[14] = 0x10;
+	return buff_in;
+}
+
+InputBuffer standard_report() {
+	InputBuffer buff_in;
+	buff_in.data()[0] = 0x30;
+	return buff_in;
+}
+
+} // namespace
+
+/* ------ INPUTBUFFER ------ */
+
+// check_ID(byte)
+static void BM_InputBuffer_get_ACK(benchmark::State& state) {
+	InputBuffer buff_in = reply_report();
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(buff_in.get_ACK());
+	}
+}
+BENCHMARK(BM_InputBuffer_get_ACK);
+
+static void BM_InputBuffer_get_reply_data(benchmark::State& state) {
+	InputBuffer buff_in = reply_report();
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(buff_in.get_reply_data(5, 0x1D));
+	}
+}
+BENCHMARK(BM_InputBuffer_get_reply_data);
+
+// check_ID(initializer_list)
+static void BM_InputBuffer_get_AxisData(benchmark::State& state) {
+	InputBuffer buff_in = standard_report();
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(buff_in.get_AxisData());
+	}
+}
+BENCHMARK(BM_InputBuffer_get_AxisData);
+
+// check_ID failing: throws
+static void BM_InputBuffer_check_ID_mismatch(benchmark::State& state) {
+	InputBuffer buff_in = standard_report();
+	for (auto _ : state) {
+		try {
+			benchmark::DoNotOptimize(buff_in.get_ACK());
+		} catch (std::exception&) {
+		}
+	}
+}
+BENCHMARK(BM_InputBuffer_check_ID_mismatch);
+
+static void BM_InputBuffer_clean(benchmark::State& state) {
+	InputBuffer buff_in = standard_report();
+	for (auto _ : state) {
+		buff_in.clean();
+		benchmark::ClobberMemory();
+	}
+}
+BENCHMARK(BM_InputBuffer_clean);
+
+/* ------ OUTPUTBUFFER ------ */
+
+static void BM_OutputBuffer_construct(benchmark::State& state) {
+	for (auto _ : state) {
+		OutputBuffer buff_out(state.range(0));
+		benchmark::DoNotOptimize(buff_out.data());
+	}
+}
+BENCHMARK(BM_OutputBuffer_construct)->Arg(0)->Arg(38)->Arg(351);
+
+// everything send_command() sets
+static void BM_OutputBuffer_set(benchmark::State& state) {
+	const ByteVector data(state.range(0), 0x42);
+	const Rumble rumble(320.0, 0.5);
+	for (auto _ : state) {
+		OutputBuffer buff_out(data.size());
+		buff_out.set_cmd(0x01);
+		buff_out.set_GP(0x05);
+		buff_out.set_subcmd(0x10);
+		buff_out.set_data(data);
+		buff_out.set_rumble_left(rumble);
+		buff_out.set_rumble_right(rumble);
+		benchmark::DoNotOptimize(buff_out.data());
+	}
+}
+BENCHMARK(BM_OutputBuffer_set)->Arg(1)->Arg(5)->Arg(38);
+
+/* ------ PRETTY PRINTING ------ */
+
+static void BM_InputBuffer_format(benchmark::State& state) {
+	InputBuffer buff_in = standard_report();
+	char text[InputBuffer::FORMAT_SIZE];
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(buff_in.format(text, sizeof(text)));
+	}
+}
+BENCHMARK(BM_InputBuffer_format);
+
+static void BM_OutputBuffer_format(benchmark::State& state) {
+	OutputBuffer buff_out(5);
+	char text[OutputBuffer::FORMAT_SIZE];
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(buff_out.format(text, sizeof(text)));
+	}
+}
+BENCHMARK(BM_OutputBuffer_format);
@@ -0,0 +1,27 @@
+#include "benchmark/benchmark.h"
+
+#include "homelight.h"
+
+static void BM_HOME_LIGHT_set_mini_cycle(benchmark::State& state) {
+	HOME_LIGHT light;
+	unsigned char idx = 1;
+	for (auto _ : state) {
+		light.set_mini_cycle(idx, 0xF, 0x8, 0x2);
+		benchmark::DoNotOptimize(light.data().data());
+		idx = idx < 15 ? idx + 1 : 1;
+	}
+}
+BENCHMARK(BM_HOME_LIGHT_set_mini_cycle);
+
+// a full 15 step pattern
+static void BM_HOME_LIGHT_pattern(benchmark::State& state) {
+	for (auto _ : state) {
+		HOME_LIGHT light;
+		light.set_header(15, 0xF, 0xF, 0);
+		for (unsigned char idx = 1; idx <= 15; ++idx) {
+			light.set_mini_cycle(idx, idx, 0x4, 0x2);
+		}
+		benchmark::DoNotOptimize(light.data().data());
+	}
+}
+BENCHMARK(BM_HOME_LIGHT_pattern);
@@ -0,0 +1,52 @@
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "imufusion.h"
+
+namespace {
+
+// 0x30 report with three samples: slightly tilted, turning
+StandardReport moving_report() {
+	StandardReport report{};
+	report.ID = 0x30;
+	report.IMU_samples = 3;
+	for (auto& sample : report.IMU) {
+		sample.accel[0] = 300;
+		sample.accel[1] = -200;
+		sample.accel[2] = 4000;
+		sample.gyro[0] = 150;
+		sample.gyro[1] = -80;
+		sample.gyro[2] = 40;
+	}
+	return report;
+}
+
+} // namespace
+
+// what the reader of one Joycon adds per report: 3 samples of one filter.
+// 16 controllers send ~1070 reports/s together: at well under 1us per report the fusion needs < 0.1% of a core.
+static void BM_FusionBank_update(benchmark::State& state) {
+	FusionBank bank(1);
+	const StandardReport report = moving_report();
+	for (auto _ : state) {
+		bank.update(0, report);
+		benchmark::DoNotOptimize(bank.orientation(0));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FusionBank_update);
+
+// one report of every device at once, vectorized across the filters
+static void BM_FusionBank_update_batch(benchmark::State& state) {
+	const std::size_t filters = static_cast<std::size_t>(state.range(0));
+	FusionBank bank(filters);
+	const StandardReport report = moving_report();
+	std::vector<const StandardReport*> reports(filters, &report);
+	for (auto _ : state) {
+		bank.update(reports.data());
+		benchmark::DoNotOptimize(bank.orientation(0));
+	}
+	state.SetItemsProcessed(state.iterations() * filters);
+}
+BENCHMARK(BM_FusionBank_update_batch)->Arg(4)->Arg(16);
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <streambuf>
+
+#include "benchmark/benchmark.h"
+
+#include "joycon.h"
+#include "log.h"
+
+namespace {
+
+// formats everything Joycon logs, but writes nothing
+class NullBuffer : public std::streambuf {
+protected:
+	int_type overflow(int_type c) override { return c; }
+	std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+class ScriptedJoycon {
+public:
+	ScriptedJoycon() {
+		Logger::set_sink(&null_stream);
+		ScriptedTransport::add_device({ JOYCON_L_BT, L"98:B6:E9:00:00:01", "scripted/0" });
+		joycon.reset(new Joycon(JOYCON_L_BT, const_cast<wchar_t*>(L"98:B6:E9:00:00:01"), "scripted/0"));
+	}
+	~ScriptedJoycon() {
+		joycon.reset();
+		ScriptedTransport::remove_devices();
+		Logger::flush();
+		Logger::set_sink(&std::clog);
+	}
+
+	Joycon& operator*() { return *joycon; }
+
+private:
+	NullBuffer null;
+	std::ostream null_stream{ &null };
+	std::unique_ptr<Joycon> joycon;
+};
+
+} // namespace
+
+// write, reply of the (in memory) device, matching, decoding and logging of one subcommand
+static void BM_Joycon_send_command(benchmark::State& state) {
+	ScriptedJoycon joycon;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize((*joycon).send_command(0x01, 0x30, { 0x01 }));
+	}
+}
+BENCHMARK(BM_Joycon_send_command);
+
+// SPI read: 5 byte echo in the reply
+static void BM_Joycon_SPI_flash_read(benchmark::State& state) {
+	ScriptedJoycon joycon;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize((*joycon).SPI_flash_read(0x6020, 0x18));
+	}
+}
+BENCHMARK(BM_Joycon_SPI_flash_read);
+
+// decode_report() of a 0x30 report, as the reader does for every input report
+static void BM_decode_report(benchmark::State& state) {
+	InputBuffer buff_in;
+	buff_in.data()[0] = 0x30;
+	buff_in.data()[2] = 0x8E;
+	StandardReport report;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(decode_report(buff_in, JOYCON_L_BT, report));
+	}
+}
+BENCHMARK(BM_decode_report);
+
+// latest state of a device (Joycon::state()) taken by a consumer, no store in between
+static void BM_SeqLock_load(benchmark::State& state) {
+	SeqLock<StandardReport> latest;
+	latest.store(StandardReport{});
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(latest.load());
+	}
+}
+BENCHMARK(BM_SeqLock_load);
+
+#ifdef __linux__
+// events of a report for the virtual gamepad: a moving stick and a button, the work before its write()
+static void BM_EvdevMapper_map(benchmark::State& state) {
+	EvdevMapper mapper;
+	std::array<input_event, EvdevMapper::MAX_EVENTS> events;
+	uint16_t stick[2] = { 0x800, 0x800 };
+	uint32_t buttons = 0;
+	for (auto _ : state) {
+		stick[0] = static_cast<uint16_t>((stick[0] + 1) & 0xFFF);
+		buttons ^= BUTTON_A;
+		benchmark::DoNotOptimize(mapper.map(buttons, RIGHT_BUTTONS, nullptr, stick, events.data()));
+	}
+}
+BENCHMARK(BM_EvdevMapper_map);
+#endif
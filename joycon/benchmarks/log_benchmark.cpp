@@ -0,0 +1,53 @@
+#include <iostream>
+#include <streambuf>
+
+#include "benchmark/benchmark.h"
+
+#include "buffer.h"
+#include "log.h"
+
+namespace {
+
+class NullBuffer : public std::streambuf {
+protected:
+	int_type overflow(int_type c) override { return c; }
+	std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+} // namespace
+
+// a trace line in the reader while tracing is off
+static void BM_LOG_disabled(benchmark::State& state) {
+	InputBuffer buff_in;
+	Logger::set_level(LOG_DEBUG);
+	for (auto _ : state) {
+		LOG(LOG_TRACE) << "report: " << buff_in;
+	}
+}
+BENCHMARK(BM_LOG_disabled);
+
+// cost of a report trace line for the reader (the writer thread is paused out)
+static void BM_LOG_report(benchmark::State& state) {
+	NullBuffer null;
+	std::ostream null_stream(&null);
+	Logger::set_sink(&null_stream);
+	Logger::set_level(LOG_TRACE);
+
+	InputBuffer buff_in;
+	std::size_t lines = 0;
+	for (auto _ : state) {
+		LOG(LOG_TRACE) << "report: " << buff_in;
+
+		// empty the ring before it overflows, dropped lines would be cheaper
+		if (++lines % 64 == 0) {
+			state.PauseTiming();
+			Logger::flush();
+			state.ResumeTiming();
+		}
+	}
+
+	Logger::flush();
+	Logger::set_level(LOG_DEBUG);
+	Logger::set_sink(&std::clog);
+}
+BENCHMARK(BM_LOG_report);
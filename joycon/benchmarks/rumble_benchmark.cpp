@@ -0,0 +1,47 @@
+#include "benchmark/benchmark.h"
+
+#include "rumble.h"
+
+// pack(): checked encoding of the constructor
+static void BM_Rumble_pack(benchmark::State& state) {
+	double frequency = 40.875885;
+	for (auto _ : state) {
+		Rumble rumble(frequency, 0.5);
+		benchmark::DoNotOptimize(rumble.getByte());
+		frequency = frequency < 1200.0 ? frequency * 1.01 : 40.875885;
+	}
+}
+BENCHMARK(BM_Rumble_pack);
+
+// unpack(): decoding of the constructor
+static void BM_Rumble_unpack(benchmark::State& state) {
+	const ByteArray<4> data = Rumble(320.0, 0.5).getByte();
+	for (auto _ : state) {
+		Rumble rumble(data);
+		benchmark::DoNotOptimize(rumble.getFreqeuncy());
+	}
+}
+BENCHMARK(BM_Rumble_unpack);
+
+static void BM_Rumble_encode(benchmark::State& state) {
+	double frequency = 40.875885;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(Rumble::encode(frequency, 0.5));
+		frequency = frequency < 1200.0 ? frequency * 1.01 : 40.875885;
+	}
+}
+BENCHMARK(BM_Rumble_encode);
+
+static void BM_Rumble_encode_batch(benchmark::State& state) {
+	std::vector<RumbleSample> in(state.range(0));
+	for (std::size_t i = 0; i < in.size(); ++i) {
+		in[i] = { 40.875885 + i % 1200, (i % 100) / 100.0 };
+	}
+	std::vector<ByteArray<4>> out(in.size());
+	for (auto _ : state) {
+		Rumble::encode(in.data(), in.size(), out.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * in.size());
+}
+BENCHMARK(BM_Rumble_encode_batch)->Arg(64)->Arg(1024);
@@ -0,0 +1,44 @@
+#include "benchmark/benchmark.h"
+
+#include "types.h"
+
+namespace {
+
+ByteVector bytes(std::size_t size) {
+	ByteVector res(size);
+	for (std::size_t i = 0; i < size; ++i) {
+		res[i] = static_cast<byte>(i * 37);
+	}
+	return res;
+}
+
+} // namespace
+
+static void BM_to_int(benchmark::State& state) {
+	const ByteVector data = bytes(state.range(0));
+	const bool big_endian = state.range(1) != 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(to_int(data, big_endian));
+	}
+}
+BENCHMARK(BM_to_int)->Args({ 2, 1 })->Args({ 4, 0 })->Args({ 4, 1 })->Args({ 8, 0 });
+
+static void BM_to_byte_container(benchmark::State& state) {
+	ByteVector data(state.range(0));
+	const bool big_endian = state.range(1) != 0;
+	for (auto _ : state) {
+		to_byte_container(0x6020, data, big_endian);
+		benchmark::DoNotOptimize(data.data());
+	}
+}
+BENCHMARK(BM_to_byte_container)->Args({ 2, 1 })->Args({ 4, 0 })->Args({ 4, 1 })->Args({ 8, 0 });
+
+// e.g. a full 0x21 report in the log output of send_command()
+static void BM_to_hex_string(benchmark::State& state) {
+	const ByteVector data = bytes(state.range(0));
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(to_hex_string(data, "", " "));
+	}
+	state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_to_hex_string)->Arg(1)->Arg(12)->Arg(49)->Arg(362);
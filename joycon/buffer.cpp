@@ -2,14 +2,80 @@
 #include <sstream>
 #include <algorithm>
 #include <limits>
+#include <stdexcept>
 
 #include "buffer.h"
 #include "rumble.h"
 
+namespace {
+
+// appends to a fixed char buffer, drops what does not fit
+class Formatter {
+public:
+	Formatter(char* out, std::size_t size) : begin(out), pos(out), end(out + size) {}
+
+	template <std::size_t N>
+	Formatter& text(const char (&str)[N]) {
+		std::size_t n = std::min<std::size_t>(N - 1, end - pos);
+		pos = std::copy_n(str, n, pos);
+		return *this;
+	}
+
+	// bytes separated by spaces
+	Formatter& hex(const byte* data, std::size_t length) {
+		length = std::min(length, static_cast<std::size_t>(end - pos + 1) / 3);
+		pos = hex_encode(data, data + length, pos, " ", 1);
+		return *this;
+	}
+
+	std::size_t size() const { return pos - begin; }
+
+private:
+	char* begin;
+	char* pos;
+	char* end;
+};
+
+} // namespace
+
+constexpr std::size_t InputBuffer::FORMAT_SIZE;
+constexpr std::size_t OutputBuffer::FORMAT_SIZE;
+
 /* ---- INPUT BUFFER ---- */
 
+std::size_t InputBuffer::format(char* out, std::size_t size) const {
+
+	const byte* data = buf.data();
+
+	Formatter f(out, size);
+	f.hex(data, 1).text(" | ");			// ID
+	f.hex(data + 1, 1).text(" | ");		// timing byte
+	f.hex(data + 2, 1).text(" | ");		// battery + conenction info
+	f.hex(data + 3, 3).text(" | ");		// button status
+	f.hex(data + 6, 3).text(" | ");		// left analog stick
+	f.hex(data + 9, 3).text(" | ");		// right analog stick
+	f.hex(data + 12, 1).text(" |");		// vibrator input report
+
+	if (data[0] == 0x21) {
+		f.text("| ").hex(data + 13, 1).text("|");
+		f.hex(data + 14, 1).text("|");
+		f.hex(data + 15, 35).text(" ||");
+	} else if (data[0] == 0x23) {
+		f.text("| ").hex(data + 13, 37).text(" ||");
+	} else {
+		f.text("| ").hex(data + 13, 12).text("|");
+		f.hex(data + 25, 12).text("|");
+		f.hex(data + 37, 12).text(" ||");
+		if (data[0] == 0x31 && this->enabledNFC()) {
+			f.text(" ").hex(data + 49, 313).text(" |");
+		}
+	}
+
+	return f.size();
+}
+
 void InputBuffer::clean() {
-	std::fill(buf.begin(), buf.end(), 0);
+	std::fill_n(buf.begin(), len, 0);
 }
 
 const byte& InputBuffer::get_ID() const {
@@ -21,19 +87,7 @@ const byte& InputBuffer::get_timer() const {
 }
 
 POWER InputBuffer::get_battery_level() const {
-
-	byte battery_level = buf[2] >> 4;
-	if (battery_level == 0) {
-		return POWER::EMPTY;
-	} else if (battery_level <= 2) {
-		return POWER::CRITICAL;
-	} else if (battery_level <= 4) {
-		return POWER::LOW;
-	} else if (battery_level <= 6) {
-		return POWER::MEDIUM;
-	} else {
-		return POWER::FULL;
-	}
+	return to_power(buf[2] >> 4);
 }
 
 const byte& InputBuffer::get_ACK() const {
@@ -46,7 +100,7 @@ const byte& InputBuffer::get_subcommandID_reply() const {
 	return buf[14];
 }
 
-ByteVector InputBuffer::get_reply_data(std::size_t offset, std::size_t length) const {
+ByteView InputBuffer::get_reply_data(std::size_t offset, std::size_t length) const {
 
 	this->check_ID(0x21);
 
@@ -58,7 +112,7 @@ ByteVector InputBuffer::get_reply_data(std::size_t offset, std::size_t length) c
 		throw std::out_of_range("Length is too big!");
 	}
 
-	return ByteVector(buf.begin() + 15 + offset, buf.begin() + 15 + offset + length);
+	return ByteView(buf.data() + 15 + offset, length);
 }
 
 const byte&  InputBuffer::get_reply_data_at(std::size_t idx) const {
@@ -71,22 +125,22 @@ const byte&  InputBuffer::get_reply_data_at(std::size_t idx) const {
 	return buf[15 + idx];
 }
 
-ByteVector InputBuffer::get_MCU_FW_update_report() const {
+ByteView InputBuffer::get_MCU_FW_update_report() const {
 	this->check_ID(0x23);
-	return ByteVector(buf.begin() + 13, buf.begin() + 13 + 37);
+	return ByteView(buf.data() + 13, 37);
 }
 
-ByteVector InputBuffer::get_AxisData() const {
+ByteView InputBuffer::get_AxisData() const {
 	this->check_ID({0x30, 0x31, 0x32, 0x33});
-	return ByteVector(buf.begin() + 13, buf.begin() + 13 + 36);
+	return ByteView(buf.data() + 13, 36);
 }
 
-ByteVector InputBuffer::get_NFC_IR_input_report() const {
+ByteView InputBuffer::get_NFC_IR_input_report() const {
 	this->check_ID(0x31);
 	if (!this->enabledNFC()) {
 		throw std::runtime_error("Wrong buffer size. NFC/IR require buffer of size 361.");
 	}
-	return ByteVector(buf.begin() + 49, buf.begin() + 49 + 313);
+	return ByteView(buf.data() + 49, 313);
 }
 
 void InputBuffer::check_ID(byte valid) const {
@@ -99,9 +153,9 @@ void InputBuffer::check_ID(byte valid) const {
 	}
 }
 
-void InputBuffer::check_ID(std::unordered_set<byte> valid_list) const {
+void InputBuffer::check_ID(std::initializer_list<byte> valid_list) const {
 	const byte& ID = this->get_ID();
-	if (valid_list.find(ID) == valid_list.end()) {
+	if (std::find(valid_list.begin(), valid_list.end(), ID) == valid_list.end()) {
 		std::ostringstream error;
 		error << "Wrong mode! ID should be in {";
 		std::string del = "";
@@ -116,7 +170,22 @@ void InputBuffer::check_ID(std::unordered_set<byte> valid_list) const {
 
 /* ---- OUTPUT BUFFER --- */
 
-OutputBuffer::OutputBuffer(std::size_t dataSize) : BufferBase((11 + dataSize < 11)? throw std::bad_alloc() : 11+dataSize) {
+std::size_t OutputBuffer::format(char* out, std::size_t size) const {
+
+	const byte* data = buf.data();
+
+	Formatter f(out, size);
+	f.hex(data, 1).text(" | ").hex(data + 1, 1).text(" | ");
+	f.hex(data + 2, 4).text(" | ").hex(data + 6, 4).text(" | ");
+	f.hex(data + 10, 1).text(" |");
+	if (len > 11) {
+		f.text("| ").hex(data + 11, len - 11).text(" ||");
+	}
+
+	return f.size();
+}
+
+OutputBuffer::OutputBuffer(std::size_t dataSize) : BufferBase((11 + dataSize < 11)? throw std::length_error("Buffer size overflow") : 11+dataSize) {
 
 	this->set_rumble_left(Rumble());
 	this->set_rumble_right(Rumble());
@@ -135,26 +204,28 @@ void OutputBuffer::set_subcmd(byte in) {
 }
 
 void OutputBuffer::set_rumble_left(const Rumble& rumble) {
-	buf[2] = rumble.byte_at(0);
-	buf[3] = rumble.byte_at(1);
-	buf[4] = rumble.byte_at(2);
-	buf[5] = rumble.byte_at(3);
+	this->set_rumble_left(rumble.getByte());
 }
 
 void OutputBuffer::set_rumble_right(const Rumble& rumble) {
-	buf[6] = rumble.byte_at(0);
-	buf[7] = rumble.byte_at(1);
-	buf[8] = rumble.byte_at(2);
-	buf[9] = rumble.byte_at(3);
+	this->set_rumble_right(rumble.getByte());
+}
+
+void OutputBuffer::set_rumble_left(const ByteArray<4>& data) {
+	std::copy(data.begin(), data.end(), buf.begin() + 2);
+}
+
+void OutputBuffer::set_rumble_right(const ByteArray<4>& data) {
+	std::copy(data.begin(), data.end(), buf.begin() + 6);
 }
 
-void OutputBuffer::set_data(const ByteVector& data) {
+void OutputBuffer::set_data(ByteView data) {
 
-	if (data.size() + 11 != buf.size()) {
+	if (data.size() + 11 != len) {
 		throw std::length_error("Size mismatch. Data does not fit in the OutputBuffer.");
 	}
 
-	std::copy(std::begin(data), std::end(data), std::begin(buf) + 11);
+	std::copy(data.begin(), data.end(), buf.begin() + 11);
 }
 
 
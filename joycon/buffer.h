@@ -1,23 +1,52 @@
 #pragma once
 
-#include <unordered_set>
+#include <algorithm>
+#include <initializer_list>
+#include <stdexcept>
 
 #include "rumble.h"
 #include "types.h"
 
-// only expose some functions of ByteVector to BufferBase
+// only expose some functions of the inline ByteArray to BufferBase
+// N is the capacity, size() the amount of bytes in use. Never allocates.
+template <std::size_t N>
 class BufferBase {
 public:
-	BufferBase(std::size_t size) : buf(size, 0) {}
-	BufferBase(const BufferBase& other) : buf(other.buf) {}
+	static constexpr std::size_t capacity = N;
 
-	std::size_t size() const { return buf.size(); }
-	explicit operator ByteVector() { return buf; }
+	BufferBase(std::size_t size) : len(size > N ? throw std::length_error("Buffer larger than its capacity") : size) {
+		std::fill_n(buf.begin(), len, 0);
+	}
+	BufferBase(const BufferBase& other) : len(other.len) {
+		std::copy_n(other.buf.begin(), len, buf.begin());
+	}
+	BufferBase(BufferBase&& other) noexcept : len(other.len) {
+		std::copy_n(other.buf.begin(), len, buf.begin());
+	}
+
+	BufferBase& operator=(const BufferBase& other) {
+		len = other.len;
+		std::copy_n(other.buf.begin(), len, buf.begin());
+		return *this;
+	}
+	BufferBase& operator=(BufferBase&& other) noexcept {
+		len = other.len;
+		std::copy_n(other.buf.begin(), len, buf.begin());
+		return *this;
+	}
+
+	std::size_t size() const { return len; }
+	ByteView view() const { return ByteView(buf.data(), len); }
+	explicit operator ByteVector() const { return ByteVector(buf.begin(), buf.begin() + len); }
 
 protected:
-	ByteVector buf;
+	ByteArray<N> buf;
+	std::size_t len;
 };
 
+template <std::size_t N>
+constexpr std::size_t BufferBase<N>::capacity;
+
 // ID 21:	... | 13 | 14 | 15 - 49 (SUBCMD_reply)		size 50
 // ID 23 :	... | 13 - 49 (MCU report)					size 50
 // ID 30 :	... | 13 - 48 (Axis/Gyro/Accel)				size 49
@@ -25,11 +54,11 @@ protected:
 // ID 33 :	... | 13 - 48 (Axis/Gyro/Accel)				size 49
 // ID 31 :	... | 13 - 48 (Axis/Gyro/Accel) | 49 - 361	size 362
 // --> InputBuffer size is eather 50 or 362, depending on if NFC is enabled
-class InputBuffer : public BufferBase {
+class InputBuffer : public BufferBase<362> {
 public:
 	InputBuffer(bool bEnabledNFC = false) : BufferBase(bEnabledNFC ? 362 : 50) {}
 
-	bool enabledNFC() const { return buf.size() == 362; }
+	bool enabledNFC() const { return len == 362; }
 	void clean();
 	inline byte* data() { return buf.data(); }
 	inline const byte* data() const { return buf.data(); }
@@ -55,50 +84,31 @@ public:
 	const byte& get_subcommandID_reply() const;
 
 	// ID 21
-	ByteVector get_reply_data(std::size_t offset = 0, std::size_t length = 0) const;
+	ByteView get_reply_data(std::size_t offset = 0, std::size_t length = 0) const;
 	const byte&  get_reply_data_at(std::size_t idx) const;
 
 	// ID 23
-	ByteVector get_MCU_FW_update_report() const;
+	ByteView get_MCU_FW_update_report() const;
 
 	// ID 30, 31, 32, 33
-	ByteVector get_AxisData() const;
+	ByteView get_AxisData() const;
 
 	// ID 31
-	ByteVector get_NFC_IR_input_report() const;
+	ByteView get_NFC_IR_input_report() const;
 
-	friend std::ostream& operator<<(std::ostream& os, const InputBuffer& in);
+	// The fields as hex, separated by | (as operator<<). Never allocates: writes at most size chars to out
+	// (not 0 terminated) and returns the amount. FORMAT_SIZE always fits.
+	static constexpr std::size_t FORMAT_SIZE = 1200;
+	std::size_t format(char* out, std::size_t size) const;
 
 private:
 	void check_ID(byte valid) const;
-	void check_ID(std::unordered_set<byte> valid_list) const;
+	void check_ID(std::initializer_list<byte> valid_list) const;
 };
 
 inline std::ostream& operator<<(std::ostream& os, const InputBuffer& in) {
-	os << to_hex_string(in.buf, 0, 1, "", " ") << " | ";	// ID
-	os << to_hex_string(in.buf, 1, 1, "", " ") << " | ";	// timing byte
-	os << to_hex_string(in.buf, 2, 1, "", " ") << " | ";	// battery + conenction info
-	os << to_hex_string(in.buf, 3, 3, "", " ") << " | ";	// button status
-	os << to_hex_string(in.buf, 6, 3, "", " ") << " | ";	// left analog stick
-	os << to_hex_string(in.buf, 9, 3, "", " ") << " | ";	// right analog stick
-	os << to_hex_string(in.buf, 12, 1, "", " ") << " |";	// vibrator input report
-
-	if (in.get_ID() == 0x21) {
-		os << "| " << to_hex_string(in.buf, 13, 1, "", " ") << "|";
-		os << to_hex_string(in.buf, 14, 1, "", " ") << "|";
-		os << to_hex_string(in.buf, 15, 35, "", " ") << " ||";
-	} else if (in.get_ID() == 0x23) {
-		os << "| " << to_hex_string(in.buf, 13, 37, "", " ") << " ||";
-	} else {
-		os << "| " << to_hex_string(in.buf, 13, 12, "", " ") << "|";
-		os << to_hex_string(in.buf, 25, 12, "", " ") << "|";
-		os << to_hex_string(in.buf, 37, 12, "", " ") << " ||";
-		if (in.get_ID() == 0x31 && in.enabledNFC()) {
-			os << " " << to_hex_string(in.buf, 49, 313, "", " ") << " |";
-		}
-	}
-
-	return os;
+	char text[InputBuffer::FORMAT_SIZE];
+	return os.write(text, in.format(text, sizeof(text)));
 }
 
 // byte 0		: CMD
@@ -107,10 +117,12 @@ inline std::ostream& operator<<(std::ostream& os, const InputBuffer& in) {
 // byte 6 - 9	: Rumble right	(default (no rumble): 00 01 40 40)
 // byte 10		: SUBCMD
 // byte 11 - .. : data
-class OutputBuffer : public BufferBase {
+class OutputBuffer : public BufferBase<362> {
 public:
 	OutputBuffer(std::size_t dataSize = 0);
-	OutputBuffer(OutputBuffer&) = delete;
+	OutputBuffer(const OutputBuffer&) = delete;
+	OutputBuffer(OutputBuffer&&) = default;
+	OutputBuffer& operator=(OutputBuffer&&) = default;
 
 	inline const byte* data() const { return buf.data(); }
 
@@ -129,19 +141,20 @@ public:
 	/// set right rumble data
 	void set_rumble_right(const Rumble& rumble);
 
+	/// set already encoded rumble data (see Rumble::encode)
+	void set_rumble_left(const ByteArray<4>& data);
+	void set_rumble_right(const ByteArray<4>& data);
+
 	/// set data
-	void set_data(const ByteVector& data);
+	void set_data(ByteView data);
 
-	friend std::ostream& operator<<(std::ostream& os, const OutputBuffer& in);
+	// see InputBuffer::format()
+	static constexpr std::size_t FORMAT_SIZE = 1200;
+	std::size_t format(char* out, std::size_t size) const;
 
 };
 
-inline std::ostream& operator<<(std::ostream& os, const OutputBuffer& in) {
-	os << to_hex_string(in.buf, 0, 1, "", " ") << " | " << to_hex_string(in.buf, 1, 1, "", " ") << " | " ;
-	os << to_hex_string(in.buf, 2, 4, "", " ") << " | " << to_hex_string(in.buf, 6, 4, "", " ") << " | ";
-	os << to_hex_string(in.buf, 10, 1, "", " ") << " |";
-	if (in.buf.size() > 11) {
-		os << "| " << to_hex_string(in.buf.begin() + 11, in.buf.end(), "", " ") << " ||";
-	}
-	return os;
+inline std::ostream& operator<<(std::ostream& os, const OutputBuffer& out) {
+	char text[OutputBuffer::FORMAT_SIZE];
+	return os.write(text, out.format(text, sizeof(text)));
 }
\ No newline at end of file
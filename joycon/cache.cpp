@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#include "cache.h"
+
+namespace {
+
+const char MAGIC[4] = { 'J', 'C', 'D', 'C' };
+const byte VERSION = 1;
+
+// sizes of the SensorCalibration members, in declaration order
+const std::array<std::size_t, 7> CALIB_SIZES = { 0x18, 0x12, 0x06, 0x12, 0x12, 0x16, 0x1A };
+
+const std::size_t RECORD_SIZE = 6 + 2 + 1 + 1 + 3 + 3 + (0x18 + 0x12 + 0x06 + 0x12 + 0x12 + 0x16 + 0x1A) + 4;
+
+std::array<ByteVector*, 7> calib_members(SensorCalibration& calib) {
+	return { &calib.factory_sensor_cal, &calib.factory_stick_cal, &calib.sensor_model, &calib.stick_model1,
+		&calib.stick_model2, &calib.user_stick_cal, &calib.user_sensor_cal };
+}
+
+std::array<uint32_t, 256> make_crc_table() {
+	std::array<uint32_t, 256> table;
+	for (uint32_t i = 0; i < 256; ++i) {
+		uint32_t c = i;
+		for (int k = 0; k < 8; ++k) {
+			c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+		}
+		table[i] = c;
+	}
+	return table;
+}
+
+bool parse_firmware(const std::string& version, byte& major, byte& minor) {
+	unsigned int a, b;
+	if (std::sscanf(version.c_str(), "%u.%u", &a, &b) != 2 || a > 0xFF || b > 0xFF) {
+		return false;
+	}
+	major = static_cast<byte>(a);
+	minor = static_cast<byte>(b);
+	return true;
+}
+
+// false if the record does not fit the fixed layout
+bool serialize(const DeviceRecord& record, ByteVector& out) {
+
+	byte major, minor;
+	if (!parse_firmware(record.info.firmwareVersion, major, minor)) {
+		return false;
+	}
+
+	SensorCalibration calib = record.calib;
+	auto members = calib_members(calib);
+	for (std::size_t i = 0; i < members.size(); ++i) {
+		if (members[i]->size() != CALIB_SIZES[i]) {
+			return false;
+		}
+	}
+
+	out.insert(out.end(), record.mac.begin(), record.mac.end());
+	out.push_back(major);
+	out.push_back(minor);
+	out.push_back(static_cast<byte>(record.info.joyconType));
+	out.push_back(record.info.useColorsSPI ? 1 : 0);
+	out.insert(out.end(), { record.body_color.R, record.body_color.G, record.body_color.B });
+	out.insert(out.end(), { record.button_color.R, record.button_color.G, record.button_color.B });
+	for (ByteVector* member : members) {
+		out.insert(out.end(), member->begin(), member->end());
+	}
+	for (int i = 0; i < 4; ++i) {
+		out.push_back(static_cast<byte>(record.checksum >> (8 * i)));
+	}
+
+	return true;
+}
+
+DeviceRecord deserialize(const byte* in) {
+
+	DeviceRecord record;
+
+	std::copy(in, in + 6, record.mac.begin());
+	in += 6;
+
+	record.info.firmwareVersion = std::to_string(in[0]) + "." + std::to_string(in[1]);
+	record.info.joyconType = in[2];
+	record.info.mac = to_hex_string(record.mac, 0, 6, "", ":");
+	record.info.useColorsSPI = in[3] != 0;
+	in += 4;
+
+	record.body_color = { in[0], in[1], in[2] };
+	record.button_color = { in[3], in[4], in[5] };
+	in += 6;
+
+	auto members = calib_members(record.calib);
+	for (std::size_t i = 0; i < members.size(); ++i) {
+		members[i]->assign(in, in + CALIB_SIZES[i]);
+		in += CALIB_SIZES[i];
+	}
+
+	record.checksum = 0;
+	for (int i = 0; i < 4; ++i) {
+		record.checksum |= static_cast<uint32_t>(in[i]) << (8 * i);
+	}
+
+	return record;
+}
+
+} // namespace
+
+DeviceCache::DeviceCache(std::string path) : path(std::move(path)) {
+	this->load();
+}
+
+bool DeviceCache::find(const ByteArray<6>& mac, DeviceRecord& out) const {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (const DeviceRecord& record : records) {
+		if (record.mac == mac) {
+			out = record;
+			return true;
+		}
+	}
+	return false;
+}
+
+void DeviceCache::store(const DeviceRecord& record) {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it = std::find_if(records.begin(), records.end(), [&record](const DeviceRecord& r) { return r.mac == record.mac; });
+	if (it != records.end()) {
+		*it = record;
+	} else {
+		records.push_back(record);
+	}
+
+	this->save();
+}
+
+std::size_t DeviceCache::size() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return records.size();
+}
+
+const std::vector<SPIRange>& DeviceCache::validation_ranges() {
+	static const std::vector<SPIRange> ranges = {
+		{ 0x6020, 0x18 },	// factory_sensor_cal
+		{ 0x6050, 0x06 },	// body + button color
+		{ 0x8010, 0x1D }	// user_stick_cal + user_sensor_cal magic
+	};
+	return ranges;
+}
+
+uint32_t DeviceCache::checksum(ByteView data, uint32_t crc) {
+	static const std::array<uint32_t, 256> table = make_crc_table();
+
+	crc = ~crc;
+	for (byte b : data) {
+		crc = table[(crc ^ b) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+// called from the constructor only
+void DeviceCache::load() {
+
+	if (path.empty()) {
+		return;
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return;
+	}
+
+	ByteVector data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	if (data.size() < 7 || !std::equal(MAGIC, MAGIC + 4, data.begin()) || data[4] != VERSION) {
+		return;
+	}
+
+	std::size_t count = data[5] | (data[6] << 8);
+	if (data.size() != 7 + count * RECORD_SIZE) {
+		return;
+	}
+
+	for (std::size_t i = 0; i < count; ++i) {
+		records.push_back(deserialize(data.data() + 7 + i * RECORD_SIZE));
+	}
+}
+
+// mutex must be held
+void DeviceCache::save() const {
+
+	if (path.empty()) {
+		return;
+	}
+
+	ByteVector data(MAGIC, MAGIC + 4);
+	data.push_back(VERSION);
+	data.push_back(0);
+	data.push_back(0);
+
+	std::size_t count = 0;
+	for (const DeviceRecord& record : records) {
+		if (serialize(record, data) && ++count == 0xFFFF) {
+			break;
+		}
+	}
+	data[5] = static_cast<byte>(count);
+	data[6] = static_cast<byte>(count >> 8);
+
+	// write a temporary file and rename it: a crash never leaves a half written cache behind
+	std::string tmp = path + ".tmp";
+	{
+		std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		if (!file) {
+			std::remove(tmp.c_str());
+			return;
+		}
+	}
+
+#ifdef _WIN32
+	std::remove(path.c_str());
+#endif
+	std::rename(tmp.c_str(), path.c_str());
+}
+
+bool parse_mac(const std::string& str, ByteArray<6>& mac) {
+
+	std::string digits;
+	for (char c : str) {
+		if (std::isxdigit(static_cast<unsigned char>(c))) {
+			digits += c;
+		} else if (c != ':' && c != '-') {
+			return false;
+		}
+	}
+
+	if (digits.size() != 12) {
+		return false;
+	}
+
+	for (std::size_t i = 0; i < 6; ++i) {
+		mac[i] = static_cast<byte>(std::stoul(digits.substr(2 * i, 2), nullptr, 16));
+	}
+	return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "spi.h"
+#include "types.h"
+
+// everything the constructor would otherwise read from the device
+struct DeviceRecord {
+	ByteArray<6> mac;
+	JoyconDeviceInfo info;
+	Color24 body_color;
+	Color24 button_color;
+	SensorCalibration calib;
+	uint32_t checksum;		// CRC32 of the DeviceCache::validation_ranges()
+};
+
+// Binary file with one fixed-size record per controller MAC. The firmware version is stored, not part of the key:
+// it is only known after a round trip to the device, the validation of a found record compares it and stores a
+// new record if it changed.
+// header: "JCDC" | version (1 byte) | record count (2 byte, little endian)
+// record: MAC (6) | firmware major, minor | joycon type | use colors SPI | body RGB | button RGB
+//         | factory sensor cal (0x18) | factory stick cal (0x12) | sensor model (0x06) | stick model 1, 2 (0x12 each)
+//         | user stick cal (0x16) | user sensor cal (0x1A) | checksum (4 byte, little endian)
+// A missing or broken file is an empty cache. Thread safe.
+class DeviceCache {
+public:
+	// loads path. An empty path keeps the cache in memory only.
+	explicit DeviceCache(std::string path);
+
+	bool find(const ByteArray<6>& mac, DeviceRecord& out) const;
+
+	// replaces the record of the same MAC and saves the file
+	void store(const DeviceRecord& record);
+
+	std::size_t size() const;
+
+	// cheap reads to check a cached record against the device: factory sensor calibration, colors, user calibration
+	static const std::vector<SPIRange>& validation_ranges();
+
+	static uint32_t checksum(ByteView data, uint32_t crc = 0);
+
+private:
+	void load();
+	void save() const;
+
+	std::string path;
+
+	mutable std::mutex mutex;
+	std::vector<DeviceRecord> records;
+};
+
+// "98:b6:e9:01:02:03" or "98b6e9010203" -> bytes. Returns false if str is no MAC.
+bool parse_mac(const std::string& str, ByteArray<6>& mac);
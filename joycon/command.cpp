@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "command.h"
+
+constexpr std::size_t CommandQueue::MAX_IN_FLIGHT;
+
+CommandQueue::CommandQueue(Writer writer, LinkMetrics* metrics) : writer(std::move(writer)), metrics(metrics) {}
+
+void CommandQueue::set_activity_hook(ActivityHook hook) {
+	std::lock_guard<std::mutex> lock(mutex);
+	activity_hook = std::move(hook);
+}
+
+std::future<InputBuffer> CommandQueue::submit(OutputBuffer&& out, std::chrono::milliseconds timeout, unsigned int retries, std::size_t echo) {
+
+	std::future<InputBuffer> res;
+	if (!this->try_submit(out, res, timeout, retries, echo)) {
+		throw std::runtime_error("Too many commands in flight!");
+	}
+	return res;
+}
+
+bool CommandQueue::try_submit(OutputBuffer& out, std::future<InputBuffer>& reply, std::chrono::milliseconds timeout, unsigned int retries, std::size_t echo) {
+
+	// reply data is 35 byte, command data starts at byte 11
+	if (echo > 35 || 11 + echo > out.size()) {
+		throw std::invalid_argument("echo is longer than the command data.");
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Slot* slot = nullptr;
+	for (auto& s : slots) {
+		if (!s.used) {
+			slot = &s;
+			break;
+		}
+	}
+
+	if (slot == nullptr) {
+		return false;
+	}
+
+	slot->out = std::move(out);
+	slot->subcmd = slot->out.data()[10];
+	slot->echo = echo;
+	slot->sequence = sequence++;
+	slot->retries = retries;
+	slot->timeout = timeout;
+	slot->reply = std::promise<InputBuffer>();
+
+	std::future<InputBuffer> res = slot->reply.get_future();
+
+	// registered before the write, so on_report() finds the slot when the reply comes back at once.
+	// It waits for the lock until the write is done.
+	slot->used = true;
+	const std::size_t previous = pending.fetch_add(1, std::memory_order_release);
+	if (previous == 0 && activity_hook) {
+		activity_hook(true);
+	}
+	if (metrics != nullptr) {
+		LinkMetrics::update_max(metrics->commands_in_flight_max, previous + 1);
+	}
+
+	slot->submitted = Clock::now();
+	try {
+		writer(slot->out);
+	} catch (...) {
+		release(*slot);
+		throw;
+	}
+	slot->deadline = Clock::now() + timeout;
+
+	reply = std::move(res);
+	return true;
+}
+
+bool CommandQueue::on_report(const InputBuffer& buff_in) {
+
+	if (buff_in.get_ID() != 0x21 || pending.load(std::memory_order_acquire) == 0) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const byte& subcmd = buff_in.get_subcommandID_reply();
+
+	// oldest command waiting for this subcommand. The reply carries no GP, only the echo bytes tell apart commands of one ID.
+	Slot* match = nullptr;
+	for (auto& s : slots) {
+		if (s.used && s.subcmd == subcmd && echoes(s, buff_in) && (match == nullptr || s.sequence < match->sequence)) {
+			match = &s;
+		}
+	}
+
+	if (match == nullptr) {
+		return false;
+	}
+
+	if (metrics != nullptr) {
+		metrics->round_trip.record(Clock::now() - match->submitted);
+	}
+	match->reply.set_value(buff_in);
+	release(*match);
+
+	return true;
+}
+
+std::size_t CommandQueue::poll(Clock::time_point now) {
+
+	if (pending.load(std::memory_order_relaxed) == 0) {
+		return 0;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto& s : slots) {
+		if (!s.used || now < s.deadline) {
+			continue;
+		}
+
+		if (s.retries > 0) {
+			--s.retries;
+			if (metrics != nullptr) {
+				LinkMetrics::increment(metrics->command_resends);
+			}
+			try {
+				writer(s.out);
+				s.deadline = now + s.timeout;
+				continue;
+			} catch (...) {
+				s.reply.set_exception(std::current_exception());
+			}
+		} else {
+			if (metrics != nullptr) {
+				LinkMetrics::increment(metrics->command_failures);
+			}
+			std::ostringstream error;
+			error << "No reply for subcommand " << std::hex << static_cast<unsigned int>(s.subcmd) << "!";
+			s.reply.set_exception(std::make_exception_ptr(std::runtime_error(error.str())));
+		}
+
+		release(s);
+	}
+
+	return pending.load(std::memory_order_relaxed);
+}
+
+void CommandQueue::abort(const std::string& reason) {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto& s : slots) {
+		if (s.used) {
+			s.reply.set_exception(std::make_exception_ptr(std::runtime_error(reason)));
+			release(s);
+		}
+	}
+}
+
+bool CommandQueue::wait_free(std::chrono::milliseconds timeout) {
+
+	std::unique_lock<std::mutex> lock(mutex);
+	return freed.wait_for(lock, timeout, [this]() { return pending.load(std::memory_order_relaxed) < MAX_IN_FLIGHT; });
+}
+
+bool CommandQueue::echoes(const Slot& slot, const InputBuffer& buff_in) {
+	return std::equal(slot.out.data() + 11, slot.out.data() + 11 + slot.echo, buff_in.data() + 15);
+}
+
+// mutex must be held
+void CommandQueue::release(Slot& slot) {
+	slot.used = false;
+	freed.notify_all();
+	if (pending.fetch_sub(1, std::memory_order_relaxed) == 1 && activity_hook) {
+		activity_hook(false);
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+
+#include "buffer.h"
+#include "metrics.h"
+
+// Subcommands in flight. The reader feeds every report into on_report(), which fulfills the
+// oldest command waiting for the subcommand ID of a 0x21 reply. The GP counter can not tell
+// commands apart: a 0x21 reply does not echo it (byte 1 is the input timer). The echo bytes of
+// the reply data do that for commands with the same ID. Commands without reply after
+// their timeout are sent again (with a new GP) until their retries are used up, then they fail.
+class CommandQueue {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// sets the GP and writes the output report
+	using Writer = std::function<void(OutputBuffer&)>;
+
+	// called with true when the first command goes in flight, false when the last one is done
+	using ActivityHook = std::function<void(bool)>;
+
+	static constexpr std::size_t MAX_IN_FLIGHT = 8;
+
+	// metrics (optional): round trip times, resends, failures and the most commands in flight are recorded there
+	explicit CommandQueue(Writer writer, LinkMetrics* metrics = nullptr);
+	CommandQueue(const CommandQueue&) = delete;
+	CommandQueue& operator=(const CommandQueue&) = delete;
+
+	void set_activity_hook(ActivityHook hook);
+
+	// writes out and returns the future 0x21 reply. Throws if MAX_IN_FLIGHT commands are in flight or the write fails.
+	// echo: the reply data has to start with the first echo bytes of the command data (e.g. SPI address + length),
+	// so commands with the same subcommand ID can not take each others replies.
+	std::future<InputBuffer> submit(OutputBuffer&& out, std::chrono::milliseconds timeout, unsigned int retries, std::size_t echo = 0);
+
+	// like submit(), but returns false instead of throwing if MAX_IN_FLIGHT commands are in flight (out is left untouched then)
+	bool try_submit(OutputBuffer& out, std::future<InputBuffer>& reply, std::chrono::milliseconds timeout, unsigned int retries, std::size_t echo = 0);
+
+	// waits until a command is done or failed. Returns false if all slots are still used after timeout.
+	bool wait_free(std::chrono::milliseconds timeout);
+
+	// returns true if buff_in was the reply of a command in flight
+	bool on_report(const InputBuffer& buff_in);
+
+	// resends or fails the commands that passed their deadline. Returns the amount still in flight.
+	std::size_t poll(Clock::time_point now = Clock::now());
+
+	// fails all commands in flight with std::runtime_error(reason), e.g. when the device is gone
+	void abort(const std::string& reason);
+
+	std::size_t in_flight() const { return pending.load(std::memory_order_relaxed); }
+
+private:
+	struct Slot {
+		bool used = false;
+		byte subcmd = 0;
+		std::size_t echo = 0;
+		uint64_t sequence = 0;
+		unsigned int retries = 0;
+		std::chrono::milliseconds timeout{ 0 };
+		Clock::time_point deadline;
+		Clock::time_point submitted;
+		OutputBuffer out;
+		std::promise<InputBuffer> reply;
+	};
+
+	static bool echoes(const Slot& slot, const InputBuffer& buff_in);
+	void release(Slot& slot);
+
+	Writer writer;
+	LinkMetrics* metrics;
+	ActivityHook activity_hook;
+
+	std::mutex mutex;
+	std::condition_variable freed;
+	std::array<Slot, MAX_IN_FLIGHT> slots;
+	uint64_t sequence = 0;
+	std::atomic<std::size_t> pending{ 0 };
+};
@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <cmath>
+
+#include "deviceclock.h"
+
+constexpr std::size_t DeviceClock::MIN_SAMPLES;
+constexpr uint64_t DeviceClock::MAX_UNKNOWN_GAP;
+
+namespace {
+
+// ns per report the floor of the residuals rises, so a longer minimum delay is followed (~60us/s at 60Hz)
+const double FLOOR_RISE = 1000.0;
+
+} // namespace
+
+DeviceClock::DeviceClock(double forgetting) : forgetting(forgetting) {}
+
+void DeviceClock::reset() {
+	*this = DeviceClock(forgetting);
+}
+
+uint64_t DeviceClock::on_report(byte timer, uint64_t arrival_ns) {
+
+	if (samples > 0) {
+		const uint64_t elapsed = arrival_ns > last_arrival ? arrival_ns - last_arrival : 0;
+
+		// byte arithmetic: a single wrap needs no host time
+		uint64_t difference = static_cast<byte>(timer - last_timer);
+		if (this->synchronized()) {
+			// the amount of whole wraps that fits the host time best
+			const double wraps = std::floor((elapsed / this->tick_ns() - difference) / 256.0 + 0.5);
+			if (wraps > 0.0) {
+				difference += static_cast<uint64_t>(wraps) * 256;
+			}
+		} else if (elapsed > MAX_UNKNOWN_GAP) {
+			this->reset();
+			difference = 0;
+		}
+		unwrapped += difference;
+	}
+
+	if (samples == 0) {
+		origin_ns = arrival_ns;
+	}
+	++samples;
+	last_timer = timer;
+	last_arrival = arrival_ns;
+
+	// exponentially weighted means and covariances, the first samples weigh the same
+	const double t = static_cast<double>(unwrapped);
+	const double y = static_cast<double>(arrival_ns - origin_ns);
+	weight = forgetting * weight + 1.0;
+	const double a = 1.0 / weight;
+	const double dt = t - mean_t;
+	const double dy = y - mean_y;
+	mean_t += a * dt;
+	mean_y += a * dy;
+	cov_tt = (1.0 - a) * (cov_tt + a * dt * dt);
+	cov_ty = (1.0 - a) * (cov_ty + a * dt * dy);
+
+	uint64_t timestamp = arrival_ns;
+	if (this->synchronized()) {
+		const double predicted = this->predict(t);
+		floor = std::min(floor + FLOOR_RISE, y - predicted);
+
+		const double corrected = predicted + floor;
+		timestamp = origin_ns + static_cast<uint64_t>(corrected > 0.0 ? corrected + 0.5 : 0.0);
+	}
+
+	timestamp = std::max(timestamp, last_timestamp);
+	last_timestamp = timestamp;
+	return timestamp;
+}
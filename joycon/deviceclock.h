@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "types.h"
+
+// Model of the free running timer byte of one device against the host steady clock: host = a + tick * unwrapped timer.
+// Offset and drift are an exponentially weighted least squares fit over the arrival times, the offset is then lowered
+// to the fastest arrivals seen (the minimum delay), so the timestamps carry the transmission time, but not its jitter.
+// Wraps of the timer are unwrapped with the host time, also over pauses of many wraps once the tick is known.
+// Only used by one thread (the reader).
+class DeviceClock {
+public:
+	// reports before the model is used, their timestamp is the arrival
+	static constexpr std::size_t MIN_SAMPLES = 16;
+
+	// without a tick estimate a pause this long (ns) may hide wraps: the model starts again
+	static constexpr uint64_t MAX_UNKNOWN_GAP = 250000000;
+
+	// weight of the previous samples per report, ~1 / (1 - forgetting) reports make up the fit
+	explicit DeviceClock(double forgetting = 0.998);
+
+	// arrival_ns: host steady clock when the report was read. Returns the de-jittered host time of the report,
+	// never earlier than the one before.
+	uint64_t on_report(byte timer, uint64_t arrival_ns);
+
+	bool synchronized() const { return samples >= MIN_SAMPLES && cov_tt > 0.0; }
+
+	// estimated host ns per timer tick (0 before synchronized())
+	double tick_ns() const { return this->synchronized() ? cov_ty / cov_tt : 0.0; }
+
+	// ticks since the first report
+	uint64_t ticks() const { return unwrapped; }
+
+	void reset();
+
+private:
+	double predict(double ticks) const { return mean_y + (cov_ty / cov_tt) * (ticks - mean_t); }
+
+	double forgetting;
+
+	std::size_t samples = 0;
+	byte last_timer = 0;
+	uint64_t last_arrival = 0;
+	uint64_t last_timestamp = 0;
+	uint64_t unwrapped = 0;
+
+	// the fit: weighted means and (co)variances of ticks t and host time y (ns since the first report)
+	uint64_t origin_ns = 0;
+	double weight = 0.0;
+	double mean_t = 0.0;
+	double mean_y = 0.0;
+	double cov_tt = 0.0;
+	double cov_ty = 0.0;
+
+	// lowest residual of the arrivals (ns, <= 0), rises slowly to follow changes of the delay
+	double floor = 0.0;
+};
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "hapticclip.h"
+#include "rumble.h"
+
+namespace {
+
+const char MAGIC[4] = { 'J', 'C', 'H', 'C' };
+const byte VERSION = 1;
+
+void append_u32(ByteVector& out, uint32_t value) {
+	for (int i = 0; i < 4; ++i) {
+		out.push_back(static_cast<byte>(value >> (8 * i)));
+	}
+}
+
+uint32_t read_u32(const byte* in) {
+	return in[0] | (in[1] << 8) | (in[2] << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+} // namespace
+
+constexpr std::size_t HapticClip::HEADER_SIZE;
+constexpr std::size_t HapticClip::FRAME_SIZE;
+
+ByteVector compile_haptic_clip(std::istream& text) {
+
+	ByteVector frames;
+	uint32_t count = 0;
+	long long last_time = -1;
+
+	std::string line;
+	for (std::size_t line_nr = 1; std::getline(text, line); ++line_nr) {
+
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream fields(line);
+		long long time;
+		double values[4];
+		int n = 0;
+
+		if (!(fields >> time)) {
+			if (line.find_first_not_of(" \t\r") == std::string::npos) {
+				continue;	// empty or comment
+			}
+			throw std::runtime_error("line " + std::to_string(line_nr) + ": expected a time.");
+		}
+
+		while (n < 4 && fields >> values[n]) {
+			++n;
+		}
+		fields.clear();
+		std::string rest;
+		if ((n != 2 && n != 4) || (fields >> rest)) {
+			throw std::runtime_error("line " + std::to_string(line_nr) + ": expected <time> <frequency> <amplitude> [<frequency> <amplitude>].");
+		}
+
+		if (time < 0 || time > 0xFFFFFFFFLL || time < last_time) {
+			throw std::runtime_error("line " + std::to_string(line_nr) + ": times must be increasing 32 bit milliseconds.");
+		}
+		last_time = time;
+
+		try {
+			Rumble left(values[0], values[1]);
+			Rumble right = (n == 4) ? Rumble(values[2], values[3]) : left;
+
+			append_u32(frames, static_cast<uint32_t>(time));
+			frames.insert(frames.end(), left.getByte().begin(), left.getByte().end());
+			frames.insert(frames.end(), right.getByte().begin(), right.getByte().end());
+			++count;
+		} catch (std::exception& e) {
+			throw std::runtime_error("line " + std::to_string(line_nr) + ": " + e.what());
+		}
+	}
+
+	ByteVector clip(MAGIC, MAGIC + 4);
+	clip.insert(clip.end(), { VERSION, 0, 0, 0 });
+	append_u32(clip, count);
+	clip.insert(clip.end(), frames.begin(), frames.end());
+	return clip;
+}
+
+/* ------ HAPTICCLIP ------ */
+
+HapticClip::HapticClip(const std::string& path) : file(path) {
+
+	const byte* data = file.data();
+	if (file.size() < HEADER_SIZE || !std::equal(MAGIC, MAGIC + 4, data) || data[4] != VERSION) {
+		throw std::runtime_error(path + " is no haptic clip.");
+	}
+
+	count = read_u32(data + 8);
+	if (file.size() != HEADER_SIZE + count * FRAME_SIZE) {
+		throw std::runtime_error(path + " is truncated.");
+	}
+}
+
+std::chrono::milliseconds HapticClip::time(std::size_t idx) const {
+	return std::chrono::milliseconds(read_u32(this->frame(idx)));
+}
+
+ByteArray<4> HapticClip::left(std::size_t idx) const {
+	ByteArray<4> res;
+	std::copy(this->frame(idx) + 4, this->frame(idx) + 8, res.begin());
+	return res;
+}
+
+ByteArray<4> HapticClip::right(std::size_t idx) const {
+	ByteArray<4> res;
+	std::copy(this->frame(idx) + 8, this->frame(idx) + 12, res.begin());
+	return res;
+}
+
+std::chrono::milliseconds HapticClip::duration() const {
+	return count == 0 ? std::chrono::milliseconds(0) : this->time(count - 1);
+}
+
+const byte* HapticClip::frame(std::size_t idx) const {
+	if (idx >= count) {
+		throw std::out_of_range("frame index out of range.");
+	}
+	return file.data() + HEADER_SIZE + idx * FRAME_SIZE;
+}
+
+/* ------ HAPTICPLAYER ------ */
+
+HapticPlayer::HapticPlayer(const HapticClip& clip, Writer writer) : clip(clip), writer(std::move(writer)) {}
+
+void HapticPlayer::start(Clock::time_point now) {
+	start_time = now;
+	next = 0;
+}
+
+bool HapticPlayer::tick(Clock::time_point now) {
+
+	// latest due frame
+	std::size_t due = next;
+	while (due < clip.size() && start_time + clip.time(due) <= now) {
+		++due;
+	}
+
+	if (due > next) {
+		writer(clip.left(due - 1), clip.right(due - 1));
+		next = due;
+	}
+
+	return next < clip.size();
+}
+
+HapticPlayer::Clock::time_point HapticPlayer::next_due() const {
+	return next < clip.size() ? start_time + clip.time(next) : start_time + clip.duration();
+}
+
+void HapticPlayer::play() {
+	this->start();
+	while (this->tick()) {
+		std::this_thread::sleep_until(this->next_due());
+	}
+}
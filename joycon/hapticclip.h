@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <string>
+
+#include "mappedfile.h"
+#include "types.h"
+
+// Binary haptic clip with pre-encoded rumble frames:
+// header: "JCHC" | version (1 byte) | 3 byte reserved | frame count (4 byte, little endian)
+// frame:  time in ms since the clip start (4 byte, little endian) | left rumble (4) | right rumble (4)
+// Frames are sorted by time, each one holds until the next.
+
+// Text -> binary clip. One frame per line: <time ms> <frequency> <amplitude> [<frequency right> <amplitude right>],
+// a single pair drives both channels. '#' starts a comment.
+// Throws std::runtime_error (with the line number) on syntax errors, unsorted times or values out of range.
+ByteVector compile_haptic_clip(std::istream& text);
+
+// Memory mapped clip. Throws std::runtime_error if the file is no valid clip.
+class HapticClip {
+public:
+	static constexpr std::size_t HEADER_SIZE = 12;
+	static constexpr std::size_t FRAME_SIZE = 12;
+
+	explicit HapticClip(const std::string& path);
+
+	std::size_t size() const { return count; }
+
+	std::chrono::milliseconds time(std::size_t idx) const;
+	ByteArray<4> left(std::size_t idx) const;
+	ByteArray<4> right(std::size_t idx) const;
+
+	// time of the last frame
+	std::chrono::milliseconds duration() const;
+
+private:
+	const byte* frame(std::size_t idx) const;
+
+	MappedFile file;
+	std::size_t count;
+};
+
+// Streams the frames of a clip to a writer (e.g. Joycon::send_rumble(left, right)) at their time.
+class HapticPlayer {
+public:
+	using Clock = std::chrono::steady_clock;
+	using Writer = std::function<void(const ByteArray<4>& left, const ByteArray<4>& right)>;
+
+	HapticPlayer(const HapticClip& clip, Writer writer);
+
+	void start(Clock::time_point now = Clock::now());
+
+	// writes the latest due frame, frames that are already overdue are skipped.
+	// Returns false once the last frame is written.
+	bool tick(Clock::time_point now = Clock::now());
+
+	Clock::time_point next_due() const;
+
+	// start() and tick() until the clip is done, sleeping in between
+	void play();
+
+private:
+	const HapticClip& clip;
+	Writer writer;
+	Clock::time_point start_time;
+	std::size_t next = 0;
+};
@@ -0,0 +1,37 @@
+#include <fstream>
+#include <iostream>
+
+#include "hapticclip.h"
+
+// Converts a text haptic description into a binary clip, see compile_haptic_clip().
+int main(int argc, char* argv[]) {
+
+	if (argc != 3) {
+		std::cerr << "Usage: " << argv[0] << " <input.txt> <output.jchc>" << std::endl;
+		return 1;
+	}
+
+	std::ifstream in(argv[1]);
+	if (!in) {
+		std::cerr << "Could not open " << argv[1] << std::endl;
+		return 1;
+	}
+
+	ByteVector clip;
+	try {
+		clip = compile_haptic_clip(in);
+	} catch (std::exception& e) {
+		std::cerr << argv[1] << ", " << e.what() << std::endl;
+		return 1;
+	}
+
+	std::ofstream out(argv[2], std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(clip.data()), clip.size());
+	if (!out) {
+		std::cerr << "Could not write " << argv[2] << std::endl;
+		return 1;
+	}
+
+	std::cout << "Wrote " << (clip.size() - HapticClip::HEADER_SIZE) / HapticClip::FRAME_SIZE << " frames to " << argv[2] << std::endl;
+	return 0;
+}
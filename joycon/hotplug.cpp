@@ -0,0 +1,238 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "hotplug.h"
+#include "types.h"
+
+namespace {
+
+// udev_monitor_netlink_header of libudev: "libudev\0", magic (big endian), header size, offset and length of the
+// properties (host order), ...
+const std::size_t UDEV_HEADER_SIZE = 24;
+const byte UDEV_MAGIC[4] = { 0xfe, 0xed, 0xca, 0xfe };
+
+uint32_t read_u32(const char* data) {
+	uint32_t res;
+	std::memcpy(&res, data, sizeof(res));
+	return res;
+}
+
+// the HID id of a hidraw DEVPATH: .../0005:057E:2006.0003/hidraw/hidraw3
+bool parse_hid_id(const std::string& devpath, HotplugEvent& event) {
+	const std::size_t end = devpath.rfind("/hidraw/");
+	if (end == std::string::npos) {
+		return false;
+	}
+	const std::size_t begin = devpath.rfind('/', end - 1);
+	if (begin == std::string::npos) {
+		return false;
+	}
+
+	unsigned int bus, vendor, product, instance;
+	if (std::sscanf(devpath.c_str() + begin + 1, "%x:%x:%x.%x", &bus, &vendor, &product, &instance) != 4) {
+		return false;
+	}
+	event.vendor_id = static_cast<unsigned short>(vendor);
+	event.product_id = static_cast<unsigned short>(product);
+	return true;
+}
+
+} // namespace
+
+bool parse_uevent(const char* data, std::size_t length, HotplugEvent& event) {
+
+	// the properties: KEY=VALUE, each terminated by \0
+	const char* begin = data;
+	const char* end = data + length;
+	if (length >= UDEV_HEADER_SIZE && std::memcmp(data, "libudev", 8) == 0) {
+		if (std::memcmp(data + 8, UDEV_MAGIC, sizeof(UDEV_MAGIC)) != 0) {
+			return false;
+		}
+		const uint32_t offset = read_u32(data + 16);
+		const uint32_t size = read_u32(data + 20);
+		if (offset < UDEV_HEADER_SIZE || offset > length || size > length - offset) {
+			return false;
+		}
+		begin = data + offset;
+		end = begin + size;
+	} else {
+		// kernel: ACTION@DEVPATH first
+		const char* header_end = static_cast<const char*>(std::memchr(data, '\0', length));
+		if (header_end == nullptr || std::memchr(data, '@', header_end - data) == nullptr) {
+			return false;
+		}
+		begin = header_end + 1;
+	}
+
+	std::string action, subsystem, devname, devpath;
+	while (begin < end) {
+		const char* stop = static_cast<const char*>(std::memchr(begin, '\0', end - begin));
+		const std::string property(begin, stop != nullptr ? stop : end);
+		begin = stop != nullptr ? stop + 1 : end;
+
+		const std::size_t equal = property.find('=');
+		if (equal == std::string::npos) {
+			continue;
+		}
+		const std::string key = property.substr(0, equal);
+		if (key == "ACTION") {
+			action = property.substr(equal + 1);
+		} else if (key == "SUBSYSTEM") {
+			subsystem = property.substr(equal + 1);
+		} else if (key == "DEVNAME") {
+			devname = property.substr(equal + 1);
+		} else if (key == "DEVPATH") {
+			devpath = property.substr(equal + 1);
+		}
+	}
+
+	if (subsystem != "hidraw" || devname.empty() || (action != "add" && action != "remove")) {
+		return false;
+	}
+
+	HotplugEvent res;
+	res.action = action == "add" ? HOTPLUG_ADD : HOTPLUG_REMOVE;
+	res.path = devname[0] == '/' ? devname : "/dev/" + devname;	// the kernel sends it relative to /dev
+	res.devpath = devpath;
+	parse_hid_id(devpath, res);
+
+	event = std::move(res);
+	return true;
+}
+
+/* ------ QUEUE ------ */
+
+void HotplugQueue::push(HotplugEvent event) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		events.push_back(std::move(event));
+	}
+	ready.notify_one();
+}
+
+bool HotplugQueue::next(HotplugEvent& event, std::chrono::milliseconds timeout) {
+	std::unique_lock<std::mutex> lock(mutex);
+	if (!ready.wait_for(lock, timeout, [this]() { return !events.empty(); })) {
+		return false;
+	}
+	event = std::move(events.front());
+	events.pop_front();
+	return true;
+}
+
+std::size_t HotplugQueue::pending() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return events.size();
+}
+
+/* ------ MONITOR ------ */
+
+#ifdef __linux__
+
+UeventMonitor::UeventMonitor(UEVENT_GROUP group, std::string sysfs) : sysfs(std::move(sysfs)) {
+
+	socket_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+	if (socket_fd == -1) {
+		throw std::runtime_error(std::string("Could not open the uevent socket: ") + std::strerror(errno));
+	}
+
+	sockaddr_nl address{};
+	address.nl_family = AF_NETLINK;
+	address.nl_groups = group;
+	int on = 1;
+	if (bind(socket_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1 ||
+		setsockopt(socket_fd, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on)) == -1) {
+		const std::string error = std::strerror(errno);
+		close(socket_fd);
+		throw std::runtime_error("Could not listen for uevents: " + error);
+	}
+
+	// bursts of events (e.g. a dock with many devices) must not overrun the socket
+	int size = 1 << 20;
+	setsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+}
+
+UeventMonitor::~UeventMonitor() {
+	close(socket_fd);
+}
+
+bool UeventMonitor::next(HotplugEvent& event, std::chrono::milliseconds timeout) {
+
+	pollfd fds{ socket_fd, POLLIN, 0 };
+	const int ready = poll(&fds, 1, static_cast<int>(timeout.count()));
+	if (ready == -1 && errno != EINTR) {
+		throw std::runtime_error(std::string("poll of the uevent socket failed: ") + std::strerror(errno));
+	}
+	if (ready <= 0) {
+		return false;
+	}
+
+	while (true) {
+		sockaddr_nl sender{};
+		iovec data{ buffer, sizeof(buffer) };
+		char control[CMSG_SPACE(sizeof(ucred))];
+		msghdr message{};
+		message.msg_name = &sender;
+		message.msg_namelen = sizeof(sender);
+		message.msg_iov = &data;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+
+		const ssize_t length = recvmsg(socket_fd, &message, 0);
+		if (length == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == ENOBUFS) {
+				++overrun_count;
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				return false;
+			}
+			throw std::runtime_error(std::string("recvmsg of the uevent socket failed: ") + std::strerror(errno));
+		}
+
+		// anybody may send to a netlink socket: only the kernel and root processes (udev) are trusted
+		const cmsghdr* header = CMSG_FIRSTHDR(&message);
+		if (header == nullptr || header->cmsg_type != SCM_CREDENTIALS || reinterpret_cast<const ucred*>(CMSG_DATA(header))->uid != 0) {
+			continue;
+		}
+		if ((message.msg_flags & MSG_TRUNC) != 0) {
+			continue;
+		}
+
+		if (parse_uevent(buffer, static_cast<std::size_t>(length), event)) {
+			if (event.action == HOTPLUG_ADD) {
+				event.serial_number = this->read_serial(event.devpath);
+			}
+			return true;
+		}
+	}
+}
+
+// HID_UNIQ of the HID device the node belongs to
+std::wstring UeventMonitor::read_serial(const std::string& devpath) const {
+	std::ifstream file(sysfs + devpath + "/device/uevent");
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.compare(0, 9, "HID_UNIQ=") == 0) {
+			return std::wstring(line.begin() + 9, line.end());
+		}
+	}
+	return std::wstring();
+}
+
+#endif
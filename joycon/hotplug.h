@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+enum HOTPLUG_ACTION {
+	HOTPLUG_ADD,
+	HOTPLUG_REMOVE
+};
+
+// A HID device node that appeared or vanished.
+struct HotplugEvent {
+	HOTPLUG_ACTION action = HOTPLUG_ADD;
+	std::string path;				// as TransportDevice::path, e.g. /dev/hidraw3
+	unsigned short vendor_id = 0;
+	unsigned short product_id = 0;
+	std::wstring serial_number;		// the MAC of a Bluetooth controller, empty if unknown
+	std::string devpath;			// of the node below /sys, empty if unknown
+};
+
+// Where JoyconVec::watch() takes the events from: waits up to timeout for the next event, returns false if there was none.
+// Only called by the watching thread.
+using HotplugSource = std::function<bool(HotplugEvent& event, std::chrono::milliseconds timeout)>;
+
+// Parses a netlink uevent of the hidraw subsystem, as sent by the kernel ("ACTION@DEVPATH" header) or by udev
+// ("libudev" header). Vendor and product come from the HID id in DEVPATH (bus:vendor:product.instance), the serial
+// number is not part of the message. Returns false for other subsystems and actions, and for malformed messages.
+bool parse_uevent(const char* data, std::size_t length, HotplugEvent& event);
+
+// Events pushed by hand, e.g. by tests or by an own device discovery. Thread safe.
+class HotplugQueue {
+public:
+	void push(HotplugEvent event);
+	bool next(HotplugEvent& event, std::chrono::milliseconds timeout);
+
+	// next() of this queue, which must outlive the source
+	HotplugSource source() { return [this](HotplugEvent& event, std::chrono::milliseconds timeout) { return this->next(event, timeout); }; }
+
+	std::size_t pending() const;
+
+private:
+	mutable std::mutex mutex;
+	std::condition_variable ready;
+	std::deque<HotplugEvent> events;
+};
+
+#ifdef __linux__
+
+enum UEVENT_GROUP {
+	UEVENT_KERNEL = 1,	// straight from the kernel, also without udev (e.g. containers). The node may not be accessible yet.
+	UEVENT_UDEV = 2		// after udev applied its rules (e.g. the permissions of the node), needs a running udev daemon
+};
+
+// The hidraw events of a netlink uevent socket. The serial number of an added device is read from sysfs.
+// Only messages of root (the kernel or udev) are accepted.
+class UeventMonitor {
+public:
+	// Throws std::runtime_error if the socket can not be opened.
+	explicit UeventMonitor(UEVENT_GROUP group = UEVENT_UDEV, std::string sysfs = "/sys");
+	UeventMonitor(const UeventMonitor&) = delete;
+	UeventMonitor& operator=(const UeventMonitor&) = delete;
+	~UeventMonitor();
+
+	// Waits up to timeout for a message and returns the first hidraw event of the pending messages.
+	// Throws std::runtime_error if the socket fails.
+	bool next(HotplugEvent& event, std::chrono::milliseconds timeout);
+
+	// next() of this monitor, which must outlive the source
+	HotplugSource source() { return [this](HotplugEvent& event, std::chrono::milliseconds timeout) { return this->next(event, timeout); }; }
+
+	int fd() const { return socket_fd; }
+
+	// messages dropped by the kernel because the socket buffer was full (their devices are missed)
+	std::size_t overruns() const { return overrun_count; }
+
+private:
+	std::wstring read_serial(const std::string& devpath) const;
+
+	int socket_fd = -1;
+	std::string sysfs;
+	std::size_t overrun_count = 0;
+	char buffer[8192];
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "imufusion.h"
+
+namespace {
+
+constexpr float DEG_TO_RAD = 3.14159265358979f / 180.0f;
+
+// far below the square of one LSB
+constexpr float TINY = 1e-30f;
+
+int16_t read_int16(const ByteVector& data, std::size_t idx) {
+	return static_cast<int16_t>(data[2 * idx] | (data[2 * idx + 1] << 8));
+}
+
+// Madgwick's IMU update (MadgwickAHRSupdateIMU) without the ifs, for the filters [begin, end).
+// Restrict pointers: the arrays never overlap, which lets the loop vectorize without alias checks.
+void madgwick_step(float* __restrict q0, float* __restrict q1, float* __restrict q2, float* __restrict q3,
+	const float* __restrict ax, const float* __restrict ay, const float* __restrict az,
+	const float* __restrict gx, const float* __restrict gy, const float* __restrict gz,
+	const float* __restrict dt, float beta, std::size_t begin, std::size_t end) {
+
+	for (std::size_t i = begin; i < end; ++i) {
+
+		// rate of change of the quaternion from the gyroscope
+		float qDot0 = 0.5f * (-q1[i] * gx[i] - q2[i] * gy[i] - q3[i] * gz[i]);
+		float qDot1 = 0.5f * (q0[i] * gx[i] + q2[i] * gz[i] - q3[i] * gy[i]);
+		float qDot2 = 0.5f * (q0[i] * gy[i] - q1[i] * gz[i] + q3[i] * gx[i]);
+		float qDot3 = 0.5f * (q0[i] * gz[i] + q1[i] * gy[i] - q2[i] * gx[i]);
+
+		// corrective step towards gravity, skipped (gain 0) without accelerometer data
+		// (no branches: a zero vector stays zero thanks to TINY, has_accel is 0 or 1)
+		float norm = ax[i] * ax[i] + ay[i] * ay[i] + az[i] * az[i];
+		float has_accel = norm / (norm + TINY);
+		float recip = 1.0f / std::sqrt(norm + TINY);
+		float a0 = ax[i] * recip;
+		float a1 = ay[i] * recip;
+		float a2 = az[i] * recip;
+
+		float _2q0 = 2.0f * q0[i];
+		float _2q1 = 2.0f * q1[i];
+		float _2q2 = 2.0f * q2[i];
+		float _2q3 = 2.0f * q3[i];
+		float _4q0 = 4.0f * q0[i];
+		float _4q1 = 4.0f * q1[i];
+		float _4q2 = 4.0f * q2[i];
+		float _8q1 = 8.0f * q1[i];
+		float _8q2 = 8.0f * q2[i];
+		float q0q0 = q0[i] * q0[i];
+		float q1q1 = q1[i] * q1[i];
+		float q2q2 = q2[i] * q2[i];
+		float q3q3 = q3[i] * q3[i];
+
+		// gradient descent
+		float s0 = _4q0 * q2q2 + _2q2 * a0 + _4q0 * q1q1 - _2q1 * a1;
+		float s1 = _4q1 * q3q3 - _2q3 * a0 + 4.0f * q0q0 * q1[i] - _2q0 * a1 - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * a2;
+		float s2 = 4.0f * q0q0 * q2[i] + _2q0 * a0 + _4q2 * q3q3 - _2q3 * a1 - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * a2;
+		float s3 = 4.0f * q1q1 * q3[i] - _2q1 * a0 + 4.0f * q2q2 * q3[i] - _2q2 * a1;
+
+		float s_norm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+		float s_recip = beta * has_accel / std::sqrt(s_norm + TINY);
+
+		qDot0 -= s0 * s_recip;
+		qDot1 -= s1 * s_recip;
+		qDot2 -= s2 * s_recip;
+		qDot3 -= s3 * s_recip;
+
+		// integrate, filters without sample have dt 0
+		float w = q0[i] + qDot0 * dt[i];
+		float x = q1[i] + qDot1 * dt[i];
+		float y = q2[i] + qDot2 * dt[i];
+		float z = q3[i] + qDot3 * dt[i];
+
+		float q_recip = 1.0f / std::sqrt(w * w + x * x + y * y + z * z);
+		q0[i] = w * q_recip;
+		q1[i] = x * q_recip;
+		q2[i] = y * q_recip;
+		q3[i] = z * q_recip;
+	}
+}
+
+} // namespace
+
+/* ------ IMUCALIBRATION ------ */
+
+IMUCalibration::IMUCalibration() {
+	for (int i = 0; i < 3; ++i) {
+		accel_scale[i] = 4.0f / 16384.0f;
+		gyro_offset[i] = 0.0f;
+		gyro_scale[i] = 936.0f / 13371.0f * DEG_TO_RAD;
+	}
+}
+
+IMUCalibration::IMUCalibration(const SensorCalibration& calib) : IMUCalibration() {
+
+	// acc origin x,y,z | acc sensitivity x,y,z | gyro origin x,y,z | gyro sensitivity x,y,z (int16, little endian)
+	ByteVector cal = calib.factory_sensor_cal;
+	const ByteVector& user = calib.user_sensor_cal;
+	if (user.size() == 0x1A && user[0] == 0xB2 && user[1] == 0xA1) {
+		cal.assign(user.begin() + 2, user.end());
+	}
+
+	if (cal.size() != 0x18) {
+		return;		// not read, keep the nominal values
+	}
+
+	for (std::size_t i = 0; i < 3; ++i) {
+		int acc_range = read_int16(cal, 3 + i) - read_int16(cal, i);
+		int gyro_range = read_int16(cal, 9 + i) - read_int16(cal, 6 + i);
+
+		// erased flash (FF FF) or garbage
+		if (acc_range > 0) {
+			accel_scale[i] = 4.0f / acc_range;
+		}
+		if (gyro_range > 0) {
+			gyro_offset[i] = read_int16(cal, 6 + i);
+			gyro_scale[i] = 936.0f / gyro_range * DEG_TO_RAD;
+		}
+	}
+}
+
+/* ------ FUSIONBANK ------ */
+
+constexpr float FusionBank::SAMPLE_PERIOD;
+
+FusionBank::FusionBank(std::size_t filters, float beta)
+	: beta(beta), qw(filters, 1.0f), qx(filters), qy(filters), qz(filters),
+	ax(filters), ay(filters), az(filters), gx(filters), gy(filters), gz(filters), dt(filters) {
+
+	IMUCalibration nominal;
+	for (int i = 0; i < 3; ++i) {
+		accel_scale[i].assign(filters, nominal.accel_scale[i]);
+		gyro_offset[i].assign(filters, nominal.gyro_offset[i]);
+		gyro_scale[i].assign(filters, nominal.gyro_scale[i]);
+	}
+}
+
+void FusionBank::set_calibration(std::size_t idx, const IMUCalibration& calib) {
+	for (int i = 0; i < 3; ++i) {
+		accel_scale[i].at(idx) = calib.accel_scale[i];
+		gyro_offset[i].at(idx) = calib.gyro_offset[i];
+		gyro_scale[i].at(idx) = calib.gyro_scale[i];
+	}
+}
+
+void FusionBank::reset(std::size_t idx) {
+	qw.at(idx) = 1.0f;
+	qx[idx] = qy[idx] = qz[idx] = 0.0f;
+}
+
+void FusionBank::update(const StandardReport* const* reports) {
+	std::size_t samples = 0;
+	for (std::size_t i = 0; i < size(); ++i) {
+		if (reports[i] != nullptr) {
+			samples = std::max<std::size_t>(samples, reports[i]->IMU_samples);
+		}
+	}
+
+	for (std::size_t sample = 0; sample < samples; ++sample) {
+		for (std::size_t i = 0; i < size(); ++i) {
+			this->load_sample(i, reports[i], sample);
+		}
+		this->step(0, size());
+	}
+}
+
+void FusionBank::update(std::size_t idx, const StandardReport& report) {
+	if (idx >= size()) {
+		throw std::out_of_range("filter index out of range.");
+	}
+	for (std::size_t sample = 0; sample < report.IMU_samples; ++sample) {
+		this->load_sample(idx, &report, sample);
+		this->step(idx, idx + 1);
+	}
+}
+
+Quaternion FusionBank::orientation(std::size_t idx) const {
+	Quaternion q;
+	q.w = qw.at(idx);
+	q.x = qx[idx];
+	q.y = qy[idx];
+	q.z = qz[idx];
+	return q;
+}
+
+void FusionBank::load_sample(std::size_t idx, const StandardReport* report, std::size_t sample) {
+
+	if (report == nullptr || sample >= report->IMU_samples) {
+		ax[idx] = ay[idx] = az[idx] = gx[idx] = gy[idx] = gz[idx] = dt[idx] = 0.0f;
+		return;
+	}
+
+	const IMUSample& s = report->IMU[sample];
+	ax[idx] = s.accel[0] * accel_scale[0][idx];
+	ay[idx] = s.accel[1] * accel_scale[1][idx];
+	az[idx] = s.accel[2] * accel_scale[2][idx];
+	gx[idx] = (s.gyro[0] - gyro_offset[0][idx]) * gyro_scale[0][idx];
+	gy[idx] = (s.gyro[1] - gyro_offset[1][idx]) * gyro_scale[1][idx];
+	gz[idx] = (s.gyro[2] - gyro_offset[2][idx]) * gyro_scale[2][idx];
+	dt[idx] = SAMPLE_PERIOD;
+}
+
+void FusionBank::step(std::size_t begin, std::size_t end) {
+	madgwick_step(qw.data(), qx.data(), qy.data(), qz.data(), ax.data(), ay.data(), az.data(), gx.data(), gy.data(), gz.data(), dt.data(), beta, begin, end);
+}
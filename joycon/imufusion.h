@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "report.h"
+#include "types.h"
+
+struct Quaternion {
+	float w = 1.0f;
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+};
+
+// Converts raw IMU samples to g and rad/s.
+// Built from the user sensor calibration if one is stored (magic B2 A1), else from the factory one.
+struct IMUCalibration {
+	float accel_scale[3];	// g per LSB
+	float gyro_offset[3];	// LSB
+	float gyro_scale[3];	// rad/s per LSB
+
+	// nominal values: +-8g, +-2000dps
+	IMUCalibration();
+	explicit IMUCalibration(const SensorCalibration& calib);
+};
+
+// Madgwick filter (gyro + accel, no magnetometer) for many devices at once. The quaternion rotates sensor frame to world frame.
+// The state is a structure of arrays and a step is one branch free loop over the filters, so the compiler can
+// vectorize it across the filters of a batched update(). The samples of a report are applied one after another.
+// The reader of a Joycon fuses on its own, with a bank of one filter: the reports of different devices arrive
+// independently, batching them would make every device wait for the others.
+class FusionBank {
+public:
+	static constexpr float SAMPLE_PERIOD = 0.005f;	// 3 samples per 15ms report
+
+	explicit FusionBank(std::size_t filters, float beta = 0.1f);
+
+	std::size_t size() const { return qw.size(); }
+
+	void set_calibration(std::size_t idx, const IMUCalibration& calib);
+
+	// higher converges faster to gravity, but follows accelerations more
+	void set_beta(float gain) { beta = gain; }
+
+	void reset(std::size_t idx);
+
+	// reports[i] belongs to filter i, e.g. a consumer fusing the reports of many devices at once. Steps as many
+	// samples as the reports carry, filters without report (nullptr) or with fewer samples keep their orientation.
+	void update(const StandardReport* const* reports);
+
+	// single filter, e.g. in the reader of one device
+	void update(std::size_t idx, const StandardReport& report);
+
+	Quaternion orientation(std::size_t idx) const;
+
+private:
+	// converts sample of report into the scratch arrays at idx
+	void load_sample(std::size_t idx, const StandardReport* report, std::size_t sample);
+
+	// one Madgwick step for the filters [begin, end)
+	void step(std::size_t begin, std::size_t end);
+
+	float beta;
+
+	std::vector<float> qw, qx, qy, qz;
+
+	std::vector<float> accel_scale[3];
+	std::vector<float> gyro_offset[3];
+	std::vector<float> gyro_scale[3];
+
+	// scratch: current sample, dt is 0 for filters without one
+	std::vector<float> ax, ay, az, gx, gy, gz, dt;
+};
@@ -1,22 +1,31 @@
 #include <algorithm>
 #include <chrono>
+#include <deque>
 #include <iostream>
 #include <sstream>
 #include <unordered_set>
 #include <mutex>
 
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
 #include "joycon.h"
 #include "buffer.h"
+#include "log.h"
 
-Joycon::Joycon(JOY_PID PID, wchar_t* serial_number) : package_number(0) {
+Joycon::Joycon(JOY_PID PID, wchar_t* serial_number, const char* path, DeviceCache* cache)
+	: cache(cache), PID(PID), serial(serial_number ? serial_number : L""), path(path ? path : ""), package_number(0), commands([this](OutputBuffer& buff_out) { this->write_report(buff_out); }, &link_metrics) {
 	
-	std::cout << "Adding device:" << std::endl;
-	std::cout << "PID: " << std::hex << PID << std::endl;
-	std::wcout << L"SN : " << serial_number << std::endl;
+	LOG(LOG_INFO) << "Adding device:";
+	LOG(LOG_INFO) << "PID: " << LogHex(PID);
+	LOG(LOG_INFO) << "SN : " << serial_number;
 
-	handle = hid_open(JOYCON_VENDOR, PID, serial_number);
-
-	if(handle == nullptr) {
+	if(!this->open_transport()) {
 		std::string error("");
 		error += "Handle could not be set!\n";
 		error += "You need to run this program as sudo maybe?"; //TODO FIX THIS!!!
@@ -26,62 +35,113 @@ Joycon::Joycon(JOY_PID PID, wchar_t* serial_number) : package_number(0) {
 	try {
 		this->printDeviceInfo();
 
-		std::cout << "Enabling vibration..." << std::endl;
+		LOG(LOG_INFO) << "Enabling vibration...";
 		this->enable_vibration(true);
 
-		std::cout << "Enabling IMU..." << std::endl;
+		LOG(LOG_INFO) << "Enabling IMU...";
 		this->enable_IMU(true);
 
-		std::cout << "Increasing data rate for Bluetooth..." << std::endl;
+		LOG(LOG_INFO) << "Increasing data rate for Bluetooth...";
 		this->set_input_report_mode(0x30);
 
-		std::cout << "Reading SPI calibration..." << std::endl;
-		// this->sensorCalib = this->get_sensor_calibration();
+		LOG(LOG_INFO) << "Reading device info and SPI calibration...";
+		this->load_device_data(serial_number);
 
 	} catch (std::exception& e) {
-		hid_close(handle);
+		if (validate_thread.joinable())
+			validate_thread.join();
+		transport.close();
 		THROW("Constructor failed to initialize: " + e.what());
 	}
 }
 
 Joycon::~Joycon() {
+	if (validate_thread.joinable())
+		validate_thread.join();
+
+	// writes through the transport
+	rumble.reset();
+
 	alive = false;
 
 	if (callback_thread.joinable())
 		callback_thread.join();
 
-	hid_close(handle);
+#ifdef JOYCON_HIDRAW_REACTOR
+	commands.set_activity_hook(nullptr);
+	if (reactor != nullptr) {
+		reactor->remove(hidraw_fd);
+		reactor->remove(timer_fd);
+	}
+	if (hidraw_fd != -1) {
+		close(hidraw_fd);
+	}
+	if (timer_fd != -1) {
+		close(timer_fd);
+	}
+#endif
+
+	transport.close();
+}
+
+bool Joycon::open_transport() {
+	// hidapi does not promise a thread safe open, devices are brought up in parallel
+	static std::mutex open_mutex;
+	std::lock_guard<std::mutex> lock(open_mutex);
+	return transport.open(PID, serial.c_str(), path);
 }
 
 void Joycon::printDeviceInfo() const {
 
 	std::lock_guard<std::mutex> lock(hid_mutex);
 
-	std::cout << "Device Info:" << std::endl;
+	LOG(LOG_INFO) << "Device Info:";
 	
 	wchar_t wstr[MAX_STR];
 
 	// Read the Manufacturer String
-	CHECK(hid_get_manufacturer_string(handle, wstr, MAX_STR));
-	std::wcout << L"	Manufacturer String: " << wstr << std::endl;
+	CHECK(transport.get_manufacturer_string(wstr, MAX_STR));
+	LOG(LOG_INFO) << "	Manufacturer String: " << wstr;
 
 	// Read the Product String
-	CHECK(hid_get_product_string(handle, wstr, MAX_STR));
-	std::wcout << L"	Product String: " << wstr << std::endl;
+	CHECK(transport.get_product_string(wstr, MAX_STR));
+	LOG(LOG_INFO) << "	Product String: " << wstr;
 
 	// Read the Serial Number String
-	CHECK(hid_get_serial_number_string(handle, wstr, MAX_STR));
-	std::wcout << L"	Serial Number String: (" << wstr[0] << ") " << wstr << std::endl;
+	CHECK(transport.get_serial_number_string(wstr, MAX_STR));
+	LOG(LOG_INFO) << "	Serial Number String: (" << std::wstring(1, wstr[0]) << ") " << wstr;
 
 	// Read Indexed String 1
 	//CHECK(hid_get_indexed_string(handle, 1, wstr, MAX_STR));
 	//std::wcout << L"	Indexed String 1: " << wstr << std::endl;
 }
 
-InputBuffer Joycon::send_command(unsigned char cmd, unsigned char subcmd, const ByteVector& data, bool blocking, Rumble rumble) {
+InputBuffer Joycon::send_command(unsigned char cmd, unsigned char subcmd, ByteView data, bool blocking, Rumble rumble) {
 
-	std::lock_guard<std::mutex> lock(hid_mutex);
-	if (blocking) { CHECK(hid_set_nonblocking(handle, 0)); }
+	OutputBuffer buff_out(data.size());
+	buff_out.set_cmd(cmd);
+	buff_out.set_subcmd(subcmd);
+	buff_out.set_data(data);
+	buff_out.set_rumble_left(rumble);
+	buff_out.set_rumble_right(rumble);
+
+	LOG(LOG_DEBUG) << "	sending : " << buff_out;
+
+	if (!blocking) {
+		this->write_report(buff_out);
+		return InputBuffer();
+	}
+
+	std::future<InputBuffer> reply = this->submit_command(buff_out, std::chrono::milliseconds(100), 2);
+	InputBuffer buff_in = this->wait_reply(reply);
+
+	LOG(LOG_DEBUG) << "	received: " << buff_in;
+
+	return buff_in;
+}
+
+std::future<InputBuffer> Joycon::send_command_async(unsigned char cmd, unsigned char subcmd, ByteView data, Rumble rumble,
+	std::chrono::milliseconds timeout, unsigned int retries) {
 
 	OutputBuffer buff_out(data.size());
 	buff_out.set_cmd(cmd);
@@ -89,24 +149,88 @@ InputBuffer Joycon::send_command(unsigned char cmd, unsigned char subcmd, const
 	buff_out.set_data(data);
 	buff_out.set_rumble_left(rumble);
 	buff_out.set_rumble_right(rumble);
+
+	return commands.submit(std::move(buff_out), timeout, retries);
+}
+
+void Joycon::write_report(OutputBuffer& buff_out) {
+
+	std::lock_guard<std::mutex> lock(hid_mutex);
+
+	if (lost.load(std::memory_order_acquire)) {
+		THROW("Device is not connected!");
+	}
+
 	buff_out.set_GP(package_number & 0x0F);
+	if (transport.write(buff_out.data(), buff_out.size()) == -1) {
+		LinkMetrics::increment(link_metrics.write_failures);
+		THROW("transport.write(buff_out.data(), buff_out.size()) failed!");
+	}
+	++package_number;
 
-	std::cout << "	sending : " << buff_out << std::endl;
+	if (ReportRecorder* rec = recorder.load(std::memory_order_acquire)) {
+		rec->record(RECORD_OUTPUT, recorder_device.load(std::memory_order_relaxed), buff_out.view());
+	}
+}
 
-	CHECK(hid_write(handle, buff_out.data(), buff_out.size()));
+InputBuffer Joycon::wait_reply(std::future<InputBuffer>& reply) {
 
-	InputBuffer buff_in;
-	if (blocking) {
-		CHECK(hid_read(handle, buff_in.data(), buff_in.size()));
+	while (reply.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
 
-		std::cout << "	received: " << buff_in << std::endl;
+		if (capturing) {
+			// the reader delivers the reply and checks the deadlines
+			reply.wait();
+			break;
+		}
 
-		CHECK(hid_set_nonblocking(handle, 1)); 
+		// another thread is already reading for both of us
+		if (!this->pump_reports()) {
+			reply.wait_for(std::chrono::milliseconds(5));
+		}
 	}
 
-	++package_number;
+	return reply.get();
+}
 
-	return buff_in;
+std::future<InputBuffer> Joycon::submit_command(OutputBuffer& buff_out, std::chrono::milliseconds timeout, unsigned int retries, std::size_t echo) {
+
+	std::future<InputBuffer> reply;
+	while (!commands.try_submit(buff_out, reply, timeout, retries, echo)) {
+
+		// the commands of other threads fill the queue, they are done or failed after their retries
+		if (capturing || !this->pump_reports()) {
+			commands.wait_free(std::chrono::milliseconds(5));
+		}
+	}
+
+	return reply;
+}
+
+bool Joycon::pump_reports() {
+
+	std::unique_lock<std::mutex> lock(pump_mutex, std::try_to_lock);
+	if (!lock.owns_lock()) {
+		return false;
+	}
+
+	// captured while waiting for the lock: only the reader may read now
+	if (capturing) {
+		return true;
+	}
+
+	// closed by detach(), the commands in flight are failed
+	if (lost.load(std::memory_order_acquire)) {
+		return false;
+	}
+
+	InputBuffer buff_in;
+	int res = transport.read_timeout(buff_in.data(), buff_in.size(), 5);
+	CHECK(res);
+	if (res > 0) {
+		this->process_report(buff_in, LinkMonitor::Clock::now());
+	}
+	commands.poll();
+	return true;
 }
 
 void Joycon::callback() {
@@ -116,30 +240,325 @@ void Joycon::callback() {
 		buff_in.clean();
 
 		// Read requested state
-		{
-			std::lock_guard<std::mutex> lock(hid_mutex);
-			CHECK(hid_read(handle, buff_in.data(), buff_in.size()));
+		if (transport.read(buff_in.data(), buff_in.size()) == -1) {
+			this->on_lost();
+			return;
 		}
+		const LinkMonitor::Clock::time_point arrival = LinkMonitor::Clock::now();
+
+		commands.poll();
 
 		if (buff_in.get_ID() == 0x00) {
 			continue;
 		}
 
-		std::cout << buff_in << std::endl;
+		this->process_report(buff_in, arrival);
+	}
+}
+
+void Joycon::process_report(const InputBuffer& buff_in, LinkMonitor::Clock::time_point arrival) {
+
+	if (ReportRecorder* rec = recorder.load(std::memory_order_acquire)) {
+		rec->record(RECORD_INPUT, recorder_device.load(std::memory_order_relaxed), buff_in.view());
 	}
+
+	LOG(LOG_TRACE) << "report: " << buff_in;
+
+	link_monitor.on_report(buff_in.get_ID(), buff_in.get_timer(), arrival);
+
+	commands.on_report(buff_in);
+
+	// decode once, every consumer gets the same report
+	StandardReport report;
+	if (!decode_report(buff_in, PID, report)) {
+		return;
+	}
+
+	// 0x3F has no timer
+	const uint64_t arrival_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(arrival.time_since_epoch()).count();
+	report.timestamp_ns = report.ID == 0x3F ? arrival_ns : device_clock.on_report(report.timer, arrival_ns);
+
+#ifdef __linux__
+	if (UinputGamepad* pad = gamepad.load(std::memory_order_acquire)) {
+		pad->emit(report, PID, arrival);
+	}
+#endif
+
+	ButtonEvent event;
+	if (button_edges(last_buttons, report, event)) {
+		button_events.push(event);
+	}
+	last_buttons = report.buttons;
+
+	if (report.IMU_samples > 0) {
+		this->fuse(report);
+	}
+	latest.store(report);
+	reports.push(report);
+	LinkMetrics::update_max(link_metrics.report_queue_max, reports.size());
+}
+
+void Joycon::on_lost() {
+	LOG(LOG_WARNING) << "Lost device " << this->get_path();
+	lost.store(true, std::memory_order_release);
+
+	// nobody reads the replies anymore
+	commands.abort("Device lost!");
+}
+
+LinkSnapshot Joycon::metrics() const {
+	LinkSnapshot res = link_metrics.snapshot();
+	res.commands_in_flight = commands.in_flight();
+	res.report_queue = reports.size();
+	res.reports_dropped = reports.overflows();
+	return res;
+}
+
+void Joycon::fuse(StandardReport& report) {
+
+	if (fusion_calibrate.exchange(false)) {
+		std::lock_guard<std::mutex> lock(info_mutex);
+		fusion.set_calibration(0, IMUCalibration(sensorCalib));
+		fusion.set_beta(fusion_beta);
+	}
+	if (fusion_reset.exchange(false)) {
+		fusion.reset(0);
+	}
+
+	fusion.update(0, report);
+
+	Quaternion q = fusion.orientation(0);
+	report.orientation[0] = q.w;
+	report.orientation[1] = q.x;
+	report.orientation[2] = q.y;
+	report.orientation[3] = q.z;
+}
+
+void Joycon::set_fusion_gain(float beta) {
+	fusion_beta = beta;
+	fusion_calibrate = true;
+}
+
+void Joycon::set_recorder(ReportRecorder* rec, uint16_t device) {
+	recorder_device = device;
+	recorder.store(rec, std::memory_order_release);
 }
 
 void Joycon::capture() {
 
-	CHECK(hid_set_nonblocking(handle, 1));
+	// the validation of the cached device data may be reading in pump_reports() right now
+	std::lock_guard<std::mutex> pump(pump_mutex);
+	CHECK(transport.set_nonblocking(1));
+	capturing = true;
 	callback_thread = std::thread(&Joycon::callback, this);
 }
 
+void Joycon::start_reader() {
+#ifdef JOYCON_HIDRAW_REACTOR
+	if (reactor != nullptr) {
+		this->open_hidraw();
+		reactor->add(hidraw_fd, [this]() { return this->on_readable(); }, [this]() { this->on_lost(); });
+		return;
+	}
+#endif
+	CHECK(transport.set_nonblocking(1));
+	callback_thread = std::thread(&Joycon::callback, this);
+}
+
+void Joycon::detach() {
+	lost.store(true, std::memory_order_release);
+
+#ifdef JOYCON_HIDRAW_REACTOR
+	if (hidraw_fd != -1) {
+		if (reactor != nullptr) {
+			reactor->remove(hidraw_fd);
+		}
+		close(hidraw_fd);
+		hidraw_fd = -1;
+	}
+#endif
+
+	alive = false;
+	if (callback_thread.joinable())
+		callback_thread.join();
+	alive = true;
+
+	commands.abort("Device detached!");
+
+	// before capture() a thread waiting for a reply may be reading in pump_reports()
+	std::lock_guard<std::mutex> pump(pump_mutex);
+	std::lock_guard<std::mutex> lock(hid_mutex);
+	transport.close();
+}
+
+void Joycon::reconnect(const std::string& new_path) {
+
+	this->detach();
+
+	const auto start = std::chrono::steady_clock::now();
+	{
+		std::lock_guard<std::mutex> pump(pump_mutex);
+		std::lock_guard<std::mutex> lock(hid_mutex);
+		{
+			std::lock_guard<std::mutex> lock_path(path_mutex);
+			path = new_path;
+		}
+		if (!this->open_transport()) {
+			THROW("Could not open " + new_path);
+		}
+	}
+
+	// a new link: the reader (not running) starts from scratch, the timer of the device too
+	device_clock.reset();
+	link_monitor.reset();
+	lost.store(false, std::memory_order_release);
+	if (capturing) {
+		try {
+			this->start_reader();
+		} catch (...) {
+			this->detach();
+			throw;
+		}
+	}
+	LinkMetrics::increment(link_metrics.reconnects);
+
+	const std::size_t failed = this->replay_state();
+	LOG(LOG_INFO) << "Reconnected " << new_path << " in "
+		<< static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()) << "ms";
+	if (failed > 0) {
+		LOG(LOG_WARNING) << failed << " settings could not be restored";
+	}
+}
+
+std::size_t Joycon::replay_state() {
+
+	const DeviceState replay = this->configured_state();
+
+	std::size_t failed = 0;
+	std::vector<std::future<InputBuffer>> replies;
+	auto submit = [&](unsigned char cmd, unsigned char subcmd, ByteView data) {
+		try {
+			replies.push_back(this->send_command_async(cmd, subcmd, data));
+		} catch (std::exception& e) {
+			LOG(LOG_WARNING) << "Restoring subcommand " << LogHex(subcmd) << " failed: " << e.what();
+			++failed;
+		}
+	};
+
+	// all in flight at once, the reader (or wait_reply() before capture()) collects the replies. The report mode first: full reports come back the soonest.
+	const byte irm = replay.input_report_mode;
+	submit(irm <= 0x02 ? 0x11 : 0x01, 0x03, { irm });
+	submit(0x01, 0x40, { static_cast<unsigned char>(replay.IMU) });
+	if (replay.has_IMU_sensitivity) {
+		submit(0x01, 0x41, replay.IMU_sensitivity);
+	}
+	submit(0x01, 0x48, { static_cast<unsigned char>(replay.vibration) });
+	if (replay.has_player_lights) {
+		submit(0x01, 0x30, { static_cast<unsigned char>(replay.player_lights) });
+	}
+	if (replay.has_home_light) {
+		submit(0x01, 0x38, replay.home_light.data());
+	}
+
+	for (std::future<InputBuffer>& reply : replies) {
+		try {
+			this->wait_reply(reply);
+		} catch (std::exception& e) {
+			LOG(LOG_WARNING) << "Restoring a setting failed: " << e.what();
+			++failed;
+		}
+	}
+	return failed;
+}
+
+DeviceState Joycon::configured_state() const {
+	std::lock_guard<std::mutex> lock(state_mutex);
+	return configured;
+}
+
+ByteArray<6> Joycon::mac() const {
+	ByteArray<6> res{};
+	parse_mac(this->device_info().mac, res);
+	return res;
+}
+
+#ifdef JOYCON_HIDRAW_REACTOR
+void Joycon::open_hidraw() {
+
+	const std::string hidraw_path = this->get_path();
+	if (hidraw_path.empty()) {
+		THROW("No hidraw path known for this device!");
+	}
+
+	hidraw_fd = open(hidraw_path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (hidraw_fd == -1) {
+		THROW("Could not open " + hidraw_path + ": " + std::strerror(errno));
+	}
+}
+
+void Joycon::capture(ReactorPool& pool) {
+
+	// see capture()
+	std::lock_guard<std::mutex> pump(pump_mutex);
+	this->open_hidraw();
+
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (timer_fd == -1) {
+		THROW(std::string("timerfd_create failed: ") + std::strerror(errno));
+	}
+
+	capturing = true;
+	reactor = &pool.add(hidraw_fd, [this]() { return this->on_readable(); }, [this]() { this->on_lost(); });
+	reactor->add(timer_fd, [this]() { return this->on_command_timer(); });
+
+	// only tick while commands are in flight
+	commands.set_activity_hook([this](bool active) { this->arm_command_timer(active); });
+	this->arm_command_timer(commands.in_flight() > 0);
+}
+
+bool Joycon::on_readable() {
+
+	InputBuffer buff_in;
+	while (true) {
+		buff_in.clean();
+
+		ssize_t res = read(hidraw_fd, buff_in.data(), buff_in.size());
+		if (res > 0) {
+			this->process_report(buff_in, LinkMonitor::Clock::now());
+		} else if (res == -1 && errno == EINTR) {
+			continue;
+		} else if (res == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return true;	// drained
+		} else {
+			this->on_lost();
+			return false;
+		}
+	}
+}
+
+bool Joycon::on_command_timer() {
+	uint64_t expirations;
+	while (read(timer_fd, &expirations, sizeof(expirations)) > 0) {}
+
+	commands.poll();
+	return true;
+}
+
+void Joycon::arm_command_timer(bool active) {
+	itimerspec spec{};
+	if (active) {
+		spec.it_value.tv_nsec = 5000000;	// 5ms
+		spec.it_interval.tv_nsec = 5000000;
+	}
+	timerfd_settime(timer_fd, 0, &spec, nullptr);
+}
+#endif
+
 JoyconDeviceInfo Joycon::request_device_info() {
 	InputBuffer buff_in = this->send_command(0x01, 0x02, {}, true);
 
 	JoyconDeviceInfo info;
-	ByteVector data = buff_in.get_reply_data(0, 12);
+	ByteView data = buff_in.get_reply_data(0, 12);
 	info.firmwareVersion = std::to_string(data[0]) + "." + std::to_string(data[1]);
 	info.joyconType = data[2];
 	info.mac = to_hex_string(data, 4, 6, "", ":");
@@ -148,6 +567,125 @@ JoyconDeviceInfo Joycon::request_device_info() {
 	return info;
 }
 
+JoyconDeviceInfo Joycon::device_info() const {
+	std::lock_guard<std::mutex> lock(info_mutex);
+	return info;
+}
+
+SensorCalibration Joycon::calibration() const {
+	std::lock_guard<std::mutex> lock(info_mutex);
+	return sensorCalib;
+}
+
+Color24 Joycon::body_color() const {
+	std::lock_guard<std::mutex> lock(info_mutex);
+	return body_RGB;
+}
+
+Color24 Joycon::button_color() const {
+	std::lock_guard<std::mutex> lock(info_mutex);
+	return button_RGB;
+}
+
+void Joycon::load_device_data(const wchar_t* serial_number) {
+
+	// the serial number of a Bluetooth controller is its MAC
+	std::string serial;
+	for (const wchar_t* c = serial_number; c != nullptr && *c != L'\0'; ++c) {
+		serial += static_cast<char>(*c < 0x80 ? *c : '?');
+	}
+
+	DeviceRecord record;
+	ByteArray<6> mac;
+	if (cache != nullptr && parse_mac(serial, mac) && cache->find(mac, record)) {
+		LOG(LOG_INFO) << "Using cached device data";
+		this->apply_device_data(record);
+		validate_thread = std::thread(&Joycon::validate_device_data, this, record);
+		return;
+	}
+
+	record = this->read_device_data();
+	this->apply_device_data(record);
+	if (cache != nullptr) {
+		cache->store(record);
+	}
+}
+
+DeviceRecord Joycon::read_device_data() {
+
+	DeviceRecord record;
+	record.info = this->request_device_info();
+	if (!parse_mac(record.info.mac, record.mac)) {
+		throw std::runtime_error("Invalid MAC address " + record.info.mac);
+	}
+
+	// one batched read: calibration, colors and the validation ranges share most chunks
+	std::vector<SPIRange> ranges = {
+		{ 0x6020, 0x18 },	// factory_sensor_cal
+		{ 0x603D, 0x12 },	// factory_stick_cal
+		{ 0x6080, 0x06 },	// sensor_model
+		{ 0x6086, 0x12 },	// stick_model1
+		{ 0x6098, 0x12 },	// stick_model2
+		{ 0x8010, 0x16 },	// user_stick_cal
+		{ 0x8026, 0x1A },	// user_sensor_cal
+		{ 0x6050, 0x06 }	// body + button color
+	};
+	const std::size_t validation_idx = ranges.size();
+	ranges.insert(ranges.end(), DeviceCache::validation_ranges().begin(), DeviceCache::validation_ranges().end());
+
+	std::vector<ByteVector> data = this->SPI_flash_read(ranges);
+
+	record.calib.factory_sensor_cal	= std::move(data[0]);
+	record.calib.factory_stick_cal	= std::move(data[1]);
+	record.calib.sensor_model		= std::move(data[2]);
+	record.calib.stick_model1		= std::move(data[3]);
+	record.calib.stick_model2		= std::move(data[4]);
+	record.calib.user_stick_cal		= std::move(data[5]);
+	record.calib.user_sensor_cal	= std::move(data[6]);
+	record.body_color	= { data[7][0], data[7][1], data[7][2] };
+	record.button_color	= { data[7][3], data[7][4], data[7][5] };
+
+	record.checksum = 0;
+	for (std::size_t i = validation_idx; i < data.size(); ++i) {
+		record.checksum = DeviceCache::checksum(data[i], record.checksum);
+	}
+
+	return record;
+}
+
+void Joycon::apply_device_data(const DeviceRecord& record) {
+	std::lock_guard<std::mutex> lock(info_mutex);
+	info = record.info;
+	sensorCalib = record.calib;
+	fusion_calibrate = true;
+	body_RGB = record.body_color;
+	button_RGB = record.button_color;
+}
+
+void Joycon::validate_device_data(DeviceRecord cached) {
+
+	try {
+		JoyconDeviceInfo current = this->request_device_info();
+
+		uint32_t checksum = 0;
+		for (const ByteVector& data : this->SPI_flash_read(DeviceCache::validation_ranges())) {
+			checksum = DeviceCache::checksum(data, checksum);
+		}
+
+		if (current.firmwareVersion == cached.info.firmwareVersion && current.mac == cached.info.mac && checksum == cached.checksum) {
+			return;
+		}
+
+		LOG(LOG_INFO) << "Cached device data of " << cached.info.mac << " is outdated, reading it again...";
+		DeviceRecord record = this->read_device_data();
+		this->apply_device_data(record);
+		cache->store(record);
+
+	} catch (std::exception& e) {
+		LOG(LOG_WARNING) << "Validating the cached device data failed: " << e.what();
+	}
+}
+
 void Joycon::set_input_report_mode(unsigned char irm) {
 	check_input_arguments({ 0x00, 0x01, 0x02, 0x23, 0x30, 0x31, 0x3F }, irm, "Invalid input-report-mode");
 
@@ -158,13 +696,16 @@ void Joycon::set_input_report_mode(unsigned char irm) {
 	}
 
 	this->send_command(cmd, 0x03, { irm }, true);
+
+	std::lock_guard<std::mutex> lock(state_mutex);
+	configured.input_report_mode = irm;
 }
 
 TriggerButtonElapsedTime Joycon::trigger_button_elapsed_time() {
 	InputBuffer buff_in = this->send_command(0x01, 0x04, {}, true);
 
 	TriggerButtonElapsedTime res;
-	ByteVector data = buff_in.get_reply_data(0, 14);
+	ByteView data = buff_in.get_reply_data(0, 14);
 	res.L = std::chrono::milliseconds(to_int(data, 0, 2, false));
 	res.R = std::chrono::milliseconds(to_int(data, 2, 2, false));
 	res.ZL = std::chrono::milliseconds(to_int(data, 4, 2, false));
@@ -194,30 +735,59 @@ void Joycon::set_shipment(bool enable) {
 }
 #endif
 
-ByteVector Joycon::SPI_flash_read(unsigned int address, unsigned char length) {
+ByteVector Joycon::SPI_flash_read(unsigned int address, std::size_t length) {
+	return std::move(this->SPI_flash_read({ { address, length } }).front());
+}
 
-	if (address > 0xFFFFFFFF) {
-		throw std::invalid_argument("Address can only have 4 byte!");
-	}
+std::vector<ByteVector> Joycon::SPI_flash_read(const std::vector<SPIRange>& ranges, std::size_t max_in_flight) {
 
-	if (length > 0x1D) {
-		throw std::runtime_error("length must be less than 0x1D.");
+	max_in_flight = std::max<std::size_t>(1, std::min(max_in_flight, CommandQueue::MAX_IN_FLIGHT));
+
+	SPIReader reader;
+	for (const SPIRange& range : ranges) {
+		reader.add(range.address, range.length);
 	}
 
-	ByteVector data_send(5);
-	to_byte_container(address, data_send, 0, 4, false);
-	data_send[4] = length;
+	const std::vector<SPIRange>& chunks = reader.chunks();
 
-	InputBuffer buff_in = this->send_command(0x01, 0x10, data_send, true);
+	// replies echo address + length -> reads in flight can not be mixed up
+	std::deque<std::pair<std::size_t, std::future<InputBuffer>>> in_flight;
+	std::size_t next = 0;
 
-	if (buff_in.get_subcommandID_reply() != 0x90 || 
-		to_int(buff_in.get_reply_data(0, 4), false) != address ||
-		buff_in.get_reply_data_at(4) != length) 
-	{
-		throw std::runtime_error("Did not receive correct answer!");
+	while (next < chunks.size() || !in_flight.empty()) {
+
+		while (next < chunks.size() && in_flight.size() < max_in_flight) {
+			ByteArray<5> data_send{};
+			to_byte_container(chunks[next].address, data_send, 0, 4, false);
+			data_send[4] = static_cast<byte>(chunks[next].length);
+
+			OutputBuffer buff_out(data_send.size());
+			buff_out.set_cmd(0x01);
+			buff_out.set_subcmd(0x10);
+			buff_out.set_data(data_send);
+
+			in_flight.emplace_back(next, this->submit_command(buff_out, std::chrono::milliseconds(100), 2, data_send.size()));
+			++next;
+		}
+
+		std::size_t chunk_idx = in_flight.front().first;
+		InputBuffer buff_in = this->wait_reply(in_flight.front().second);
+		in_flight.pop_front();
+
+		if (buff_in.get_ACK() != 0x90) {
+			throw std::runtime_error("Did not receive correct answer!");
+		}
+
+		reader.set_chunk_data(chunk_idx, buff_in.get_reply_data(5, chunks[chunk_idx].length));
+	}
+
+	std::vector<ByteVector> res;
+	res.reserve(ranges.size());
+	for (std::size_t i = 0; i < ranges.size(); ++i) {
+		res.push_back(reader.result(i));
 	}
 
-	return buff_in.get_reply_data(4);
+	return res;
 }
 
 #ifdef ENABLE_UNTESTED
@@ -276,6 +846,10 @@ void Joycon::SPI_sector_erase(unsigned int address) {
 
 void Joycon::set_player_lights(PLAYER_LIGHTS arg) {
 	this->send_command(0x01, 0x30, { static_cast<unsigned char>(arg) }, false);
+
+	std::lock_guard<std::mutex> lock(state_mutex);
+	configured.has_player_lights = true;
+	configured.player_lights = arg;
 }
 
 PLAYER_LIGHTS Joycon::get_player_lights() {
@@ -291,11 +865,21 @@ PLAYER_LIGHTS Joycon::get_player_lights() {
 }
 
 void Joycon::set_home_light(const HOME_LIGHT& light_data) {
-	InputBuffer buff_in = this->send_command(0x01, 0x38, light_data.data(), false);
+	this->send_command(0x01, 0x38, light_data.data(), false);
+
+	std::lock_guard<std::mutex> lock(state_mutex);
+	configured.has_home_light = true;
+	configured.home_light = light_data;
 }
 
 void Joycon::enable_IMU(bool enable) {
 	this->send_command(0x01, 0x40, { static_cast<unsigned char>(enable) }, true);
+
+	std::lock_guard<std::mutex> lock(state_mutex);
+	if (enable && !configured.IMU) {
+		configured.has_IMU_sensitivity = false;	// reset by the device, see set_IMU_sensitivity()
+	}
+	configured.IMU = enable;
 }
 
 // Sending x40 x01 (IMU enable), if it was previously disabled, resets your configuration to 0x03 0x00 0x01 0x01
@@ -306,6 +890,10 @@ void Joycon::set_IMU_sensitivity(unsigned char gyro_sens, unsigned char acc_sens
 	check_input_arguments({ 0x00, 0x01 }, acc_aa_filter, "Invalid acc_aa_filter input");
 
 	this->send_command(0x01, 0x41, { gyro_sens, acc_sens, gyro_perf_rate, acc_aa_filter }, true);
+
+	std::lock_guard<std::mutex> lock(state_mutex);
+	configured.has_IMU_sensitivity = true;
+	configured.IMU_sensitivity = { { gyro_sens, acc_sens, gyro_perf_rate, acc_aa_filter } };
 }
 
 #ifdef ENABLE_UNTESTED
@@ -356,6 +944,9 @@ ByteVector Joycon::read_IMU_registers(unsigned char start_address, unsigned char
 
 void Joycon::enable_vibration(bool enable) {
 	this->send_command(0x01, 0x48, { static_cast<unsigned char>(enable) }, false);
+
+	std::lock_guard<std::mutex> lock(state_mutex);
+	configured.vibration = enable;
 }
 
 POWER Joycon::get_regulated_voltage() {
@@ -378,15 +969,49 @@ void Joycon::send_rumble(Rumble rumble) {
 	this->send_command(0x10, 0x00, {}, false, rumble);
 }
 
+void Joycon::send_rumble(const ByteArray<4>& left, const ByteArray<4>& right) {
+
+	// rumble only, no subcommand
+	OutputBuffer buff_out;
+	buff_out.set_cmd(0x10);
+	buff_out.set_rumble_left(left);
+	buff_out.set_rumble_right(right);
+
+	this->write_report(buff_out);
+}
+
+void Joycon::play_clip(const HapticClip& clip) {
+	HapticPlayer player(clip, [this](const ByteArray<4>& left, const ByteArray<4>& right) { this->send_rumble(left, right); });
+	player.play();
+}
+
+RumbleEngine& Joycon::rumble_engine(std::chrono::milliseconds period) {
+	std::call_once(rumble_once, [this, period]() {
+		rumble.reset(new RumbleEngine([this](const ByteArray<4>& left, const ByteArray<4>& right) { this->send_rumble(left, right); }, period));
+		rumble->start();
+	});
+	return *rumble;
+}
+
 SensorCalibration Joycon::get_sensor_calibration() {
+	std::vector<ByteVector> data = this->SPI_flash_read({
+		{ 0x6020, 0x18 },	// factory_sensor_cal
+		{ 0x603D, 0x12 },	// factory_stick_cal
+		{ 0x6080, 0x06 },	// sensor_model
+		{ 0x6086, 0x12 },	// stick_model1
+		{ 0x6098, 0x12 },	// stick_model2
+		{ 0x8010, 0x16 },	// user_stick_cal
+		{ 0x8026, 0x1A }	// user_sensor_cal
+	});
+
 	SensorCalibration calib;
-	calib.factory_sensor_cal	= this->SPI_flash_read(0x6020, 0x18);
-	calib.factory_stick_cal		= this->SPI_flash_read(0x603D, 0x12);
-	calib.sensor_model			= this->SPI_flash_read(0x6080, 0x06);
-	calib.stick_model1			= this->SPI_flash_read(0x6086, 0x12);
-	calib.stick_model2			= this->SPI_flash_read(0x6098, 0x12);
-	calib.user_stick_cal		= this->SPI_flash_read(0x8010, 0x16);
-	calib.user_sensor_cal		= this->SPI_flash_read(0x8026, 0x1A);
+	calib.factory_sensor_cal	= std::move(data[0]);
+	calib.factory_stick_cal		= std::move(data[1]);
+	calib.sensor_model			= std::move(data[2]);
+	calib.stick_model1			= std::move(data[3]);
+	calib.stick_model2			= std::move(data[4]);
+	calib.user_stick_cal		= std::move(data[5]);
+	calib.user_sensor_cal		= std::move(data[6]);
 
 	return calib;
 }
@@ -423,26 +1048,35 @@ void Joycon::check_input_arguments(std::unordered_set<unsigned char> list, unsig
 	}
 }
 
+/* ------ JOYCONPAIR ------ */
+
+JoyconPair::JoyconPair(std::shared_ptr<Joycon> left, std::shared_ptr<Joycon> right) : left(std::move(left)), right(std::move(right)) {
+	if (!this->left || !this->right || this->left->get_PID() != JOYCON_L_BT || this->right->get_PID() != JOYCON_R_BT) {
+		throw std::invalid_argument("A pair needs a left and a right Joy-Con!");
+	}
+}
+
 /* ------ JOYCONVEC ------ */
 
-int JoyconVec::addDevices() {
+JoyconVec::~JoyconVec() {
+	this->unwatch();
+}
+
+int JoyconVec::addDevices(std::size_t max_workers) {
 
 	std::cout << "Searching for devices..." << std::endl;
 
-	hid_device_info* devs = hid_enumerate(JOYCON_VENDOR, 0x0);
-	if (devs == nullptr) {
+	std::vector<TransportDevice> devs = Transport::enumerate(JOYCON_VENDOR);
+	if (devs.empty()) {
 		std::cout << "No bluetooth device detected!" << std::endl;
 		return -1;
 	}
 
-	std::cout << "-----------------------------" << std::endl;
-	for (hid_device_info* current = devs; current != nullptr; current = current->next) {
+	std::vector<TransportDevice> candidates;
 
-		if (current->vendor_id != JOYCON_VENDOR) {
-			continue;
-		}
+	for (TransportDevice& current : devs) {
 
-		switch (current->product_id) {
+		switch (current.product_id) {
 		case JOYCON_L_BT:
 			break;
 		case JOYCON_R_BT:
@@ -457,31 +1091,393 @@ int JoyconVec::addDevices() {
 			continue;
 		}
 
-		try {
-			vec.emplace_back(new Joycon(static_cast<JOY_PID>(current->product_id), current->serial_number));
+		// attached by a hotplug event meanwhile
+		if (!this->claim(current.path)) {
+			continue;
 		}
-		catch (std::exception& e) {
-			std::cout << e.what() << std::endl;
+
+		candidates.push_back(std::move(current));
+	}
+
+	// every device initializes on its own, a failing one does not stop the others
+	std::vector<std::shared_ptr<Joycon>> devices(candidates.size());
+	std::vector<DeviceInitTiming> timings(candidates.size());
+	std::atomic<std::size_t> next{ 0 };
+
+	auto worker = [&]() {
+		for (std::size_t i = next++; i < candidates.size(); i = next++) {
+			devices[i] = this->open(candidates[i], timings[i]);
 		}
+	};
 
-		std::cout << "-----------------------------" << std::endl;
+	std::vector<std::thread> workers;
+	for (std::size_t i = 1; i < std::min(std::max<std::size_t>(1, max_workers), candidates.size()); ++i) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (auto& t : workers) {
+		t.join();
 	}
 
-	hid_free_enumeration(devs);
+	// keep the enumeration order, after the log of the initialization
+	Logger::flush();
+	std::lock_guard<std::mutex> lock(mutex);
+	std::cout << "-----------------------------" << std::endl;
+	for (std::size_t i = 0; i < candidates.size(); ++i) {
+		const DeviceInitTiming& timing = timings[i];
+		std::wcout << L"SN : " << timing.serial_number;
+		std::cout << " - " << std::dec << timing.duration.count() << "ms - " << (timing.ok ? "ok" : timing.error) << std::endl;
+
+		if (devices[i]) {
+			this->attach(std::move(devices[i]));
+		} else {
+			paths.erase(candidates[i].path);
+		}
+		init_timings.push_back(std::move(timings[i]));
+	}
+	std::cout << "-----------------------------" << std::endl;
 
 	return 0;
 }
 
-int JoyconVec::startDevices() {
+std::shared_ptr<Joycon> JoyconVec::open(TransportDevice& candidate, DeviceInitTiming& timing) {
+	timing.PID = static_cast<JOY_PID>(candidate.product_id);
+	timing.serial_number = candidate.serial_number;
+	timing.path = candidate.path;
+
+	std::shared_ptr<Joycon> res;
+	auto start = std::chrono::steady_clock::now();
+	try {
+		res = std::make_shared<Joycon>(timing.PID, &candidate.serial_number[0], candidate.path.empty() ? nullptr : candidate.path.c_str(), &cache);
+		timing.ok = true;
+	} catch (std::exception& e) {
+		timing.error = e.what();
+	}
+	timing.duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+	return res;
+}
+
+// mutex must be held
+void JoyconVec::attach(std::shared_ptr<Joycon> device) {
+	const uint16_t id = next_id++;
+	if (recorder != nullptr) {
+		device->set_recorder(recorder, id);
+	}
+#ifdef __linux__
+	device->set_gamepad(gamepad);
+#endif
+	if (started) {
+		this->capture(*device);
+	}
+	vec.push_back({ std::move(device), id });
+}
+
+// mutex must be held
+void JoyconVec::capture(Joycon& device) {
+#ifdef JOYCON_HIDRAW_REACTOR
+	if (reactors) {
+		device.capture(*reactors);
+		return;
+	}
+#endif
+	device.capture();
+}
+
+bool JoyconVec::claim(const std::string& path) {
+	if (path.empty()) {
+		return true;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	return paths.insert(path).second;
+}
+
+std::vector<DeviceInitTiming> JoyconVec::init_report() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return init_timings;
+}
+
+std::vector<std::pair<std::shared_ptr<Joycon>, std::shared_ptr<Joycon>>> JoyconVec::pairs() const {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<std::shared_ptr<Joycon>> lefts;
+	std::vector<std::shared_ptr<Joycon>> rights;
+	for (const Entry& entry : vec) {
+		(entry.device->get_PID() == JOYCON_L_BT ? lefts : rights).push_back(entry.device);
+	}
+
+	std::vector<std::pair<std::shared_ptr<Joycon>, std::shared_ptr<Joycon>>> res;
+	for (std::size_t i = 0; i < std::min(lefts.size(), rights.size()); ++i) {
+		res.emplace_back(lefts[i], rights[i]);
+	}
+	return res;
+}
+
+void JoyconVec::set_recorder(ReportRecorder* recorder) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->recorder = recorder;
+	for (const Entry& entry : vec) {
+		entry.device->set_recorder(recorder, entry.id);
+	}
+	for (const auto& parked : detached) {
+		parked.second.device->set_recorder(recorder, parked.second.id);
+	}
+}
+
+#ifdef __linux__
+void JoyconVec::set_gamepad(UinputGamepad* gamepad) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->gamepad = gamepad;
+	for (const Entry& entry : vec) {
+		entry.device->set_gamepad(gamepad);
+	}
+	for (const auto& parked : detached) {
+		parked.second.device->set_gamepad(gamepad);
+	}
+}
+#endif
+
+std::vector<std::shared_ptr<Joycon>> JoyconVec::devices() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<std::shared_ptr<Joycon>> res;
+	for (const Entry& entry : vec) {
+		res.push_back(entry.device);
+	}
+	return res;
+}
+
+std::size_t JoyconVec::size() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return vec.size();
+}
+
+Joycon& JoyconVec::device(std::size_t idx) {
+	std::lock_guard<std::mutex> lock(mutex);
+	return *vec.at(idx).device;
+}
+
+int JoyconVec::startDevices(std::size_t reactor_threads) {
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (started) {
+		return 0;
+	}
+
+	// also without devices: the attached ones start right away
+	started = true;
+#ifdef JOYCON_HIDRAW_REACTOR
+	if (reactor_threads > 0) {
+		reactors.reset(new ReactorPool(std::max<std::size_t>(1, std::min(reactor_threads, vec.size()))));
+		reactors->start();
+	}
+#else
+	(void)reactor_threads;	// every device has its reader thread
+#endif
 
 	if (vec.size() == 0) {
 		std::cout << "No joy-con device detected!" << std::endl;
 		return -1;
+	}
+
+	std::cout << "Starting capture for " << vec.size() << " devices!" << std::endl;
+
+	for (const Entry& entry : vec) {
+		this->capture(*entry.device);
+	}
+	return 0;
+}
+
+/* ------ HOTPLUG ------ */
+
+bool JoyconVec::watch(HotplugSource source) {
+	if (watching.exchange(true)) {
+		return false;
+	}
+	watch_thread = std::thread(&JoyconVec::watch_loop, this, std::move(source));
+	return true;
+}
+
+#ifdef __linux__
+bool JoyconVec::watch(UEVENT_GROUP group) {
+	std::shared_ptr<UeventMonitor> monitor;
+	try {
+		monitor = std::make_shared<UeventMonitor>(group);
+	} catch (std::exception& e) {
+		LOG(LOG_WARNING) << "No hotplug: " << e.what();
+		return false;
+	}
+	return this->watch([monitor](HotplugEvent& event, std::chrono::milliseconds timeout) { return monitor->next(event, timeout); });
+}
+#endif
+
+void JoyconVec::unwatch() {
+	watching = false;
+	if (watch_thread.joinable()) {
+		watch_thread.join();
+	}
+}
+
+void JoyconVec::watch_loop(HotplugSource source) {
+	HotplugEvent event;
+	while (watching) {
+		try {
+			// the timeout bounds how long unwatch() and lost devices wait
+			if (source(event, std::chrono::milliseconds(100))) {
+				this->on_hotplug(event);
+			}
+		} catch (std::exception& e) {
+			LOG(LOG_ERROR) << "Hotplug stopped: " << e.what();
+			return;
+		}
+		this->retire_lost();
+	}
+}
+
+void JoyconVec::on_hotplug(const HotplugEvent& event) {
+
+	if (event.action == HOTPLUG_REMOVE) {
+		std::vector<Entry> retired;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = std::find_if(vec.begin(), vec.end(), [&event](const Entry& entry) { return entry.device->get_path() == event.path; });
+			if (it == vec.end()) {
+				return;
+			}
+			retired.push_back(std::move(*it));
+			vec.erase(it);
+			paths.erase(event.path);
+		}
+		LOG(LOG_INFO) << "Removed device " << event.path;
+		this->park(std::move(retired));
+		return;
+	}
+
+	if (event.vendor_id != JOYCON_VENDOR || (event.product_id != JOYCON_L_BT && event.product_id != JOYCON_R_BT)) {
+		return;
+	}
+	if (!this->claim(event.path)) {
+		return;
+	}
+
+	// the serial number of a Bluetooth controller is its MAC
+	std::string serial;
+	for (wchar_t c : event.serial_number) {
+		serial += static_cast<char>(c < 0x80 ? c : '?');
+	}
+	ByteArray<6> mac;
+	if (parse_mac(serial, mac)) {
+		Entry parked{};
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = detached.find(mac);
+			if (it != detached.end() && it->second.device->get_PID() == event.product_id) {
+				parked = std::move(it->second);
+				detached.erase(it);
+			}
+		}
+		if (parked.device) {
+			this->reconnect(std::move(parked), mac, event.path);
+			return;
+		}
+	}
+
+	TransportDevice candidate{ event.product_id, event.serial_number, event.path };
+	DeviceInitTiming timing;
+	std::shared_ptr<Joycon> device = this->open(candidate, timing);
+	if (device) {
+		LOG(LOG_INFO) << "Attached device " << event.path << " in " << static_cast<long long>(timing.duration.count()) << "ms";
 	} else {
-		std::cout << "Starting capture for " << vec.size() << " devices!" << std::endl;
-		for (const auto& jc_ptr : vec) {
-			jc_ptr->capture();
+		LOG(LOG_WARNING) << "Could not attach device " << event.path << ": " << timing.error;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	init_timings.push_back(std::move(timing));
+	if (!device) {
+		paths.erase(event.path);
+		return;
+	}
+	detached.erase(device->mac());	// replaced by the new object
+	try {
+		this->attach(std::move(device));
+	} catch (std::exception& e) {
+		LOG(LOG_WARNING) << "Could not start device " << event.path << ": " << e.what();
+		paths.erase(event.path);
+	}
+}
+
+std::size_t JoyconVec::retire_lost() {
+	std::vector<Entry> retired;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto it = vec.begin(); it != vec.end();) {
+			if (it->device->connected()) {
+				++it;
+				continue;
+			}
+			paths.erase(it->device->get_path());
+			retired.push_back(std::move(*it));
+			it = vec.erase(it);
 		}
 	}
-	return 0;
+
+	const std::size_t res = retired.size();
+	this->park(std::move(retired));
+	return res;
+}
+
+void JoyconVec::park(std::vector<Entry> retired) {
+	// unlocked: waits for the readers
+	for (Entry& entry : retired) {
+		entry.device->detach();
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (Entry& entry : retired) {
+		const ByteArray<6> mac = entry.device->mac();
+		if (mac != ByteArray<6>{}) {
+			detached[mac] = std::move(entry);
+		}
+	}
+}
+
+void JoyconVec::reconnect(Entry entry, const ByteArray<6>& mac, const std::string& path) {
+
+	DeviceInitTiming timing;
+	timing.PID = entry.device->get_PID();
+	timing.path = path;
+	timing.reconnect = true;
+
+	auto start = std::chrono::steady_clock::now();
+	try {
+		entry.device->reconnect(path);
+		timing.ok = true;
+	} catch (std::exception& e) {
+		timing.error = e.what();
+		LOG(LOG_WARNING) << "Could not reconnect device " << path << ": " << timing.error;
+	}
+	timing.duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	init_timings.push_back(std::move(timing));
+	if (!init_timings.back().ok) {
+		paths.erase(path);
+		detached[mac] = std::move(entry);
+		return;
+	}
+	// removed before startDevices(), came back after it
+	if (started && !entry.device->captured()) {
+		try {
+			this->capture(*entry.device);
+		} catch (std::exception& e) {
+			LOG(LOG_WARNING) << "Could not start device " << path << ": " << e.what();
+			paths.erase(path);
+			detached[mac] = std::move(entry);
+			return;
+		}
+	}
+	vec.push_back(std::move(entry));
+}
+
+std::size_t JoyconVec::detached_size() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return detached.size();
 }
@@ -1,19 +1,38 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <stdexcept>
 #include <thread>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
-#ifdef _WIN32
-#include "hidapi.h"
-#elif __linux__
-#include <hidapi/hidapi.h>
-#endif
-
 #include "buffer.h"
+#include "cache.h"
+#include "command.h"
+#include "deviceclock.h"
+#include "hapticclip.h"
 #include "homelight.h"
+#include "hotplug.h"
+#include "imufusion.h"
+#include "metrics.h"
+#include "pairing.h"
+#include "reactor.h"
+#include "recorder.h"
+#include "report.h"
+#include "ringbuffer.h"
+#include "seqlock.h"
+#include "rumbleengine.h"
+#include "spi.h"
+#include "transport.h"
+#include "uinput.h"
 
 #define THROW(x) throw(std::runtime_error(std::string(__FILE__) + " - line " + std::to_string(__LINE__) + ": " + __FUNCTION__ + "(): " + x ))
 #define CHECK(x) if (x == -1) {THROW(#x + " failed!");}
@@ -23,22 +42,126 @@
 
 // #define ENABLE_UNTESTED
 
+// What was configured on a device through its Joycon, replayed by Joycon::reconnect().
+// Settings without has_ flag set are left as the device starts.
+struct DeviceState {
+	byte input_report_mode = 0x30;
+	bool IMU = true;
+	bool vibration = true;
+
+	bool has_IMU_sensitivity = false;
+	ByteArray<4> IMU_sensitivity{};		// gyro_sens, acc_sens, gyro_perf_rate, acc_aa_filter
+
+	bool has_player_lights = false;
+	PLAYER_LIGHTS player_lights = static_cast<PLAYER_LIGHTS>(0);
+
+	bool has_home_light = false;
+	HOME_LIGHT home_light;
+};
+
 class Joycon {
 
 public:
 	Joycon(Joycon&) = delete;
 	Joycon(Joycon&&) = delete;
-	Joycon(JOY_PID PID, wchar_t* serial_number);
+	// With a cache, device info, colors and calibration of a known controller are taken from it instead of the SPI flash
+	// and re-validated in the background. Unknown controllers are read and stored.
+	Joycon(JOY_PID PID, wchar_t* serial_number, const char* path = nullptr, DeviceCache* cache = nullptr);
 
 	~Joycon();
 
 	void printDeviceInfo() const;
-	InputBuffer send_command(unsigned char cmd, unsigned char subcmd, const ByteVector& data, bool blocking = true, Rumble rumble = Rumble());
+	JOY_PID get_PID() const { return PID; }
+	std::string get_path() const {
+		std::lock_guard<std::mutex> lock(path_mutex);
+		return path;
+	}
+	InputBuffer send_command(unsigned char cmd, unsigned char subcmd, ByteView data, bool blocking = true, Rumble rumble = Rumble());
+
+	// Returns right after writing. The reader fulfills the future with the 0x21 reply to subcmd, so input keeps flowing.
+	// Without reply after timeout the command is resent up to retries times, then the future throws.
+	// Commands without 0x21 reply (e.g. cmd 0x10) must use send_command(..., false).
+	std::future<InputBuffer> send_command_async(unsigned char cmd, unsigned char subcmd, ByteView data, Rumble rumble = Rumble(),
+		std::chrono::milliseconds timeout = std::chrono::milliseconds(100), unsigned int retries = 2);
+
 	void capture();
 	void callback();
 
+#ifdef JOYCON_HIDRAW_REACTOR
+	// Read the reports straight from the hidraw node (path) inside one of the pool's reactors instead of an own thread.
+	void capture(ReactorPool& pool);
+#endif
+
+	// Consumer side of the report ring, filled by callback(). Only one consumer thread, never takes hid_mutex.
+	bool pop_report(StandardReport& report) { return reports.pop(report); }
+	std::size_t drain_reports(StandardReport* out, std::size_t max) { return reports.drain(out, max); }
+	template <typename F>
+	std::size_t drain_reports(F f) { return reports.drain(f); }
+	std::size_t dropped_reports() const { return reports.overflows(); }
+
+	// The last decoded report, for consumers that poll at their own rate instead of draining the ring.
+	// Any number of threads, no lock. All zero before the first report.
+	StandardReport state() const { return latest.load(); }
+	bool try_state(StandardReport& report) const { return latest.try_load(report); }
+	std::size_t state_version() const { return latest.version(); }	// reports published so far
+
+	// Consumer side of the button event ring: one event per report whose buttons differ from the report before.
+	// Only one consumer thread (may be another one than the report consumer).
+	bool pop_button_event(ButtonEvent& event) { return button_events.pop(event); }
+	template <typename F>
+	std::size_t drain_button_events(F f) { return button_events.drain(f); }
+	std::size_t dropped_button_events() const { return button_events.overflows(); }
+
+	// false once the reader failed to read (the device is gone) or after detach(). The reader stopped then.
+	bool connected() const { return !lost.load(std::memory_order_acquire); }
+
+	// true after capture(), the reader (or a reactor) reads the reports
+	bool captured() const { return capturing.load(std::memory_order_acquire); }
+
+	// MAC of the device, from its device info
+	ByteArray<6> mac() const;
+
+	// the state set so far, see DeviceState
+	DeviceState configured_state() const;
+
+	// Stops the reader (if captured) and closes the device, commands in flight fail. The rings, the state and
+	// everything set on this object (gamepad, recorder, fusion) stay, for reconnect().
+	void detach();
+
+	// The same controller again, e.g. at a new path after it dropped: opens it, restarts the reader the way capture()
+	// started it (none if it was never captured) and replays the configured state, all commands in flight at once.
+	// Device data and calibration are not read again. Consumers of this object keep going with the reports of the new link.
+	// Throws std::runtime_error if the device can not be opened (it stays detached). Failing replay commands are
+	// logged, the device stays connected.
+	void reconnect(const std::string& path);
+
+	// Link quality since the constructor: report arrival, lost reports, command round trips, failures and queue depths.
+	// Any thread, lock free.
+	LinkSnapshot metrics() const;
+
+	// The reader fuses the IMU samples of every report (Madgwick, with the calibration of this device) and stores the
+	// orientation in StandardReport::orientation. One filter per device, see FusionBank. Takes effect with the next report.
+	void reset_orientation() { fusion_reset = true; }
+	void set_fusion_gain(float beta);
+
+#ifdef __linux__
+	// The reader maps every report to gamepad right after decoding it (before the rings). nullptr stops.
+	// The gamepad must outlive its use.
+	void set_gamepad(UinputGamepad* gamepad) { this->gamepad.store(gamepad, std::memory_order_release); }
+#endif
+
+	// Logs every raw input report and every written output report as device. nullptr stops.
+	// The recorder must outlive the recording.
+	void set_recorder(ReportRecorder* recorder, uint16_t device);
+
 	JoyconDeviceInfo request_device_info();
 
+	// read (or loaded from the cache) in the constructor
+	JoyconDeviceInfo device_info() const;
+	SensorCalibration calibration() const;
+	Color24 body_color() const;
+	Color24 button_color() const;
+
 	// 0x00 - Used with cmd x11.Active polling for IR camera data. 0x31 data format must be set first
 	// 0x01 - Same as 00
 	// 0x02 - Same as 00. Active polling mode for IR camera data.For specific IR modes
@@ -68,7 +191,11 @@ public:
 	void set_shipment(bool enable);
 #endif
 
-	ByteVector SPI_flash_read(unsigned int address, unsigned char length);
+	ByteVector SPI_flash_read(unsigned int address, std::size_t length);
+
+	// Reads all ranges with as few 0x10 round trips as possible (see SPIReader), keeping up to max_in_flight reads in flight.
+	// result[i] belongs to ranges[i].
+	std::vector<ByteVector> SPI_flash_read(const std::vector<SPIRange>& ranges, std::size_t max_in_flight = 4);
 
 #ifdef ENABLE_UNTESTED
 	void SPI_flash_write(unsigned int address, ByteVector data);
@@ -97,6 +224,15 @@ public:
 	POWER get_regulated_voltage();
 
 	void send_rumble(Rumble rumble = Rumble());
+	void send_rumble(const ByteArray<4>& left, const ByteArray<4>& right);
+
+	// Per device rumble engine, started on the first call (period is only used then).
+	// Play effects on it instead of calling send_rumble() for every change.
+	RumbleEngine& rumble_engine(std::chrono::milliseconds period = std::chrono::milliseconds(10));
+
+	// Writes the pre-encoded frames of clip at their time, returns when the clip is done.
+	// Effects of the rumble engine played meanwhile overwrite the clip frames.
+	void play_clip(const HapticClip& clip);
 
 	SensorCalibration get_sensor_calibration();
 
@@ -108,23 +244,272 @@ private:
 
 	void check_input_arguments(std::unordered_set<unsigned char> list, unsigned char arg, std::string error_msg) const;
 
+	// runs in the reader (callback thread or reactor) for every received report.
+	// arrival: right after the read returned, before recording and logging (start of the gamepad latency)
+	void process_report(const InputBuffer& buff_in, LinkMonitor::Clock::time_point arrival);
+
+	// the reader stops: the read failed
+	void on_lost();
+
+	// transport.open() of PID, serial and path
+	bool open_transport();
+	void start_reader();
+
+	// the replay of reconnect(), returns the amount of failed commands
+	std::size_t replay_state();
+
+	// IMU fusion of the reader, fills report.orientation
+	void fuse(StandardReport& report);
+
+	// sets the GP and writes. Called by commands (under its mutex).
+	void write_report(OutputBuffer& buff_out);
+
+	// before capture() nobody reads the device -> the waiting thread reads the reports itself (under pump_mutex,
+	// which capture() takes to hand the reading over to the reader)
+	InputBuffer wait_reply(std::future<InputBuffer>& reply);
+
+	// submits buff_out, waits for a free slot while the commands of other threads (e.g. the validation) fill the queue
+	std::future<InputBuffer> submit_command(OutputBuffer& buff_out, std::chrono::milliseconds timeout, unsigned int retries, std::size_t echo = 0);
+
+	// one read before capture(): delivers replies and checks the deadlines. Returns false if another thread is reading
+	// or the device is detached.
+	bool pump_reports();
+
+	void load_device_data(const wchar_t* serial_number);
+	DeviceRecord read_device_data();
+	void apply_device_data(const DeviceRecord& record);
+
+	// runs in validate_thread: cheap checksum read, everything is read again only if the device changed
+	void validate_device_data(DeviceRecord cached);
+
+#ifdef JOYCON_HIDRAW_REACTOR
+	void open_hidraw();
+
+	// reactor handler: reads until EAGAIN. Returns false if the device is gone.
+	bool on_readable();
+
+	// reactor handler: checks the deadlines of the commands in flight
+	bool on_command_timer();
+	void arm_command_timer(bool active);
+
+	Reactor* reactor = nullptr;
+	int hidraw_fd = -1;
+	int timer_fd = -1;
+#endif
+
+	DeviceCache* cache;
+	std::thread validate_thread;
+
+	// guards the device data below, validate_thread may replace it
+	mutable std::mutex info_mutex;
+	JoyconDeviceInfo info;
 	SensorCalibration sensorCalib;
+	Color24 body_RGB{};
+	Color24 button_RGB{};
+
+	JOY_PID PID;
+	std::wstring serial;
 
-	hid_device* handle;
+	// guards path, reconnect() may change it while others read it
+	mutable std::mutex path_mutex;
+	std::string path;
+
+	// guards configured, updated when a setting was sent
+	mutable std::mutex state_mutex;
+	DeviceState configured;
+	Transport transport;
 	std::thread callback_thread;
-	bool alive = true;
+	std::atomic<bool> alive{ true };
+	std::atomic<bool> capturing{ false };
+	std::atomic<bool> lost{ false };
 	std::size_t package_number = 0;
 
+	// guards writes (and package_number), reads happen only in the reader
 	mutable std::mutex hid_mutex;
+
+	// only one thread at a time reads in pump_reports(), capturing only changes under it
+	std::mutex pump_mutex;
+
+	// declared before commands, which records into it
+	LinkMetrics link_metrics;
+	LinkMonitor link_monitor{ link_metrics };	// only used by the reader
+
+	CommandQueue commands;
+
+	std::once_flag rumble_once;
+	std::unique_ptr<RumbleEngine> rumble;
+
+	SPSCRingBuffer<StandardReport, 128> reports;
+	SeqLock<StandardReport> latest;
+	SPSCRingBuffer<ButtonEvent, 64> button_events;
+
+	// only used by the reader. The flags hand changes over from other threads.
+	DeviceClock device_clock;
+	uint32_t last_buttons = 0;
+	FusionBank fusion{ 1 };
+	std::atomic<bool> fusion_calibrate{ true };
+	std::atomic<bool> fusion_reset{ false };
+	std::atomic<float> fusion_beta{ 0.1f };
+
+#ifdef __linux__
+	std::atomic<UinputGamepad*> gamepad{ nullptr };
+#endif
+
+	std::atomic<ReportRecorder*> recorder{ nullptr };
+	std::atomic<uint16_t> recorder_device{ 0 };
+};
+
+// A left and a right Joy-Con as one controller. The pair is the report consumer of both devices:
+// do not pop or drain their reports elsewhere. It shares the devices, so they outlive a retire by JoyconVec.
+class JoyconPair {
+public:
+	// Throws std::invalid_argument unless left is a JOYCON_L_BT and right a JOYCON_R_BT.
+	JoyconPair(std::shared_ptr<Joycon> left, std::shared_ptr<Joycon> right);
+	JoyconPair(const JoyconPair&) = delete;
+	JoyconPair& operator=(const JoyconPair&) = delete;
+
+	// Merges the reports of both devices that arrived since the last call (see PairMerger) and publishes the last
+	// frame. Calls f(const PairedState&) for every frame, in time order. Returns the amount of frames. One thread only.
+	template <typename F>
+	std::size_t poll(F f) {
+		const std::size_t l = left->drain_reports(left_reports.data(), left_reports.size());
+		const std::size_t r = right->drain_reports(right_reports.data(), right_reports.size());
+		if (l + r > 0) {
+			merger.merge(left_reports.data(), l, right_reports.data(), r, f);
+			latest.store(merger.frame());
+		}
+		return l + r;
+	}
+	std::size_t poll() { return this->poll([](const PairedState&) {}); }
+
+	// the latest frame published by poll(), any thread
+	PairedState state() const { return latest.load(); }
+	std::size_t state_version() const { return latest.version(); }
+
+private:
+	std::shared_ptr<Joycon> left;
+	std::shared_ptr<Joycon> right;
+	PairMerger merger;
+	SeqLock<PairedState> latest;
+	std::array<StandardReport, 64> left_reports;
+	std::array<StandardReport, 64> right_reports;
+};
+
+struct DeviceInitTiming {
+	JOY_PID PID;
+	std::wstring serial_number;
+	std::string path;
+	std::chrono::milliseconds duration{ 0 };	// open + initialization
+	bool ok = false;
+	std::string error;						// why the constructor failed, if !ok
+	bool reconnect = false;					// a known device came back: state replayed, see Joycon::reconnect()
 };
 
 class JoyconVec {
 public:
-	int addDevices();
-	int startDevices();
+	// cache_path: file of the DeviceCache. Empty (the default) writes no file, the cache only lives as long as this.
+	explicit JoyconVec(std::string cache_path = "") : cache(std::move(cache_path)) {}
+	JoyconVec(const JoyconVec&) = delete;
+	JoyconVec& operator=(const JoyconVec&) = delete;
+	~JoyconVec();
+
+	// Opens and initializes the found devices with up to max_workers threads.
+	// Devices that fail to initialize are skipped, see init_report().
+	int addDevices(std::size_t max_workers = 8);
+
+	// one entry per device addDevices() or a hotplug event tried to add, in that order
+	std::vector<DeviceInitTiming> init_report() const;
+
+	// reactor_threads: amount of epoll reactors that read all devices (Linux only).
+	// 0 starts one thread per device instead. Devices attached later are started right away.
+	int startDevices(std::size_t reactor_threads = 1);
+
+	// Attaches the devices that connect and retires the ones that vanish, in a thread of its own, one event at a time.
+	// Devices whose reader lost them are retired as well, also without an event. Returns false if already watching.
+	// Devices already known (by path) are not attached again: watch before addDevices() to miss nothing.
+	// A retired device is detached and kept: when its MAC (the serial number of the event) comes back, the same object
+	// reconnects (see Joycon::reconnect()), so its consumers, pairs, gamepad and recorder simply continue.
+	bool watch(HotplugSource source);
+#ifdef __linux__
+	// netlink uevents (see UeventMonitor). Returns false if the socket can not be opened.
+	bool watch(UEVENT_GROUP group = UEVENT_UDEV);
+#endif
+	void unwatch();
+
+	// what the watching thread does with an event
+	void on_hotplug(const HotplugEvent& event);
+
+	// retires the devices that are not connected() anymore, returns the amount
+	std::size_t retire_lost();
+
+	// retired devices waiting for their MAC to come back
+	std::size_t detached_size() const;
+
+	// records all devices into recorder, the device ID is the attach order (the index without hotplug)
+	void set_recorder(ReportRecorder* recorder);
+
+#ifdef __linux__
+	// feeds all devices, also the ones attached later, into gamepad (see Joycon::set_gamepad()). nullptr stops.
+	// The gamepad must outlive this.
+	void set_gamepad(UinputGamepad* gamepad);
+#endif
+
+	// (left, right) Joy-Cons to pair, in the order they were added: the first L with the first R, ...
+	std::vector<std::pair<std::shared_ptr<Joycon>, std::shared_ptr<Joycon>>> pairs() const;
+
+	// The attached devices. A retired device stays valid, see watch().
+	std::vector<std::shared_ptr<Joycon>> devices() const;
+
+	std::size_t size() const;
+	// Without hotplug only: watch() retires devices, which changes the indices and may destroy the referenced one.
+	// Use devices() then.
+	Joycon& device(std::size_t idx);
 
-	std::size_t size() { return vec.size(); }
-	Joycon& device(std::size_t idx) { return *vec.at(idx); }
 private:
-	std::vector<std::unique_ptr<Joycon>> vec;
+	struct Entry {
+		std::shared_ptr<Joycon> device;
+		uint16_t id;	// attach order
+	};
+
+	// constructs the device, nullptr (and timing.error) if it fails
+	std::shared_ptr<Joycon> open(TransportDevice& candidate, DeviceInitTiming& timing);
+
+	// adds an opened device, starts it if the others are. mutex must be held.
+	void attach(std::shared_ptr<Joycon> device);
+	void capture(Joycon& device);
+
+	// detaches retired devices and keeps them for a reconnect
+	void park(std::vector<Entry> retired);
+
+	// a parked device at path again
+	void reconnect(Entry entry, const ByteArray<6>& mac, const std::string& path);
+
+	// path of a device that is attached or being opened, false if it already is. Empty paths are never known.
+	bool claim(const std::string& path);
+
+	void watch_loop(HotplugSource source);
+
+	// declared before vec: validation threads of the devices store into it
+	DeviceCache cache;
+
+	// guards everything below
+	mutable std::mutex mutex;
+
+#ifdef JOYCON_HIDRAW_REACTOR
+	// declared before vec: devices unregister from their reactor before the reactors are destroyed
+	std::unique_ptr<ReactorPool> reactors;
+#endif
+	std::vector<Entry> vec;
+	std::map<ByteArray<6>, Entry> detached;
+	std::vector<DeviceInitTiming> init_timings;
+	std::unordered_set<std::string> paths;
+	uint16_t next_id = 0;
+	bool started = false;
+	ReportRecorder* recorder = nullptr;
+#ifdef __linux__
+	UinputGamepad* gamepad = nullptr;
+#endif
+
+	std::atomic<bool> watching{ false };
+	std::thread watch_thread;
 };
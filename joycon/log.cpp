@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "log.h"
+#include "ringbuffer.h"
+
+struct LogRing {
+	static constexpr std::size_t SIZE = 256;
+
+	SPSCRingBuffer<LogEntry, SIZE> entries;
+	std::atomic<bool> closed{ false };	// the thread ended, removed once empty
+};
+
+constexpr std::size_t LogEntry::TEXT_SIZE;
+constexpr std::size_t LogRing::SIZE;
+
+std::atomic<int> Logger::runtime_level{ LOG_DEBUG };
+
+namespace {
+
+uint64_t now_ns() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char LEVEL_CHARS[] = { 'T', 'D', 'I', 'W', 'E' };
+
+/* ------ WRITER ------ */
+
+// The rings of all threads and the thread writing them out. Created with the first line.
+class LogWriter {
+public:
+	LogWriter() : start_ns(now_ns()), thread(&LogWriter::run, this) {}
+
+	~LogWriter() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			running = false;
+		}
+		wake.notify_one();
+		thread.join();
+		this->drain();
+	}
+
+	std::shared_ptr<LogRing> add_ring() {
+		std::shared_ptr<LogRing> ring = std::make_shared<LogRing>();
+		std::lock_guard<std::mutex> lock(mutex);
+		rings.push_back(ring);
+		return ring;
+	}
+
+	// by a producer whose ring fills up
+	void notify() { wake.notify_one(); }
+
+	void set_sink(std::ostream* new_sink) {
+		std::lock_guard<std::mutex> lock(drain_mutex);
+		sink = new_sink;
+	}
+
+	// writes the committed lines of all rings, sorted by time
+	void drain() {
+		std::lock_guard<std::mutex> lock(drain_mutex);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			current = rings;
+		}
+
+		batch.clear();
+		for (const std::shared_ptr<LogRing>& ring : current) {
+			ring->entries.drain([this](const LogEntry& entry) { batch.push_back(entry); });
+		}
+		current.clear();
+
+		order.clear();
+		for (const LogEntry& entry : batch) {
+			order.push_back(&entry);
+		}
+		std::stable_sort(order.begin(), order.end(), [](const LogEntry* a, const LogEntry* b) { return a->timestamp_ns < b->timestamp_ns; });
+
+		for (const LogEntry* entry : order) {
+			this->write(entry->timestamp_ns, entry->level, entry->text, entry->length);
+		}
+		written_count.fetch_add(order.size(), std::memory_order_relaxed);
+
+		std::size_t dropped = this->dropped();
+		if (dropped != reported_drops) {
+			char text[64];
+			int length = std::snprintf(text, sizeof(text), "log: %zu lines dropped", dropped - reported_drops);
+			this->write(now_ns(), LOG_WARNING, text, static_cast<std::size_t>(length));
+			reported_drops = dropped;
+		}
+
+		// rings of ended threads, their last lines were written above
+		std::lock_guard<std::mutex> lock_rings(mutex);
+		rings.erase(std::remove_if(rings.begin(), rings.end(), [this](const std::shared_ptr<LogRing>& ring) {
+			if (ring->closed.load(std::memory_order_acquire) && ring->entries.empty()) {
+				removed_overflows += ring->entries.overflows();
+				return true;
+			}
+			return false;
+		}), rings.end());
+	}
+
+	void flush() {
+		this->drain();
+		std::lock_guard<std::mutex> lock(drain_mutex);
+		sink->flush();
+	}
+
+	std::size_t written() const { return written_count.load(std::memory_order_relaxed); }
+
+	std::size_t dropped() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		std::size_t count = removed_overflows + nested.load(std::memory_order_relaxed);
+		for (const std::shared_ptr<LogRing>& ring : rings) {
+			count += ring->entries.overflows();
+		}
+		return count;
+	}
+
+	// lines started while the thread was still formatting another line (e.g. in a function called by its arguments)
+	std::atomic<std::size_t> nested{ 0 };
+
+private:
+	void run() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (running) {
+			wake.wait_for(lock, std::chrono::milliseconds(5));
+			lock.unlock();
+			this->drain();
+			lock.lock();
+		}
+	}
+
+	void write(uint64_t timestamp_ns, uint8_t level, const char* text, std::size_t length) {
+		uint64_t elapsed_us = timestamp_ns > start_ns ? (timestamp_ns - start_ns) / 1000 : 0;
+
+		char prefix[48];
+		int prefix_length = std::snprintf(prefix, sizeof(prefix), "[%5llu.%06llu] %c ", static_cast<unsigned long long>(elapsed_us / 1000000),
+			static_cast<unsigned long long>(elapsed_us % 1000000), LEVEL_CHARS[level]);
+
+		sink->write(prefix, prefix_length);
+		sink->write(text, length);
+		sink->put('\n');
+	}
+
+	const uint64_t start_ns;
+
+	// guards rings, removed_overflows and running
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<std::shared_ptr<LogRing>> rings;
+	std::size_t removed_overflows = 0;
+	bool running = true;
+
+	// guards the sink and the writing, one drain at a time
+	std::mutex drain_mutex;
+	std::ostream* sink = &std::clog;
+	// kept between passes, an idle pass allocates nothing
+	std::vector<std::shared_ptr<LogRing>> current;
+	std::vector<LogEntry> batch;
+	std::vector<const LogEntry*> order;
+	std::size_t reported_drops = 0;
+	std::atomic<std::size_t> written_count{ 0 };
+
+	std::thread thread;
+};
+
+LogWriter& writer() {
+	static LogWriter instance;
+	return instance;
+}
+
+// the ring of a thread, marked closed when the thread ends
+struct ThreadRing {
+	~ThreadRing() {
+		if (ring) {
+			ring->closed.store(true, std::memory_order_release);
+		}
+	}
+	std::shared_ptr<LogRing> ring;
+};
+
+thread_local ThreadRing thread_ring;
+thread_local bool formatting = false;
+
+} // namespace
+
+/* ------ LOGGER ------ */
+
+bool Logger::parse_level(const std::string& name, LOG_LEVEL& level) {
+	static const char* const NAMES[] = { "trace", "debug", "info", "warning", "error", "off" };
+	for (int i = LOG_TRACE; i <= LOG_OFF; ++i) {
+		if (name == NAMES[i]) {
+			level = static_cast<LOG_LEVEL>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+void Logger::set_sink(std::ostream* sink) {
+	writer().set_sink(sink);
+}
+
+void Logger::flush() {
+	writer().flush();
+}
+
+std::size_t Logger::written() {
+	return writer().written();
+}
+
+std::size_t Logger::dropped() {
+	return writer().dropped();
+}
+
+/* ------ LINE ------ */
+
+LogLine::LogLine(LOG_LEVEL level) {
+	if (formatting) {
+		writer().nested.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	if (!thread_ring.ring) {
+		thread_ring.ring = writer().add_ring();
+	}
+	ring = thread_ring.ring.get();
+
+	entry = ring->entries.claim();
+	if (entry == nullptr) {
+		return;
+	}
+	formatting = true;
+	entry->timestamp_ns = now_ns();
+	entry->level = static_cast<uint8_t>(level);
+}
+
+LogLine::~LogLine() {
+	if (entry == nullptr) {
+		return;
+	}
+	entry->length = static_cast<uint16_t>(length);
+	ring->entries.commit();
+	formatting = false;
+
+	// do not wait for the next wake up of the writer if the ring is about to overflow
+	if (ring->entries.size() == LogRing::SIZE / 2) {
+		writer().notify();
+	}
+}
+
+LogLine& LogLine::append(const char* str, std::size_t size) {
+	if (entry != nullptr) {
+		size = std::min(size, LogEntry::TEXT_SIZE - length);
+		std::copy(str, str + size, entry->text + length);
+		length += size;
+	}
+	return *this;
+}
+
+LogLine& LogLine::append_signed(long long value) {
+	if (value < 0) {
+		this->append("-", 1);
+		return this->append_unsigned(0ull - static_cast<unsigned long long>(value));
+	}
+	return this->append_unsigned(static_cast<unsigned long long>(value));
+}
+
+LogLine& LogLine::append_unsigned(unsigned long long value) {
+	char digits[20];
+	char* begin = digits + sizeof(digits);
+	do {
+		*--begin = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+	return this->append(begin, digits + sizeof(digits) - begin);
+}
+
+LogLine& LogLine::operator<<(const wchar_t* str) {
+	if (entry != nullptr) {
+		for (; *str != L'\0' && length < LogEntry::TEXT_SIZE; ++str) {
+			entry->text[length++] = static_cast<unsigned long>(*str) < 0x80 ? static_cast<char>(*str) : '?';
+		}
+	}
+	return *this;
+}
+
+LogLine& LogLine::operator<<(double value) {
+	if (entry != nullptr) {
+		char text[32];
+		int size = std::snprintf(text, sizeof(text), "%g", value);
+		this->append(text, static_cast<std::size_t>(std::max(size, 0)));
+	}
+	return *this;
+}
+
+LogLine& LogLine::operator<<(LogHex hex) {
+	char digits[16];
+	char* begin = digits + sizeof(digits);
+	unsigned long long value = hex.value;
+	do {
+		*--begin = "0123456789abcdef"[value & 0xF];
+		value >>= 4;
+	} while (value != 0);
+	return this->append(begin, digits + sizeof(digits) - begin);
+}
+
+LogLine& LogLine::operator<<(ByteView bytes) {
+	if (entry != nullptr) {
+		// whole bytes only
+		std::size_t count = bytes.size();
+		while (count > 0 && hex_length(count, 1) > LogEntry::TEXT_SIZE - length) {
+			--count;
+		}
+		length = hex_encode(bytes.begin(), bytes.begin() + count, entry->text + length, " ", 1) - entry->text;
+	}
+	return *this;
+}
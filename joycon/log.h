@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "types.h"
+
+enum LOG_LEVEL {
+	LOG_TRACE = 0,		// every report
+	LOG_DEBUG = 1,		// every command sent and its reply
+	LOG_INFO = 2,
+	LOG_WARNING = 3,
+	LOG_ERROR = 4,
+	LOG_OFF = 5
+};
+
+// Lines below this level are compiled out, e.g. -DJOYCON_LOG_LEVEL=LOG_INFO
+#ifndef JOYCON_LOG_LEVEL
+#define JOYCON_LOG_LEVEL LOG_TRACE
+#endif
+
+// LOG(LOG_DEBUG) << "received: " << buff_in;
+// A disabled line costs one relaxed load, its arguments are not evaluated.
+#define LOG(level) if (!Logger::enabled(level)) {} else LogLine(level)
+
+// Asynchronous logging: every thread writes its lines into an own lock-free ring (no lock, no allocation, no
+// system call), a background writer formats the timestamps and writes them to the sink, ordered by time:
+//	[    1.234567] D text
+// A full ring drops the line instead of blocking the thread, see dropped().
+class Logger {
+public:
+	// runtime level, LOG_DEBUG by default
+	static bool enabled(LOG_LEVEL level) {
+		return level >= JOYCON_LOG_LEVEL && level < LOG_OFF && level >= runtime_level.load(std::memory_order_relaxed);
+	}
+	static void set_level(LOG_LEVEL level) { runtime_level.store(level, std::memory_order_relaxed); }
+	static LOG_LEVEL level() { return static_cast<LOG_LEVEL>(runtime_level.load(std::memory_order_relaxed)); }
+
+	// "trace", "debug", "info", "warning", "error" or "off". Returns false for any other name.
+	static bool parse_level(const std::string& name, LOG_LEVEL& level);
+
+	// std::clog by default. The sink must outlive its use (or be replaced before).
+	static void set_sink(std::ostream* sink);
+
+	// writes all lines committed so far (in the calling thread) and flushes the sink
+	static void flush();
+
+	static std::size_t written();
+	static std::size_t dropped();
+
+private:
+	static std::atomic<int> runtime_level;
+};
+
+struct LogEntry {
+	static constexpr std::size_t TEXT_SIZE = 496;	// longer lines are cut
+
+	uint64_t timestamp_ns;
+	uint16_t length;
+	uint8_t level;
+	char text[TEXT_SIZE];
+};
+
+struct LogRing;
+
+// integer written as hex (without 0x)
+struct LogHex {
+	template <typename T>
+	explicit LogHex(T value) : value(static_cast<unsigned long long>(value)) {}
+	unsigned long long value;
+};
+
+// One line, formatted in place into the slot of the thread's ring and published by the destructor.
+// Only use it through LOG().
+class LogLine {
+public:
+	explicit LogLine(LOG_LEVEL level);
+	LogLine(const LogLine&) = delete;
+	LogLine& operator=(const LogLine&) = delete;
+	~LogLine();
+
+	LogLine& operator<<(const char* str);
+	LogLine& operator<<(const std::string& str) { return this->append(str.data(), str.size()); }
+	LogLine& operator<<(const wchar_t* str);	// non ASCII chars as ?
+	LogLine& operator<<(const std::wstring& str) { return *this << str.c_str(); }
+	LogLine& operator<<(char c) { return this->append(&c, 1); }
+	LogLine& operator<<(double value);
+	LogLine& operator<<(LogHex hex);
+	LogLine& operator<<(ByteView bytes);	// as hex, separated by spaces
+
+	template <typename T>
+	typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, LogLine&>::type
+	operator<<(T value) {
+		return value < T() ? this->append_signed(static_cast<long long>(value)) : this->append_unsigned(static_cast<unsigned long long>(value));
+	}
+
+	// InputBuffer, OutputBuffer: everything with format(char*, std::size_t)
+	template <typename T>
+	auto operator<<(const T& buffer) -> decltype(buffer.format(std::declval<char*>(), std::size_t()), std::declval<LogLine&>()) {
+		if (entry != nullptr) {
+			length += buffer.format(entry->text + length, LogEntry::TEXT_SIZE - length);
+		}
+		return *this;
+	}
+
+private:
+	LogLine& append(const char* str, std::size_t size);
+	LogLine& append_signed(long long value);
+	LogLine& append_unsigned(unsigned long long value);
+
+	LogEntry* entry = nullptr;
+	LogRing* ring = nullptr;	// of this thread
+	std::size_t length = 0;
+};
+
+inline LogLine& LogLine::operator<<(const char* str) {
+	return this->append(str, std::char_traits<char>::length(str));
+}
@@ -1,15 +1,13 @@
 #include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <signal.h>
 #include <thread>
-
-#ifdef _WIN32
-#include "hidapi.h"
-#elif __linux__
-#include <hidapi/hidapi.h>
-#endif
+#include <vector>
 
 #include "joycon.h"
+#include "log.h"
 
 static sig_atomic_t volatile shutdown_flag = 0;
 static void SigCallback(int sig) {
@@ -19,8 +17,18 @@ static void SigCallback(int sig) {
 int main() {
 	std::ios_base::sync_with_stdio(false);
 
-	// Initialize the hidapi library
-	if (hid_init()) {
+	// e.g. JOYCON_LOG=trace to log every report
+	LOG_LEVEL level;
+	if (const char* name = std::getenv("JOYCON_LOG")) {
+		if (Logger::parse_level(name, level)) {
+			Logger::set_level(level);
+		} else {
+			std::cerr << "Unknown log level " << name << std::endl;
+		}
+	}
+
+	// Initialize the hidapi library (or the selected transport)
+	if (Transport::init()) {
 		std::cerr << "HID initialization failed!" << std::endl;
 		return -1;
 	}
@@ -28,14 +36,51 @@ int main() {
 	signal(SIGINT , SigCallback);
 	signal(SIGTERM, SigCallback);
 
-	JoyconVec joycons;
-	if (joycons.addDevices()   == -1) { hid_exit();  return 0; }
-	if (joycons.startDevices() == -1) { hid_exit();  return 0; };
+#ifdef __linux__
+	// before the devices: outlives their readers
+	std::unique_ptr<UinputGamepad> gamepad;
+#endif
+	// device data and calibration of known controllers are read from the file instead of the device
+	JoyconVec joycons("joycon.cache");
+
+	// controllers connecting later are attached, vanished ones retired: keep running without devices
+	bool hotplug = false;
+#if defined(__linux__) && defined(JOYCON_TRANSPORT_HID)
+	hotplug = joycons.watch();
+#endif
+	if (joycons.addDevices()   == -1 && !hotplug) { Transport::exit();  return 0; }
+	if (joycons.startDevices() == -1 && !hotplug) { Transport::exit();  return 0; };
+
+#ifdef __linux__
+	// JOYCON_UINPUT=1: all devices as one virtual gamepad
+	if (std::getenv("JOYCON_UINPUT")) {
+		try {
+			gamepad.reset(new UinputGamepad());
+			joycons.set_gamepad(gamepad.get());
+		} catch (const std::runtime_error& e) {
+			std::cerr << e.what() << std::endl;
+		}
+	}
+#endif
 
 	while (!shutdown_flag) {
 		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+		std::vector<std::shared_ptr<Joycon>> devices = joycons.devices();
+		for (std::size_t i = 0; i < devices.size(); ++i) {
+			devices[i]->drain_reports([i](const StandardReport& report) {
+				std::cout << i << ": " << report << std::endl;
+			});
+		}
 	}
 
-	hid_exit();
+#ifdef __linux__
+	if (gamepad) {
+		HistogramSnapshot latency = gamepad->latency();
+		std::cerr << "uinput latency (us): p50 " << latency.percentile(50) << ", p99 " << latency.percentile(99) << ", max " << latency.max << std::endl;
+	}
+#endif
+
+	Transport::exit();
 	return 0;
 }
@@ -0,0 +1,100 @@
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mappedfile.h"
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) {
+
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		throw std::runtime_error("Could not open " + path);
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		throw std::runtime_error("Could not get the size of " + path);
+	}
+
+	len = static_cast<std::size_t>(size.QuadPart);
+	if (len == 0) {
+		return;		// empty files can not be mapped
+	}
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping != nullptr) {
+		ptr = static_cast<byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+
+	if (ptr == nullptr) {
+		if (mapping != nullptr) {
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		throw std::runtime_error("Could not map " + path);
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (ptr != nullptr) {
+		UnmapViewOfFile(ptr);
+	}
+	if (mapping != nullptr) {
+		CloseHandle(mapping);
+	}
+	if (file != nullptr) {
+		CloseHandle(file);
+	}
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		throw std::runtime_error("Could not open " + path + ": " + std::strerror(errno));
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == -1) {
+		int error = errno;
+		close(fd);
+		throw std::runtime_error("Could not stat " + path + ": " + std::strerror(error));
+	}
+
+	len = static_cast<std::size_t>(st.st_size);
+	if (len > 0) {
+		void* addr = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr == MAP_FAILED) {
+			int error = errno;
+			close(fd);
+			throw std::runtime_error("Could not map " + path + ": " + std::strerror(error));
+		}
+		ptr = static_cast<byte*>(addr);
+	}
+
+	// the mapping keeps the file alive
+	close(fd);
+}
+
+MappedFile::~MappedFile() {
+	if (ptr != nullptr) {
+		munmap(ptr, len);
+	}
+}
+
+#endif
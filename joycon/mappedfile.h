@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "types.h"
+
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile). Throws std::runtime_error if it can not be mapped.
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path);
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	const byte* data() const { return ptr; }
+	std::size_t size() const { return len; }
+	ByteView view() const { return ByteView(ptr, len); }
+
+private:
+	byte* ptr = nullptr;
+	std::size_t len = 0;
+
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#endif
+};
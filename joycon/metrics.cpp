@@ -0,0 +1,138 @@
+#include <cmath>
+
+#include "metrics.h"
+
+constexpr unsigned int HistogramSnapshot::SUB_BITS;
+constexpr unsigned int HistogramSnapshot::MAX_EXPONENT;
+constexpr std::size_t HistogramSnapshot::BUCKETS;
+constexpr std::chrono::milliseconds LinkMonitor::RESYNC_AFTER;
+
+/* ------ HISTOGRAM ------ */
+
+uint64_t HistogramSnapshot::lowest(std::size_t bucket) {
+	if (bucket < (1u << SUB_BITS)) {
+		return bucket;
+	}
+	unsigned int shift = static_cast<unsigned int>(bucket >> SUB_BITS) - 1;
+	return ((1u << SUB_BITS) + (bucket & ((1u << SUB_BITS) - 1))) << shift;
+}
+
+uint64_t HistogramSnapshot::highest(std::size_t bucket) {
+	if (bucket < (1u << SUB_BITS)) {
+		return bucket;
+	}
+	unsigned int shift = static_cast<unsigned int>(bucket >> SUB_BITS) - 1;
+	return lowest(bucket) + (uint64_t(1) << shift) - 1;
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const {
+	if (count == 0) {
+		return 0;
+	}
+
+	// rank of the value, 1 based
+	uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * count));
+	if (rank < 1) {
+		rank = 1;
+	}
+
+	uint64_t seen = 0;
+	for (std::size_t i = 0; i < BUCKETS; ++i) {
+		seen += counts[i];
+		if (seen >= rank) {
+			return highest(i) < max ? highest(i) : max;
+		}
+	}
+	return max;
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const {
+	HistogramSnapshot res;
+
+	// count first: the buckets hold at least that many values
+	res.count = count.load(std::memory_order_acquire);
+	res.sum = sum.load(std::memory_order_relaxed);
+	res.min = res.count == 0 ? 0 : min.load(std::memory_order_relaxed);
+	res.max = max.load(std::memory_order_relaxed);
+
+	uint64_t total = 0;
+	for (std::size_t i = 0; i < HistogramSnapshot::BUCKETS; ++i) {
+		res.counts[i] = counts[i].load(std::memory_order_relaxed);
+		total += res.counts[i];
+	}
+
+	// values recorded while copying: keep count and buckets consistent
+	res.count = total;
+	return res;
+}
+
+void LatencyHistogram::reset() {
+	for (auto& c : counts) {
+		c.store(0, std::memory_order_relaxed);
+	}
+	sum.store(0, std::memory_order_relaxed);
+	min.store(UINT64_MAX, std::memory_order_relaxed);
+	max.store(0, std::memory_order_relaxed);
+	count.store(0, std::memory_order_release);
+}
+
+/* ------ LINK ------ */
+
+LinkSnapshot LinkMetrics::snapshot() const {
+	LinkSnapshot res;
+	res.inter_arrival = inter_arrival.snapshot();
+	res.round_trip = round_trip.snapshot();
+	res.reports = reports.load(std::memory_order_relaxed);
+	res.lost_reports = lost_reports.load(std::memory_order_relaxed);
+	res.jitter_us = jitter_us.load(std::memory_order_relaxed);
+	res.write_failures = write_failures.load(std::memory_order_relaxed);
+	res.command_resends = command_resends.load(std::memory_order_relaxed);
+	res.command_failures = command_failures.load(std::memory_order_relaxed);
+	res.reconnects = reconnects.load(std::memory_order_relaxed);
+	res.commands_in_flight_max = commands_in_flight_max.load(std::memory_order_relaxed);
+	res.report_queue_max = report_queue_max.load(std::memory_order_relaxed);
+	return res;
+}
+
+void LinkMonitor::on_report(byte ID, byte timer, Clock::time_point arrival) {
+	LinkMetrics::increment(metrics.reports);
+
+	const bool standard = ID == 0x30 || ID == 0x31;
+	if (!standard && !(ID == 0x21 && periodic)) {
+		// 0x3F and the replies before the periodic mode come at no fixed rate
+		periodic = false;
+		return;
+	}
+
+	if (periodic && arrival - last_arrival < RESYNC_AFTER) {
+		// byte arithmetic: the timer wraps
+		const byte difference = static_cast<byte>(timer - last_timer);
+		if (difference != 0) {
+			if (++steps[difference] > steps[step]) {
+				step = difference;
+			}
+			if (difference > step && step != 0) {
+				// rounded, the timer of a report is not exactly on the step
+				LinkMetrics::increment(metrics.lost_reports, (difference + step / 2) / step - 1);
+			}
+		}
+	}
+
+	if (standard) {
+		if (periodic) {
+			const int64_t interval_us = std::chrono::duration_cast<std::chrono::microseconds>(arrival - last_arrival).count();
+			metrics.inter_arrival.record(static_cast<uint64_t>(interval_us > 0 ? interval_us : 0));
+
+			// J += (|D| - J) / 16 with D the change of the interval
+			if (last_interval_us >= 0) {
+				jitter_us += (std::abs(static_cast<double>(interval_us - last_interval_us)) - jitter_us) / 16.0;
+				metrics.jitter_us.store(static_cast<uint64_t>(jitter_us + 0.5), std::memory_order_relaxed);
+			}
+			last_interval_us = interval_us;
+		}
+		last_arrival = arrival;
+	}
+
+	periodic = true;
+	last_timer = timer;
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "types.h"
+
+/* ------ HISTOGRAM ------ */
+
+// The counts of a LatencyHistogram at one point in time.
+struct HistogramSnapshot {
+	// log-linear buckets (as HdrHistogram): values below 2^SUB_BITS get an own bucket, every power of 2 above is split into
+	// 2^SUB_BITS buckets (< 3.2% relative error). Values from 2^MAX_EXPONENT on go into the last bucket.
+	static constexpr unsigned int SUB_BITS = 5;
+	static constexpr unsigned int MAX_EXPONENT = 26;
+	static constexpr std::size_t BUCKETS = (MAX_EXPONENT - SUB_BITS + 1) << SUB_BITS;
+
+	static std::size_t bucket(uint64_t value) {
+		if (value < (1u << SUB_BITS)) {
+			return static_cast<std::size_t>(value);
+		}
+		if (value >> MAX_EXPONENT != 0) {
+			return BUCKETS - 1;
+		}
+		unsigned int exponent = SUB_BITS;
+		while (value >> (exponent + 1) != 0) {
+			++exponent;
+		}
+		return ((exponent - SUB_BITS + 1) << SUB_BITS) + static_cast<std::size_t>(value >> (exponent - SUB_BITS)) - (1u << SUB_BITS);
+	}
+	static uint64_t lowest(std::size_t bucket);		// smallest value of the bucket
+	static uint64_t highest(std::size_t bucket);	// largest value of the bucket
+
+	// The highest value of the bucket p (0 - 100) percent of the values are in or below, capped at max. 0 if empty.
+	uint64_t percentile(double p) const;
+	double mean() const { return count == 0 ? 0.0 : static_cast<double>(sum) / count; }
+
+	uint64_t count = 0;
+	uint64_t sum = 0;
+	uint64_t min = 0;
+	uint64_t max = 0;
+	std::array<uint64_t, BUCKETS> counts{};
+};
+
+// Lock free histogram of durations in microseconds. record() may be called from any thread.
+class LatencyHistogram {
+public:
+	LatencyHistogram() = default;
+	LatencyHistogram(const LatencyHistogram&) = delete;
+	LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+	void record(uint64_t value) {
+		counts[HistogramSnapshot::bucket(value)].fetch_add(1, std::memory_order_relaxed);
+		sum.fetch_add(value, std::memory_order_relaxed);
+
+		uint64_t current = min.load(std::memory_order_relaxed);
+		while (value < current && !min.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+		current = max.load(std::memory_order_relaxed);
+		while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+
+		// last, a snapshot never sees more values than counts
+		count.fetch_add(1, std::memory_order_release);
+	}
+
+	template <typename Rep, typename Period>
+	void record(std::chrono::duration<Rep, Period> duration) {
+		Rep us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+		this->record(static_cast<uint64_t>(us > 0 ? us : 0));
+	}
+
+	// Copies the counts (no lock, values recorded meanwhile may be missing). Reads the counts once.
+	HistogramSnapshot snapshot() const;
+
+	// not thread safe against record()
+	void reset();
+
+private:
+	std::atomic<uint64_t> count{ 0 };
+	std::atomic<uint64_t> sum{ 0 };
+	std::atomic<uint64_t> min{ UINT64_MAX };
+	std::atomic<uint64_t> max{ 0 };
+	std::array<std::atomic<uint64_t>, HistogramSnapshot::BUCKETS> counts{};
+};
+
+/* ------ LINK ------ */
+
+// Link quality of one device at one point in time.
+struct LinkSnapshot {
+	HistogramSnapshot inter_arrival;	// us between the periodic input reports (0x30, 0x31)
+	HistogramSnapshot round_trip;		// us from the first write of a subcommand to its reply (including resends)
+
+	uint64_t reports = 0;				// input reports read
+	uint64_t lost_reports = 0;			// missing periodic reports, found by gaps in the timer byte
+	uint64_t jitter_us = 0;				// smoothed inter-arrival jitter (as RFC 3550)
+
+	uint64_t write_failures = 0;
+	uint64_t command_resends = 0;		// subcommands written again after their timeout
+	uint64_t command_failures = 0;		// subcommands without reply after all retries
+	uint64_t reconnects = 0;			// the device came back (see Joycon::reconnect())
+
+	// queue depths: current and highest
+	uint64_t commands_in_flight = 0;
+	uint64_t commands_in_flight_max = 0;
+	uint64_t report_queue = 0;			// decoded reports not consumed yet
+	uint64_t report_queue_max = 0;
+	uint64_t reports_dropped = 0;		// decoded reports lost because the consumer was too slow
+
+	double loss_rate() const { return reports + lost_reports == 0 ? 0.0 : static_cast<double>(lost_reports) / (reports + lost_reports); }
+};
+
+// Counters and histograms of one device, updated by the reader and the command threads. Lock free.
+struct LinkMetrics {
+	LinkMetrics() = default;
+	LinkMetrics(const LinkMetrics&) = delete;
+	LinkMetrics& operator=(const LinkMetrics&) = delete;
+
+	static void increment(std::atomic<uint64_t>& counter, uint64_t amount = 1) {
+		counter.fetch_add(amount, std::memory_order_relaxed);
+	}
+	static void update_max(std::atomic<uint64_t>& counter, uint64_t value) {
+		uint64_t current = counter.load(std::memory_order_relaxed);
+		while (value > current && !counter.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+	}
+
+	// everything except the current queue depths (the owner of the queues adds them)
+	LinkSnapshot snapshot() const;
+
+	LatencyHistogram inter_arrival;
+	LatencyHistogram round_trip;
+
+	std::atomic<uint64_t> reports{ 0 };
+	std::atomic<uint64_t> lost_reports{ 0 };
+	std::atomic<uint64_t> jitter_us{ 0 };
+	std::atomic<uint64_t> write_failures{ 0 };
+	std::atomic<uint64_t> command_resends{ 0 };
+	std::atomic<uint64_t> command_failures{ 0 };
+	std::atomic<uint64_t> reconnects{ 0 };
+	std::atomic<uint64_t> commands_in_flight_max{ 0 };
+	std::atomic<uint64_t> report_queue_max{ 0 };
+};
+
+// Reader side: turns the arrival of the input reports into the report metrics. Only used by the reader thread.
+// The timer byte of the periodic reports (0x30, 0x31 and the 0x21 replies between them) counts up by a fixed step,
+// the most frequent difference seen. A larger difference means reports were lost on the way.
+class LinkMonitor {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// longer pauses may hide a wrap of the timer, the gap is not counted
+	static constexpr std::chrono::milliseconds RESYNC_AFTER{ 500 };
+
+	explicit LinkMonitor(LinkMetrics& metrics) : metrics(metrics) {}
+
+	void on_report(byte ID, byte timer, Clock::time_point arrival);
+
+	// a new link (e.g. a reconnect): the timer starts again, the next report is no gap to the last one
+	void reset() { periodic = false; last_interval_us = -1; }
+
+private:
+	LinkMetrics& metrics;
+
+	bool periodic = false;			// the last report was part of the periodic stream
+	byte last_timer = 0;
+	Clock::time_point last_arrival;
+	int64_t last_interval_us = -1;
+	double jitter_us = 0.0;
+
+	std::array<uint32_t, 256> steps{};	// frequency of the timer differences
+	byte step = 0;						// the most frequent one
+};
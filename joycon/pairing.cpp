@@ -0,0 +1,47 @@
+#include <algorithm>
+#include <cstring>
+
+#include "pairing.h"
+
+namespace {
+
+void init_side(PairedSide& side) {
+	std::memset(&side, 0, sizeof(side));
+	side.orientation[0] = 1.0f;
+}
+
+} // namespace
+
+PairMerger::PairMerger() {
+	std::memset(&state, 0, sizeof(state));
+	init_side(state.left);
+	init_side(state.right);
+}
+
+const PairedState& PairMerger::add(const StandardReport& report, bool left) {
+	PairedSide& side = left ? state.left : state.right;
+	PairedSide& other = left ? state.right : state.left;
+
+	side.timestamp_ns = report.timestamp_ns;
+	side.battery = report.battery;
+	if (left) {
+		std::copy(report.left_stick, report.left_stick + 2, side.stick);
+	} else {
+		std::copy(report.right_stick, report.right_stick + 2, side.stick);
+	}
+
+	// reports without IMU data (0x21, 0x3F) keep the samples and the orientation
+	side.IMU_samples = report.IMU_samples;
+	if (report.IMU_samples > 0) {
+		std::copy(report.IMU, report.IMU + 3, side.IMU);
+		std::copy(report.orientation, report.orientation + 4, side.orientation);
+	}
+	other.IMU_samples = 0;
+
+	const uint32_t mask = left ? LEFT_BUTTONS : RIGHT_BUTTONS;
+	state.buttons = (state.buttons & ~mask) | (report.buttons & mask);
+
+	// frames stay in order, even if a report of the other side was late
+	state.timestamp_ns = std::max(state.timestamp_ns, report.timestamp_ns);
+	return state;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+#include "report.h"
+#include "types.h"
+
+// buttons a left / right Joy-Con reports (SL and SR exist on both)
+constexpr uint32_t LEFT_BUTTONS = BUTTON_DOWN | BUTTON_UP | BUTTON_RIGHT | BUTTON_LEFT | BUTTON_LEFT_SR | BUTTON_LEFT_SL | BUTTON_L
+	| BUTTON_ZL | BUTTON_MINUS | BUTTON_LEFT_STICK | BUTTON_CAPTURE | BUTTON_CHARGING_GRIP;
+constexpr uint32_t RIGHT_BUTTONS = BUTTON_Y | BUTTON_X | BUTTON_B | BUTTON_A | BUTTON_RIGHT_SR | BUTTON_RIGHT_SL | BUTTON_R
+	| BUTTON_ZR | BUTTON_PLUS | BUTTON_RIGHT_STICK | BUTTON_HOME | BUTTON_CHARGING_GRIP;
+
+// one Joy-Con of a pair, as of its latest report
+struct PairedSide {
+	uint64_t timestamp_ns;	// of the report, see StandardReport::timestamp_ns
+	byte battery;
+	uint16_t stick[2];		// x, y (12 bit)
+	byte IMU_samples;		// new samples in this frame: 3 if this side's report started the frame, else 0
+	IMUSample IMU[3];		// latest samples, oldest first
+	float orientation[4];	// w, x, y, z after the latest sample
+};
+
+// A left and a right Joy-Con as one controller. The sides keep the axes of their device.
+struct PairedState {
+	uint64_t timestamp_ns;	// of the report that produced the frame
+	uint32_t buttons;		// BUTTONS bitmask of both
+	PairedSide left;
+	PairedSide right;
+
+	// how much older the other side is than the report of the frame
+	uint64_t skew_ns() const { return left.timestamp_ns > right.timestamp_ns ? left.timestamp_ns - right.timestamp_ns : right.timestamp_ns - left.timestamp_ns; }
+};
+
+// Merges the report streams of a left and a right Joy-Con. Every report makes a frame right away, with the latest
+// report before it of the other side (sample and hold): no waiting for the other device, no added latency.
+// Feed the reports of both sides in timestamp order, see merge().
+class PairMerger {
+public:
+	PairMerger();
+
+	// Returns the frame of report, of the left Joy-Con if left.
+	const PairedState& add(const StandardReport& report, bool left);
+
+	// Adds the reports of both sides (each in time order) interleaved by timestamp, calls f(const PairedState&) per frame.
+	template <typename F>
+	void merge(const StandardReport* left, std::size_t left_count, const StandardReport* right, std::size_t right_count, F f) {
+		std::size_t l = 0;
+		std::size_t r = 0;
+		while (l < left_count || r < right_count) {
+			const bool take_left = r == right_count || (l < left_count && left[l].timestamp_ns <= right[r].timestamp_ns);
+			f(take_left ? this->add(left[l++], true) : this->add(right[r++], false));
+		}
+	}
+
+	const PairedState& frame() const { return state; }
+
+private:
+	PairedState state;
+};
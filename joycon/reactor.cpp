@@ -0,0 +1,202 @@
+#ifdef __linux__
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "reactor.h"
+
+#define MAX_EVENTS 64
+
+Reactor::Reactor() {
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd == -1) {
+		throw std::runtime_error(std::string("epoll_create1 failed: ") + std::strerror(errno));
+	}
+
+	wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (wake_fd == -1) {
+		close(epoll_fd);
+		throw std::runtime_error(std::string("eventfd failed: ") + std::strerror(errno));
+	}
+
+	epoll_event ev{};
+	ev.events = EPOLLIN;
+	ev.data.ptr = nullptr;	// nullptr -> wake up
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev) == -1) {
+		close(wake_fd);
+		close(epoll_fd);
+		throw std::runtime_error(std::string("epoll_ctl failed: ") + std::strerror(errno));
+	}
+}
+
+Reactor::~Reactor() {
+	stop();
+	close(wake_fd);
+	close(epoll_fd);
+}
+
+void Reactor::add(int fd, Handler handler, FailureHandler on_failure) {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (loop_failed) {
+		throw std::runtime_error("The reactor failed, fd " + std::to_string(fd) + " would never be read.");
+	}
+	if (entries.find(fd) != entries.end()) {
+		throw std::invalid_argument("fd " + std::to_string(fd) + " is already registered.");
+	}
+
+	std::unique_ptr<Entry> entry(new Entry{ fd, std::move(handler), std::move(on_failure), false });
+
+	epoll_event ev{};
+	ev.events = EPOLLIN;
+	ev.data.ptr = entry.get();
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+		throw std::runtime_error(std::string("epoll_ctl failed: ") + std::strerror(errno));
+	}
+
+	entries.emplace(fd, std::move(entry));
+}
+
+void Reactor::remove(int fd) {
+	std::lock_guard<std::mutex> lock(mutex);
+	erase(fd);
+}
+
+// mutex must be held
+void Reactor::erase(int fd) {
+
+	auto it = entries.find(fd);
+	if (it == entries.end()) {
+		return;
+	}
+
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+
+	// events of the current batch may still point to the entry -> free it after the batch
+	it->second->removed = true;
+	retired.push_back(std::move(it->second));
+	entries.erase(it);
+}
+
+std::size_t Reactor::size() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return entries.size();
+}
+
+void Reactor::start() {
+	if (alive.exchange(true)) {
+		return;
+	}
+	thread = std::thread(&Reactor::loop, this);
+}
+
+void Reactor::stop() {
+	if (!alive.exchange(false)) {
+		return;
+	}
+
+	uint64_t one = 1;
+	if (write(wake_fd, &one, sizeof(one)) == -1) {
+		// eventfd counter can not overflow here, the loop still sees alive == false on its next wake up
+	}
+
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+void Reactor::loop() {
+
+	epoll_event events[MAX_EVENTS];
+
+	while (alive) {
+		int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+		if (n == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			// the loop runs in its own thread: nobody could catch an exception
+			this->fail(std::string("epoll_wait failed: ") + std::strerror(errno));
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for (int i = 0; i < n; ++i) {
+			Entry* entry = static_cast<Entry*>(events[i].data.ptr);
+
+			if (entry == nullptr) {
+				uint64_t value;
+				while (read(wake_fd, &value, sizeof(value)) > 0) {}
+				continue;
+			}
+
+			if (entry->removed) {
+				continue;
+			}
+
+			if (!entry->handler()) {
+				erase(entry->fd);
+			}
+		}
+
+		retired.clear();
+	}
+}
+
+void Reactor::fail(const std::string& error) {
+	LOG(LOG_ERROR) << "Reactor stopped: " << error;
+	loop_failed = true;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& entry : entries) {
+		if (entry.second->on_failure) {
+			entry.second->on_failure();
+		}
+	}
+	while (!entries.empty()) {
+		erase(entries.begin()->first);
+	}
+	retired.clear();
+}
+
+/* ---- REACTOR POOL ---- */
+
+ReactorPool::ReactorPool(std::size_t threads) {
+	if (threads == 0) {
+		throw std::invalid_argument("ReactorPool needs at least one thread.");
+	}
+	for (std::size_t i = 0; i < threads; ++i) {
+		reactors.emplace_back(new Reactor());
+	}
+}
+
+Reactor& ReactorPool::add(int fd, Reactor::Handler handler, Reactor::FailureHandler on_failure) {
+	Reactor& reactor = *reactors[next];
+	next = (next + 1) % reactors.size();
+
+	reactor.add(fd, std::move(handler), std::move(on_failure));
+	return reactor;
+}
+
+void ReactorPool::start() {
+	for (auto& reactor : reactors) {
+		reactor->start();
+	}
+}
+
+void ReactorPool::stop() {
+	for (auto& reactor : reactors) {
+		reactor->stop();
+	}
+}
+
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Multiplexes many file descriptors (e.g. /dev/hidrawX) in one epoll loop running in its own thread.
+// The handler of a readable fd should read until EAGAIN; it returns false to unregister itself (e.g. device is gone).
+// If epoll itself fails, the loop logs it, calls the failure handlers of all fds, unregisters them and ends.
+class Reactor {
+public:
+	using Handler = std::function<bool()>;
+	using FailureHandler = std::function<void()>;
+
+	Reactor();
+	Reactor(const Reactor&) = delete;
+	Reactor& operator=(const Reactor&) = delete;
+	~Reactor();
+
+	// thread safe. fd must stay open until remove() returned. on_failure (optional) runs in the loop if it fails.
+	void add(int fd, Handler handler, FailureHandler on_failure = nullptr);
+	// thread safe, but must not be called from inside a handler (return false instead).
+	void remove(int fd);
+
+	std::size_t size() const;
+
+	// the loop ended because epoll failed
+	bool failed() const { return loop_failed; }
+
+	void start();
+	void stop();
+
+private:
+	struct Entry {
+		int fd;
+		Handler handler;
+		FailureHandler on_failure;
+		bool removed;
+	};
+
+	void loop();
+	void erase(int fd);
+	void fail(const std::string& error);
+
+	int epoll_fd = -1;
+	int wake_fd = -1;
+
+	std::thread thread;
+	std::atomic<bool> alive{ false };
+	std::atomic<bool> loop_failed{ false };
+
+	// held by the loop while dispatching, so entries can not vanish under a running handler
+	mutable std::mutex mutex;
+	std::unordered_map<int, std::unique_ptr<Entry>> entries;
+	std::vector<std::unique_ptr<Entry>> retired;
+};
+
+// Shards file descriptors over N reactors (one thread each), round robin.
+class ReactorPool {
+public:
+	explicit ReactorPool(std::size_t threads = 1);
+
+	// returns the reactor the fd was added to
+	Reactor& add(int fd, Reactor::Handler handler, Reactor::FailureHandler on_failure = nullptr);
+
+	void start();
+	void stop();
+
+	std::size_t size() const { return reactors.size(); }
+	Reactor& reactor(std::size_t idx) { return *reactors.at(idx); }
+
+private:
+	std::vector<std::unique_ptr<Reactor>> reactors;
+	std::size_t next = 0;
+};
+
+#endif
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "recorder.h"
+
+namespace {
+
+const char MAGIC[4] = { 'J', 'C', 'R', 'L' };
+const byte VERSION = 1;
+
+std::size_t align8(std::size_t size) {
+	return (size + 7) & ~static_cast<std::size_t>(7);
+}
+
+} // namespace
+
+constexpr std::size_t ReportRecorder::FILE_HEADER_SIZE;
+constexpr std::size_t ReportRecorder::RECORD_HEADER_SIZE;
+
+/* ------ REPORTRECORDER ------ */
+
+#ifdef _WIN32
+
+ReportRecorder::ReportRecorder(const std::string& path, std::size_t capacity) : path(path), size(capacity) {
+
+	if (capacity < FILE_HEADER_SIZE) {
+		throw std::invalid_argument("capacity is smaller than the file header.");
+	}
+
+	file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		throw std::runtime_error("Could not create " + path);
+	}
+
+	// the mapping grows the file, new pages are zero
+	ULARGE_INTEGER mapping_size;
+	mapping_size.QuadPart = capacity;
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, mapping_size.HighPart, mapping_size.LowPart, nullptr);
+	if (mapping != nullptr) {
+		base = static_cast<byte*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, capacity));
+	}
+
+	if (base == nullptr) {
+		if (mapping != nullptr) {
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		throw std::runtime_error("Could not map " + path);
+	}
+
+	std::copy(MAGIC, MAGIC + 4, base);
+	base[4] = VERSION;
+}
+
+ReportRecorder::~ReportRecorder() {
+	FlushViewOfFile(base, 0);
+	UnmapViewOfFile(base);
+	CloseHandle(mapping);
+
+	LARGE_INTEGER end;
+	end.QuadPart = this->used();
+	SetFilePointerEx(file, end, nullptr, FILE_BEGIN);
+	SetEndOfFile(file);
+	CloseHandle(file);
+}
+
+void ReportRecorder::flush() {
+	FlushViewOfFile(base, 0);
+}
+
+#else
+
+ReportRecorder::ReportRecorder(const std::string& path, std::size_t capacity) : path(path), size(capacity) {
+
+	if (capacity < FILE_HEADER_SIZE) {
+		throw std::invalid_argument("capacity is smaller than the file header.");
+	}
+
+	fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd == -1) {
+		throw std::runtime_error("Could not create " + path + ": " + std::strerror(errno));
+	}
+
+	// allocate the blocks now, not on the first write into a page (falls back to a sparse file)
+	int res = posix_fallocate(fd, 0, capacity);
+	if (res != 0 && ftruncate(fd, capacity) == -1) {
+		res = errno;
+		close(fd);
+		throw std::runtime_error("Could not allocate " + path + ": " + std::strerror(res));
+	}
+
+	void* addr = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED) {
+		res = errno;
+		close(fd);
+		throw std::runtime_error("Could not map " + path + ": " + std::strerror(res));
+	}
+	base = static_cast<byte*>(addr);
+
+	std::copy(MAGIC, MAGIC + 4, base);
+	base[4] = VERSION;
+}
+
+ReportRecorder::~ReportRecorder() {
+	munmap(base, size);
+	if (ftruncate(fd, this->used()) == -1) {
+		// keeps the preallocated tail, the reader stops at the first empty record anyway
+	}
+	close(fd);
+}
+
+void ReportRecorder::flush() {
+	msync(base, size, MS_ASYNC);
+}
+
+#endif
+
+bool ReportRecorder::record(RECORD_DIRECTION direction, uint16_t device, ByteView data) noexcept {
+	return this->record(direction, device, data, now());
+}
+
+bool ReportRecorder::record(RECORD_DIRECTION direction, uint16_t device, ByteView data, uint64_t timestamp_ns) noexcept {
+
+	const uint32_t record_size = static_cast<uint32_t>(RECORD_HEADER_SIZE + data.size());
+	const std::size_t reserved = align8(record_size);
+
+	std::size_t offset = tail.load(std::memory_order_relaxed);
+	do {
+		if (offset + reserved > size) {
+			drop_count.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+	} while (!tail.compare_exchange_weak(offset, offset + reserved, std::memory_order_relaxed));
+
+	byte* rec = base + offset;
+	std::memcpy(rec + 4, &device, 2);
+	rec[6] = direction;
+	std::memcpy(rec + 8, &timestamp_ns, 8);
+	std::memcpy(rec + RECORD_HEADER_SIZE, data.data(), data.size());
+
+	// commit: the size becomes visible after the content
+	std::atomic_thread_fence(std::memory_order_release);
+	reinterpret_cast<volatile uint32_t*>(rec)[0] = record_size;
+
+	return true;
+}
+
+std::size_t ReportRecorder::used() const {
+	return std::min(tail.load(std::memory_order_relaxed), size);
+}
+
+uint64_t ReportRecorder::now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* ------ RECORDREADER ------ */
+
+RecordReader::RecordReader(const std::string& path) : file(path) {
+	if (file.size() < ReportRecorder::FILE_HEADER_SIZE || !std::equal(MAGIC, MAGIC + 4, file.data()) || file.data()[4] != VERSION) {
+		throw std::runtime_error(path + " is no report log.");
+	}
+}
+
+bool RecordReader::next(Record& record) {
+
+	if (offset + ReportRecorder::RECORD_HEADER_SIZE > file.size()) {
+		return false;
+	}
+
+	const byte* rec = file.data() + offset;
+
+	uint32_t record_size = reinterpret_cast<const volatile uint32_t*>(rec)[0];
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	if (record_size < ReportRecorder::RECORD_HEADER_SIZE || offset + record_size > file.size()) {
+		return false;	// not (yet) written
+	}
+
+	std::memcpy(&record.device, rec + 4, 2);
+	record.direction = static_cast<RECORD_DIRECTION>(rec[6]);
+	std::memcpy(&record.timestamp_ns, rec + 8, 8);
+	record.data = ByteView(rec + ReportRecorder::RECORD_HEADER_SIZE, record_size - ReportRecorder::RECORD_HEADER_SIZE);
+
+	offset += align8(record_size);
+	return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "mappedfile.h"
+#include "types.h"
+
+enum RECORD_DIRECTION : uint8_t {
+	RECORD_INPUT = 0,	// report read from the device
+	RECORD_OUTPUT = 1	// report written to the device
+};
+
+// Append-only log of raw reports in a preallocated, memory mapped file (host byte order):
+// header: "JCRL" | version (1 byte) | 3 byte reserved
+// record: size (4 byte, header + data) | device (2) | direction (1) | reserved (1) | host monotonic time in ns (8) | data
+// Records start 8 byte aligned. The size is written last, so a crash leaves the log readable up to the first
+// record that was not completed. Closing the recorder cuts the file to the used size.
+class ReportRecorder {
+public:
+	static constexpr std::size_t FILE_HEADER_SIZE = 8;
+	static constexpr std::size_t RECORD_HEADER_SIZE = 16;
+
+	// creates (or overwrites) path with capacity bytes. Throws std::runtime_error on failure.
+	ReportRecorder(const std::string& path, std::size_t capacity);
+	ReportRecorder(const ReportRecorder&) = delete;
+	ReportRecorder& operator=(const ReportRecorder&) = delete;
+	~ReportRecorder();
+
+	// Lock free, any thread: reserves the space with one compare-exchange and copies data. No system call.
+	// Returns false (and counts the record as dropped) if the file is full.
+	bool record(RECORD_DIRECTION direction, uint16_t device, ByteView data) noexcept;
+	bool record(RECORD_DIRECTION direction, uint16_t device, ByteView data, uint64_t timestamp_ns) noexcept;
+
+	// asks the OS to write the dirty pages back (without waiting)
+	void flush();
+
+	std::size_t used() const;
+	std::size_t capacity() const { return size; }
+	std::size_t dropped() const { return drop_count.load(std::memory_order_relaxed); }
+
+	// steady clock in ns, the time base of the records
+	static uint64_t now();
+
+private:
+	std::string path;
+	byte* base = nullptr;
+	std::size_t size;
+
+	std::atomic<std::size_t> tail{ FILE_HEADER_SIZE };
+	std::atomic<std::size_t> drop_count{ 0 };
+
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int fd = -1;
+#endif
+};
+
+struct Record {
+	RECORD_DIRECTION direction;
+	uint16_t device;
+	uint64_t timestamp_ns;
+	ByteView data;		// points into the mapped log
+};
+
+// Reads a log of ReportRecorder, also one that is still written or was left behind by a crash.
+class RecordReader {
+public:
+	// Throws std::runtime_error if path is no report log.
+	explicit RecordReader(const std::string& path);
+
+	// Returns false at the end of the log (or at the first incomplete record).
+	bool next(Record& record);
+
+private:
+	MappedFile file;
+	std::size_t offset = ReportRecorder::FILE_HEADER_SIZE;
+};
@@ -0,0 +1,152 @@
+#include "report.h"
+
+namespace {
+
+template <std::size_t OFFSET>
+inline uint16_t read_uint16(const byte* data) {
+	return static_cast<uint16_t>(data[OFFSET] | (data[OFFSET + 1] << 8));
+}
+
+template <std::size_t OFFSET>
+inline int16_t read_int16(const byte* data) {
+	return static_cast<int16_t>(read_uint16<OFFSET>(data));
+}
+
+// 3 byte: x (12 bit) | y (12 bit)
+template <std::size_t OFFSET>
+inline uint16_t read_stick_x(const byte* data) {
+	return static_cast<uint16_t>(data[OFFSET] | ((data[OFFSET + 1] & 0x0F) << 8));
+}
+
+template <std::size_t OFFSET>
+inline uint16_t read_stick_y(const byte* data) {
+	return static_cast<uint16_t>((data[OFFSET + 1] >> 4) | (data[OFFSET + 2] << 4));
+}
+
+template <std::size_t SAMPLE>
+inline void read_IMU_sample(const byte* data, IMUSample& sample) {
+	constexpr std::size_t offset = report_offset::IMU + SAMPLE * report_offset::IMU_SAMPLE_SIZE;
+	sample.accel[0] = read_int16<offset + 0>(data);
+	sample.accel[1] = read_int16<offset + 2>(data);
+	sample.accel[2] = read_int16<offset + 4>(data);
+	sample.gyro[0] = read_int16<offset + 6>(data);
+	sample.gyro[1] = read_int16<offset + 8>(data);
+	sample.gyro[2] = read_int16<offset + 10>(data);
+}
+
+void decode_standard(const byte* data, StandardReport& out) {
+	out.battery = data[report_offset::BATTERY_CONNECTION] >> 4;
+	out.connection_info = data[report_offset::BATTERY_CONNECTION] & 0x0F;
+	out.buttons = data[report_offset::BUTTONS]
+		| (data[report_offset::BUTTONS + 1] << 8)
+		| (data[report_offset::BUTTONS + 2] << 16);
+	out.left_stick[0] = read_stick_x<report_offset::LEFT_STICK>(data);
+	out.left_stick[1] = read_stick_y<report_offset::LEFT_STICK>(data);
+	out.right_stick[0] = read_stick_x<report_offset::RIGHT_STICK>(data);
+	out.right_stick[1] = read_stick_y<report_offset::RIGHT_STICK>(data);
+	out.vibrator = data[report_offset::VIBRATOR];
+	out.stick_hat = 8;
+}
+
+void decode_simple(const byte* data, JOY_PID PID, StandardReport& out) {
+
+	const byte& face = data[report_offset::SIMPLE_BUTTONS];
+	const byte& shared = data[report_offset::SIMPLE_BUTTONS + 1];
+
+	uint32_t buttons = 0;
+	if (PID == JOYCON_R_BT) {
+		if (face & 0x01) { buttons |= BUTTON_A; }
+		if (face & 0x02) { buttons |= BUTTON_X; }
+		if (face & 0x04) { buttons |= BUTTON_B; }
+		if (face & 0x08) { buttons |= BUTTON_Y; }
+		if (face & 0x10) { buttons |= BUTTON_RIGHT_SL; }
+		if (face & 0x20) { buttons |= BUTTON_RIGHT_SR; }
+		if (shared & 0x40) { buttons |= BUTTON_R; }
+		if (shared & 0x80) { buttons |= BUTTON_ZR; }
+	} else {
+		if (face & 0x01) { buttons |= BUTTON_DOWN; }
+		if (face & 0x02) { buttons |= BUTTON_RIGHT; }
+		if (face & 0x04) { buttons |= BUTTON_LEFT; }
+		if (face & 0x08) { buttons |= BUTTON_UP; }
+		if (face & 0x10) { buttons |= BUTTON_LEFT_SL; }
+		if (face & 0x20) { buttons |= BUTTON_LEFT_SR; }
+		if (shared & 0x40) { buttons |= BUTTON_L; }
+		if (shared & 0x80) { buttons |= BUTTON_ZL; }
+	}
+	if (shared & 0x01) { buttons |= BUTTON_MINUS; }
+	if (shared & 0x02) { buttons |= BUTTON_PLUS; }
+	if (shared & 0x04) { buttons |= BUTTON_LEFT_STICK; }
+	if (shared & 0x08) { buttons |= BUTTON_RIGHT_STICK; }
+	if (shared & 0x10) { buttons |= BUTTON_HOME; }
+	if (shared & 0x20) { buttons |= BUTTON_CAPTURE; }
+
+	out.battery = 0;
+	out.connection_info = 0;
+	out.buttons = buttons;
+	out.stick_hat = data[report_offset::SIMPLE_STICK_HAT];
+
+	// 16 bit sticks -> 12 bit
+	out.left_stick[0] = read_uint16<report_offset::SIMPLE_LEFT_STICK>(data) >> 4;
+	out.left_stick[1] = read_uint16<report_offset::SIMPLE_LEFT_STICK + 2>(data) >> 4;
+	out.right_stick[0] = read_uint16<report_offset::SIMPLE_RIGHT_STICK>(data) >> 4;
+	out.right_stick[1] = read_uint16<report_offset::SIMPLE_RIGHT_STICK + 2>(data) >> 4;
+	out.vibrator = 0;
+}
+
+} // namespace
+
+bool decode_report(const InputBuffer& in, JOY_PID PID, StandardReport& out) {
+
+	const byte* data = in.data();
+	const byte& ID = data[report_offset::ID];
+
+	switch (ID) {
+	case 0x21:
+		decode_standard(data, out);
+		out.IMU_samples = 0;
+		break;
+	case 0x30:
+	case 0x31:
+		decode_standard(data, out);
+		read_IMU_sample<0>(data, out.IMU[0]);
+		read_IMU_sample<1>(data, out.IMU[1]);
+		read_IMU_sample<2>(data, out.IMU[2]);
+		out.IMU_samples = 3;
+		break;
+	case 0x3F:
+		decode_simple(data, PID, out);
+		out.IMU_samples = 0;
+		break;
+	default:
+		return false;
+	}
+
+	out.ID = ID;
+	out.orientation[0] = 1.0f;
+	out.orientation[1] = out.orientation[2] = out.orientation[3] = 0.0f;
+	out.timer = (ID == 0x3F) ? 0 : data[report_offset::TIMER];
+	out.timestamp_ns = 0;
+
+	return true;
+}
+
+POWER get_battery_level(const StandardReport& report) {
+	return to_power(report.battery);
+}
+
+std::ostream& operator<<(std::ostream& os, const StandardReport& report) {
+	os << std::hex << static_cast<unsigned int>(report.ID) << " | ";
+	os << std::dec << static_cast<unsigned int>(report.timer) << " | ";
+	os << "buttons " << std::hex << report.buttons << " | ";
+	os << std::dec << "L " << report.left_stick[0] << " " << report.left_stick[1] << " | ";
+	os << "R " << report.right_stick[0] << " " << report.right_stick[1];
+	for (byte i = 0; i < report.IMU_samples; ++i) {
+		const IMUSample& sample = report.IMU[i];
+		os << " | acc " << sample.accel[0] << " " << sample.accel[1] << " " << sample.accel[2];
+		os << " gyro " << sample.gyro[0] << " " << sample.gyro[1] << " " << sample.gyro[2];
+	}
+	if (report.IMU_samples > 0) {
+		os << " | q " << report.orientation[0] << " " << report.orientation[1] << " " << report.orientation[2] << " " << report.orientation[3];
+	}
+	return os;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+
+#include "buffer.h"
+#include "types.h"
+
+// Button status (byte 3 - 5 of every standard input report).
+// byte 3 -> bit 0 - 7, byte 4 -> bit 8 - 15, byte 5 -> bit 16 - 23
+enum BUTTONS : uint32_t {
+	BUTTON_Y = 1 << 0,
+	BUTTON_X = 1 << 1,
+	BUTTON_B = 1 << 2,
+	BUTTON_A = 1 << 3,
+	BUTTON_RIGHT_SR = 1 << 4,
+	BUTTON_RIGHT_SL = 1 << 5,
+	BUTTON_R = 1 << 6,
+	BUTTON_ZR = 1 << 7,
+	BUTTON_MINUS = 1 << 8,
+	BUTTON_PLUS = 1 << 9,
+	BUTTON_RIGHT_STICK = 1 << 10,
+	BUTTON_LEFT_STICK = 1 << 11,
+	BUTTON_HOME = 1 << 12,
+	BUTTON_CAPTURE = 1 << 13,
+	BUTTON_CHARGING_GRIP = 1 << 15,
+	BUTTON_DOWN = 1 << 16,
+	BUTTON_UP = 1 << 17,
+	BUTTON_RIGHT = 1 << 18,
+	BUTTON_LEFT = 1 << 19,
+	BUTTON_LEFT_SR = 1 << 20,
+	BUTTON_LEFT_SL = 1 << 21,
+	BUTTON_L = 1 << 22,
+	BUTTON_ZL = 1 << 23
+};
+
+// byte offsets inside an input report
+namespace report_offset {
+	constexpr std::size_t ID = 0;
+	constexpr std::size_t TIMER = 1;
+	constexpr std::size_t BATTERY_CONNECTION = 2;
+	constexpr std::size_t BUTTONS = 3;
+	constexpr std::size_t LEFT_STICK = 6;
+	constexpr std::size_t RIGHT_STICK = 9;
+	constexpr std::size_t VIBRATOR = 12;
+	constexpr std::size_t IMU = 13;				// 3 samples: accel x,y,z | gyro x,y,z (int16, little endian)
+	constexpr std::size_t IMU_SAMPLE_SIZE = 12;
+
+	// ID 3F (simple HID mode)
+	constexpr std::size_t SIMPLE_BUTTONS = 1;
+	constexpr std::size_t SIMPLE_STICK_HAT = 3;
+	constexpr std::size_t SIMPLE_LEFT_STICK = 4;	// x,y (uint16, little endian)
+	constexpr std::size_t SIMPLE_RIGHT_STICK = 8;	// x,y (uint16, little endian)
+}
+
+#pragma pack(push, 1)
+
+struct IMUSample {
+	int16_t accel[3];	// x, y, z
+	int16_t gyro[3];	// x, y, z
+};
+
+// decoded standard part of the input reports 21, 30, 31 and 3F
+struct StandardReport {
+	byte ID;
+	byte timer;
+	byte battery;			// 8=full, 6=medium, 4=low, 2=critical, 0=empty. +1 if charging.
+	byte connection_info;	// bit 0: Switch/USB powered, bit 1 - 2: 3=Joy-Con, 0=Pro/ChrGrip
+	uint32_t buttons;		// BUTTONS bitmask
+	uint16_t left_stick[2];	// x, y (12 bit)
+	uint16_t right_stick[2];// x, y (12 bit)
+	byte vibrator;
+	byte stick_hat;			// only ID 3F: 0 - 7 (clockwise, 0 = up), 8 = neutral
+	byte IMU_samples;		// valid entries in IMU (3 for ID 30 / 31, else 0)
+	IMUSample IMU[3];		// oldest sample first
+	float orientation[4];	// w, x, y, z: IMU fusion after the last sample (see FusionBank), 1 0 0 0 without
+	uint64_t timestamp_ns;	// host steady clock when the device sent the report (see DeviceClock), 0 without
+};
+
+#pragma pack(pop)
+
+// Change of the buttons between two reports of a device. All masks are BUTTONS bitmasks.
+struct ButtonEvent {
+	uint64_t timestamp_ns;	// of the report, see StandardReport::timestamp_ns
+	uint32_t pressed;		// down now, up before
+	uint32_t released;		// up now, down before
+	uint32_t held;			// down before and now
+};
+
+// Fills event from the buttons of the previous report. Returns false (event unchanged) if no button changed.
+inline bool button_edges(uint32_t previous, const StandardReport& report, ButtonEvent& event) {
+	const uint32_t changed = previous ^ report.buttons;
+	if (changed == 0) {
+		return false;
+	}
+	event.timestamp_ns = report.timestamp_ns;
+	event.pressed = changed & report.buttons;
+	event.released = changed & previous;
+	event.held = previous & report.buttons;
+	return true;
+}
+
+// Decodes the standard part of in into out. Returns false (out unchanged) if the report ID is not 21, 30, 31 or 3F.
+// PID is needed for ID 3F, which shares the face button bits between left and right Joy-Con.
+bool decode_report(const InputBuffer& in, JOY_PID PID, StandardReport& out);
+
+POWER get_battery_level(const StandardReport& report);
+
+std::ostream& operator<<(std::ostream& os, const StandardReport& report);
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+#define CACHE_LINE_SIZE 64
+
+// Bounded, lock-free single-producer/single-consumer ring.
+// push() is only called from one thread (the reader), pop()/drain() only from one other thread.
+// A full ring does not block the producer: the new item is dropped and counted as overflow.
+// N must be a power of 2.
+template <typename T, std::size_t N>
+class SPSCRingBuffer {
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of 2.");
+
+public:
+	SPSCRingBuffer() = default;
+	SPSCRingBuffer(const SPSCRingBuffer&) = delete;
+	SPSCRingBuffer& operator=(const SPSCRingBuffer&) = delete;
+
+	static constexpr std::size_t capacity = N;
+
+	/* PRODUCER */
+
+	bool push(const T& item) {
+		T* slot = this->claim();
+		if (slot == nullptr) {
+			return false;
+		}
+		*slot = item;
+		this->commit();
+		return true;
+	}
+
+	// In place push: the slot of the next item, filled by the caller and published with commit().
+	// nullptr if the ring is full (counted as overflow, do not commit).
+	T* claim() {
+		const std::size_t h = head.load(std::memory_order_relaxed);
+		if (h - cached_tail == N) {
+			cached_tail = tail.load(std::memory_order_acquire);
+			if (h - cached_tail == N) {
+				overflow.store(overflow.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+		}
+		return &items[h & (N - 1)];
+	}
+
+	void commit() {
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/* CONSUMER */
+
+	bool pop(T& item) {
+		const std::size_t t = tail.load(std::memory_order_relaxed);
+		if (t == cached_head) {
+			cached_head = head.load(std::memory_order_acquire);
+			if (t == cached_head) {
+				return false;
+			}
+		}
+		item = items[t & (N - 1)];
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// copies up to max items to out and frees them with a single store. Returns the amount of items copied.
+	std::size_t drain(T* out, std::size_t max) {
+		return drain([&out](const T& item) { *out++ = item; }, max);
+	}
+
+	// calls f(const T&) for up to max items in the ring. Returns the amount of items consumed.
+	template <typename F>
+	std::size_t drain(F f, std::size_t max = N) {
+		const std::size_t t = tail.load(std::memory_order_relaxed);
+		cached_head = head.load(std::memory_order_acquire);
+
+		std::size_t count = cached_head - t;
+		if (count > max) {
+			count = max;
+		}
+
+		for (std::size_t i = 0; i < count; ++i) {
+			f(items[(t + i) & (N - 1)]);
+		}
+
+		tail.store(t + count, std::memory_order_release);
+		return count;
+	}
+
+	/* ANY THREAD */
+
+	// approximation if called while producer/consumer are active
+	std::size_t size() const {
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+	}
+
+	bool empty() const { return size() == 0; }
+
+	// amount of items dropped because the ring was full
+	std::size_t overflows() const { return overflow.load(std::memory_order_relaxed); }
+
+private:
+	// producer cache line
+	std::atomic<std::size_t> head{ 0 };
+	std::atomic<std::size_t> overflow{ 0 };
+	std::size_t cached_tail = 0;
+	char pad_producer[CACHE_LINE_SIZE - 2 * sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)];
+
+	// consumer cache line
+	std::atomic<std::size_t> tail{ 0 };
+	std::size_t cached_head = 0;
+	char pad_consumer[CACHE_LINE_SIZE - sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)];
+
+	std::array<T, N> items;
+};
+
+template <typename T, std::size_t N>
+constexpr std::size_t SPSCRingBuffer<T, N>::capacity;
@@ -1,8 +1,157 @@
-#include <cmath>
+#include <algorithm>
 
 #include "types.h"
 #include "rumble.h"
 
+namespace {
+
+/* compile time tables - the encoded domain is only 7 bit each, see rumble_info.md */
+
+constexpr double LN2 = 0.693147180559945309417;
+
+// 2^x for 0 <= x < 1 (taylor series of e^(x*ln2))
+constexpr double exp2_fraction(double x) {
+	double term = 1.0;
+	double sum = 1.0;
+	for (int n = 1; n < 30; ++n) {
+		term *= x * LN2 / n;
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double exp2(double x) {
+	int i = static_cast<int>(x);
+	if (x < i) {
+		--i;
+	}
+
+	double res = exp2_fraction(x - i);
+	for (; i > 0; --i) {
+		res *= 2.0;
+	}
+	for (; i < 0; ++i) {
+		res /= 2.0;
+	}
+	return res;
+}
+
+template <std::size_t N>
+struct Table {
+	double value[N];
+};
+
+constexpr byte MIN_FREQ_CODE = 0x41;	// 40.87Hz
+constexpr byte MAX_FREQ_CODE = 0xDF;	// 1252.57Hz
+constexpr byte MAX_AMP_CODE = 0x64;		// 1.0 (safe)
+
+// encoded_hex_freq -> frequency
+constexpr Table<256> make_frequency_table() {
+	Table<256> t{};
+	for (std::size_t code = 0; code < 256; ++code) {
+		t.value[code] = 10.0 * exp2(code / 32.0);
+	}
+	return t;
+}
+
+// lowest frequency that rounds to encoded_hex_freq: round(log2(f / 10) * 32) >= code
+constexpr Table<256> make_frequency_bounds() {
+	Table<256> t{};
+	for (std::size_t code = 0; code < 256; ++code) {
+		t.value[code] = 10.0 * exp2((code - 0.5) / 32.0);
+	}
+	return t;
+}
+
+// log2(amplitude * 5 / 18) of amp_encoded + offset, the curve gets finer with higher amplitudes
+constexpr double amplitude_exponent(std::size_t code, double offset) {
+	if (code <= 0x0F) {
+		return (code + offset) / 4.0 - 9.0;
+	} else if (code <= 0x1F) {
+		return (code + offset) / 16.0 - 6.0;
+	} else {
+		return (code + offset) / 32.0 - 5.0;
+	}
+}
+
+// amp_encoded -> amplitude
+constexpr Table<MAX_AMP_CODE + 1> make_amplitude_table() {
+	Table<MAX_AMP_CODE + 1> t{};
+	for (std::size_t code = 1; code <= MAX_AMP_CODE; ++code) {
+		double amplitude = 18.0 / 5.0 * exp2(amplitude_exponent(code, 1.0));
+		t.value[code] = amplitude < 1.0 ? amplitude : 1.0;
+	}
+	return t;
+}
+
+// lowest amplitude that rounds to amp_encoded
+constexpr Table<MAX_AMP_CODE + 1> make_amplitude_bounds() {
+	Table<MAX_AMP_CODE + 1> t{};
+	for (std::size_t code = 1; code <= MAX_AMP_CODE; ++code) {
+		t.value[code] = 18.0 / 5.0 * exp2(amplitude_exponent(code, 0.5));
+	}
+	return t;
+}
+
+constexpr Table<256> FREQUENCY = make_frequency_table();
+constexpr Table<256> FREQUENCY_BOUNDS = make_frequency_bounds();
+constexpr Table<MAX_AMP_CODE + 1> AMPLITUDE = make_amplitude_table();
+constexpr Table<MAX_AMP_CODE + 1> AMPLITUDE_BOUNDS = make_amplitude_bounds();
+
+static_assert(FREQUENCY.value[0x80] == 160.0, "frequency table is broken");
+static_assert(AMPLITUDE.value[0x00] == 0.0 && AMPLITUDE.value[MAX_AMP_CODE] == 1.0, "amplitude table is broken");
+
+// frequency must be clamped
+byte frequency_code(double frequency) {
+	const double* bounds = FREQUENCY_BOUNDS.value;
+	return static_cast<byte>(std::upper_bound(bounds + MIN_FREQ_CODE + 1, bounds + MAX_FREQ_CODE + 1, frequency) - bounds - 1);
+}
+
+// amplitude must be clamped
+byte amplitude_code(double amplitude) {
+	const double* bounds = AMPLITUDE_BOUNDS.value;
+	return static_cast<byte>(std::upper_bound(bounds + 1, bounds + MAX_AMP_CODE + 1, amplitude) - bounds - 1);
+}
+
+void split_frequency_code(byte encoded_hex_freq, byte& hf, byte& lf) {
+	// Convert to Joy-Con HF range. Range: 0x01-0x7F
+	hf = (encoded_hex_freq > 0x60) ? (encoded_hex_freq - 0x60) : 0x00;	// what happens under 81.75Hz?
+
+	// Convert to Joy-Con LF range. Range: 0x01-0x7F.
+	lf = (encoded_hex_freq < 0xC0) ? encoded_hex_freq - 0x40 : 0x00;
+}
+
+ByteArray<4> to_bytes(byte hf, byte lf, byte hf_amp, byte lf_amp) {
+	return { {
+		static_cast<byte>(hf << 2),
+		static_cast<byte>((hf_amp << 1) | (hf >> 6)),
+		static_cast<byte>((lf_amp << 7) | lf),
+		static_cast<byte>(0x40 | (lf_amp >> 1))
+	} };
+}
+
+} // namespace
+
+ByteArray<4> Rumble::encode(double frequency, double amplitude) noexcept {
+
+	// written so that NaN ends up at the lower limit
+	frequency = (frequency >= 40.87) ? std::min(frequency, 1252.57) : 40.87;
+	amplitude = (amplitude >= 0.0) ? std::min(amplitude, 1.0) : 0.0;
+
+	byte hf;
+	byte lf;
+	split_frequency_code(frequency_code(frequency), hf, lf);
+	byte amp = amplitude_code(amplitude);
+
+	return to_bytes(hf, lf, amp, amp);
+}
+
+void Rumble::encode(const RumbleSample* in, std::size_t count, ByteArray<4>* out) noexcept {
+	for (std::size_t i = 0; i < count; ++i) {
+		out[i] = encode(in[i].frequency, in[i].amplitude);
+	}
+}
+
 void Rumble::pack() {
 
 	byte hf;
@@ -13,14 +162,11 @@ void Rumble::pack() {
 	encode_frequency(this->frequency, hf, lf);
 	encode_amplitude(this->amplitude, hf_amp, lf_amp);
 
-	this->data[0] = (hf << 2);
-	this->data[1] = (hf_amp << 1) | (hf >> 6);
-	this->data[2] = (lf_amp << 7) | lf;
-	this->data[3] = 0x40 | (lf_amp >> 1);
+	this->data = to_bytes(hf, lf, hf_amp, lf_amp);
 }
 
 void Rumble::unpack() {
-	byte hf     = (data[1] << 6) | (data[0] >> 2);
+	byte hf     = ((data[1] & 0x01) << 6) | (data[0] >> 2);
 	byte hf_amp = data[1] >> 1;
 	byte lf     = static_cast<byte>(data[2] << 1) >> 1;
 	byte lf_amp = (static_cast<byte>(data[3] << 2) >> 1) | (data[2] >> 7);
@@ -36,14 +182,8 @@ void Rumble::encode_frequency(double frequency, byte& hf, byte& lf) const {
 		throw std::invalid_argument("frequency must be between 40.87 and 1252.57.");
 	}
 
-	// maps to 0x41(65) - 0xDF(223)
-	byte encoded_hex_freq = static_cast<byte>(std::round(std::log2(frequency / 10.0)*32.0));
-
-	// Convert to Joy-Con HF range. Range: 0x01-0x7F
-	hf = (encoded_hex_freq > 0x60) ? (encoded_hex_freq - 0x60) : 0x00;	// what happens under 81.75Hz?
-
-	// Convert to Joy-Con LF range. Range: 0x01-0x7F.
-	lf = (encoded_hex_freq < 0xC0) ? encoded_hex_freq - 0x40 : 0x00;
+	// maps to 0x41(65) - 0xDF(223): round(log2(frequency / 10.0)*32.0)
+	split_frequency_code(frequency_code(frequency), hf, lf);
 }
 
 void Rumble::encode_amplitude(double amplitude, byte& hf_amp, byte& lf_amp) const {
@@ -54,21 +194,7 @@ void Rumble::encode_amplitude(double amplitude, byte& hf_amp, byte& lf_amp) cons
 	}
 
 	// maps to 0x00(0) - 0x64(100) [safe] | 0x7E(126) [unsafe]
-	byte amp_encoded;
-	if (amplitude < 0.008) {
-		amp_encoded = 0x00;
-	} else if (amplitude < 0.112491) {
-		amp_encoded = static_cast<uint8_t>(std::round((std::log2(amplitude * 5.0 / 18.0) + 9.0)*4.0)) - 1;
-	} else if (amplitude < 0.224982) {
-		amp_encoded = static_cast<uint8_t>(std::round((std::log2(amplitude * 5.0 / 18.0) + 6.0)*16.0)) - 1;
-	} else {
-		amp_encoded = static_cast<uint8_t>(std::round((std::log2(amplitude * 5.0 / 18.0) + 5.0)*32.0)) - 1;
-	}
-
-	// saveguard
-	if (amp_encoded > 0x64) {
-		throw std::bad_exception();
-	}
+	byte amp_encoded = amplitude_code(amplitude);
 
 	hf_amp = amp_encoded;
 	lf_amp = amp_encoded;
@@ -95,8 +221,7 @@ double Rumble::decode_frequency(byte hf, byte lf) const {
 	}
 
 	// maps to 40 - 1252.57223...
-	double frequency =  10.0*std::pow(2.0, static_cast<double>(encoded_hex_freq) / 32.0);
-	return std::max(40.87, std::min(1252.57, frequency));
+	return std::max(40.87, std::min(1252.57, FREQUENCY.value[encoded_hex_freq]));
 }
 
 double Rumble::decode_amplitude(byte hf_amp, byte lf_amp) const {
@@ -107,19 +232,6 @@ double Rumble::decode_amplitude(byte hf_amp, byte lf_amp) const {
 		throw std::runtime_error("amplitude must be between 0x00 and 0x64.");
 	}
 
-	uint8_t amp_encoded = hf_amp;
-	double amplitude;
-
-	// maps to 0 - 1.00295
-	if (amp_encoded == 0x00) {
-		amplitude = 0.0;
-	} else if (amp_encoded <= 0x0F) {
-		amplitude = 18.0 / 5.0*std::pow(2.0, static_cast<double>(amp_encoded + 1) / 4.0 - 9.0);
-	} else if (amp_encoded <= 0x1F) {
-		amplitude = 18.0 / 5.0*std::pow(2.0, static_cast<double>(amp_encoded + 1) / 16.0 - 6.0);
-	} else {
-		amplitude = 18.0 / 5.0*std::pow(2.0, static_cast<double>(amp_encoded + 1) / 32.0 - 5.0);
-	}
-
-	return std::min(amplitude, 1.0);
+	// maps to 0 - 1.00295, clamped to 1
+	return AMPLITUDE.value[hf_amp];
 }
@@ -1,9 +1,15 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 #include "types.h"
 
+struct RumbleSample {
+	double frequency;
+	double amplitude;
+};
+
 class Rumble
 {
 public:
@@ -24,6 +30,10 @@ public:
 	const ByteArray<4>& getByte() const { return data; }
 	const byte& byte_at(std::size_t idx) const { return data.at(idx); }
 
+	// Fast path: table lookups only, never throws. frequency is clamped to 40.87 - 1252.57, amplitude to 0 - 1.
+	static ByteArray<4> encode(double frequency, double amplitude) noexcept;
+	static void encode(const RumbleSample* in, std::size_t count, ByteArray<4>* out) noexcept;
+
 private:
 
 	void pack();	// frequency + amplitude -> data (4 byte)
@@ -0,0 +1,214 @@
+#include <algorithm>
+
+#include "log.h"
+#include "rumble.h"
+#include "rumbleengine.h"
+
+namespace {
+
+// longest pause added to the ticks while the writes fail
+const std::chrono::milliseconds MAX_BACKOFF(1000);
+
+} // namespace
+
+/* ------ RUMBLEMIXER ------ */
+
+RumbleMixer::EffectID RumbleMixer::play(const RumbleEffect& effect, Clock::time_point now) {
+	voices.push_back({ next_id, effect, now, false, now, 0.0 });
+	return next_id++;
+}
+
+void RumbleMixer::cancel(EffectID id, Clock::time_point now) {
+	for (Voice& voice : voices) {
+		if (voice.id == id && !voice.released) {
+			voice.release_level = std::max(0.0, level(voice, now));
+			voice.release_start = now;
+			voice.released = true;
+		}
+	}
+}
+
+void RumbleMixer::cancel_all() {
+	voices.clear();
+}
+
+void RumbleMixer::mix(Clock::time_point now, ByteArray<4>& left, ByteArray<4>& right) {
+
+	struct Channel {
+		bool active = false;
+		int priority = 0;
+		double amplitude = 0.0;
+		double loudest = 0.0;
+		double frequency = 0.0;
+	} channels[2];
+
+	for (auto it = voices.begin(); it != voices.end();) {
+		double amplitude = level(*it, now);
+		if (amplitude < 0.0) {
+			it = voices.erase(it);
+			continue;
+		}
+
+		for (int c = 0; c < 2; ++c) {
+			if (!(it->effect.channel & (1 << c)) || amplitude == 0.0) {
+				continue;
+			}
+
+			Channel& channel = channels[c];
+			if (channel.active && it->effect.priority < channel.priority) {
+				continue;
+			}
+			if (!channel.active || it->effect.priority > channel.priority) {
+				channel = Channel();
+				channel.active = true;
+				channel.priority = it->effect.priority;
+			}
+
+			channel.amplitude += amplitude;
+			if (amplitude > channel.loudest) {
+				channel.loudest = amplitude;
+				channel.frequency = it->effect.frequency;
+			}
+		}
+		++it;
+	}
+
+	left = channels[0].active ? Rumble::encode(channels[0].frequency, channels[0].amplitude) : Rumble().getByte();
+	right = channels[1].active ? Rumble::encode(channels[1].frequency, channels[1].amplitude) : Rumble().getByte();
+}
+
+double RumbleMixer::level(const Voice& voice, Clock::time_point now) {
+
+	using ms = std::chrono::duration<double, std::milli>;
+	const RumbleEffect& effect = voice.effect;
+
+	// linear ramp from 'from' down to 0 over effect.release, starting at 'start'
+	auto release = [&](double from, Clock::time_point start) {
+		double t = ms(now - start).count();
+		if (t >= effect.release.count()) {
+			return -1.0;
+		}
+		return from * (1.0 - t / effect.release.count());
+	};
+
+	if (voice.released) {
+		return release(voice.release_level, voice.release_start);
+	}
+
+	double t = ms(now - voice.start).count();
+	if (t < effect.attack.count()) {
+		return effect.amplitude * t / effect.attack.count();
+	}
+	if (effect.sustain.count() < 0 || t < effect.attack.count() + effect.sustain.count()) {
+		return effect.amplitude;
+	}
+	return release(effect.amplitude, voice.start + effect.attack + effect.sustain);
+}
+
+/* ------ RUMBLEENGINE ------ */
+
+RumbleEngine::RumbleEngine(Writer writer, std::chrono::milliseconds period)
+	: writer(std::move(writer)), period(period), last_left(Rumble().getByte()), last_right(Rumble().getByte()) {
+
+	if (period.count() <= 0) {
+		throw std::invalid_argument("period must be positive.");
+	}
+}
+
+RumbleEngine::~RumbleEngine() {
+	this->stop();
+}
+
+RumbleEngine::EffectID RumbleEngine::play(const RumbleEffect& effect) {
+	std::lock_guard<std::mutex> lock(mutex);
+	return mixer.play(effect, Clock::now());
+}
+
+void RumbleEngine::cancel(EffectID id) {
+	std::lock_guard<std::mutex> lock(mutex);
+	mixer.cancel(id, Clock::now());
+}
+
+void RumbleEngine::cancel_all() {
+	std::lock_guard<std::mutex> lock(mutex);
+	mixer.cancel_all();
+}
+
+void RumbleEngine::start() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (running) {
+		return;
+	}
+	running = true;
+	thread = std::thread(&RumbleEngine::run, this);
+}
+
+void RumbleEngine::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	wakeup.notify_all();
+
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+bool RumbleEngine::tick(Clock::time_point now) {
+
+	ByteArray<4> left;
+	ByteArray<4> right;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		mixer.mix(now, left, right);
+	}
+
+	if (left == last_left && right == last_right) {
+		skip_count.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// a failed write is retried with the next tick
+	writer(left, right);
+	last_left = left;
+	last_right = right;
+	write_count.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void RumbleEngine::run() {
+
+	Clock::time_point next = Clock::now();
+
+	// while the writes fail (e.g. the device is lost), only the first failure is logged and the ticks back off
+	std::size_t failures = 0;
+	std::chrono::milliseconds backoff{ 0 };
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (running) {
+		lock.unlock();
+		try {
+			this->tick();
+			if (failures > 0) {
+				LOG(LOG_INFO) << "Rumble writes work again after " << failures << " failures.";
+				failures = 0;
+				backoff = std::chrono::milliseconds(0);
+			}
+		} catch (std::exception& e) {
+			if (failures++ == 0) {
+				LOG(LOG_ERROR) << "Rumble write failed: " << e.what();
+			}
+			backoff = std::min(std::max(backoff * 2, period), MAX_BACKOFF);
+		}
+		lock.lock();
+
+		// fixed rate, but do not catch up on missed ticks
+		next += period + backoff;
+		Clock::time_point now = Clock::now();
+		if (next < now) {
+			next = now;
+		}
+		wakeup.wait_until(lock, next, [this]() { return !running; });
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+
+enum RUMBLE_CHANNEL {
+	RUMBLE_LEFT = 1 << 0,
+	RUMBLE_RIGHT = 1 << 1,
+	RUMBLE_BOTH = RUMBLE_LEFT | RUMBLE_RIGHT
+};
+
+// Amplitude envelope: linear attack up to amplitude, hold for sustain, linear release down to 0.
+// A negative sustain holds until the effect is cancelled.
+struct RumbleEffect {
+	double frequency = 160.0;
+	double amplitude = 0.5;
+	std::chrono::milliseconds attack{ 0 };
+	std::chrono::milliseconds sustain{ 100 };
+	std::chrono::milliseconds release{ 0 };
+	int priority = 0;
+	RUMBLE_CHANNEL channel = RUMBLE_BOTH;
+};
+
+// Mixes the playing effects into one frame per channel: only the highest priority sounding on a channel is heard,
+// effects of that priority add up (clamped to 1) and play at the frequency of the loudest one. Not thread safe.
+class RumbleMixer {
+public:
+	using Clock = std::chrono::steady_clock;
+	using EffectID = unsigned int;
+
+	EffectID play(const RumbleEffect& effect, Clock::time_point now);
+
+	// starts the release phase now. Unknown (e.g. finished) ids are ignored.
+	void cancel(EffectID id, Clock::time_point now);
+	void cancel_all();
+
+	// removes finished effects. Silent channels get the default (no rumble) frame.
+	void mix(Clock::time_point now, ByteArray<4>& left, ByteArray<4>& right);
+
+	std::size_t playing() const { return voices.size(); }
+
+private:
+	struct Voice {
+		EffectID id;
+		RumbleEffect effect;
+		Clock::time_point start;
+		bool released;
+		Clock::time_point release_start;
+		double release_level;
+	};
+
+	// amplitude of voice at now, negative once it is finished
+	static double level(const Voice& voice, Clock::time_point now);
+
+	std::vector<Voice> voices;
+	EffectID next_id = 1;
+};
+
+// Runs a RumbleMixer at a fixed tick. Every tick writes the mixed frames, unless they equal the last written ones.
+class RumbleEngine {
+public:
+	using Clock = RumbleMixer::Clock;
+	using EffectID = RumbleMixer::EffectID;
+	using Writer = std::function<void(const ByteArray<4>& left, const ByteArray<4>& right)>;
+
+	explicit RumbleEngine(Writer writer, std::chrono::milliseconds period = std::chrono::milliseconds(10));
+	RumbleEngine(const RumbleEngine&) = delete;
+	RumbleEngine& operator=(const RumbleEngine&) = delete;
+	~RumbleEngine();
+
+	EffectID play(const RumbleEffect& effect);
+	void cancel(EffectID id);
+	void cancel_all();
+
+	// ticking thread
+	void start();
+	void stop();
+
+	// one tick, called by the thread (or by an own clock if the engine is not started). Returns true if it wrote.
+	bool tick(Clock::time_point now = Clock::now());
+
+	std::chrono::milliseconds get_period() const { return period; }
+	std::size_t writes() const { return write_count.load(std::memory_order_relaxed); }
+	std::size_t skipped() const { return skip_count.load(std::memory_order_relaxed); }
+
+private:
+	void run();
+
+	Writer writer;
+	std::chrono::milliseconds period;
+
+	std::mutex mutex;
+	RumbleMixer mixer;
+	ByteArray<4> last_left;
+	ByteArray<4> last_right;
+
+	std::thread thread;
+	std::condition_variable wakeup;
+	bool running = false;
+
+	std::atomic<std::size_t> write_count{ 0 };
+	std::atomic<std::size_t> skip_count{ 0 };
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Latest value of T, written by one thread, read by any number of threads without lock.
+// The writer never waits for the readers. A reader that overlaps a store copies again, so it always gets a whole value.
+// The value is kept in relaxed atomic words, so the overlapping copies are no data race.
+template <typename T>
+class SeqLock {
+	static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable.");
+
+public:
+	SeqLock() = default;
+	SeqLock(const SeqLock&) = delete;
+	SeqLock& operator=(const SeqLock&) = delete;
+
+	/* WRITER */
+
+	void store(const T& value) {
+		uint64_t words[WORDS] = {};
+		std::memcpy(words, &value, sizeof(T));
+
+		const std::size_t s = sequence.load(std::memory_order_relaxed);
+		sequence.store(s + 1, std::memory_order_relaxed);	// odd: store in progress
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for (std::size_t i = 0; i < WORDS; ++i) {
+			data[i].store(words[i], std::memory_order_relaxed);
+		}
+
+		sequence.store(s + 2, std::memory_order_release);
+	}
+
+	/* READERS */
+
+	// Returns false (out unchanged) if a store was in progress.
+	bool try_load(T& out) const {
+		const std::size_t s = sequence.load(std::memory_order_acquire);
+		if (s & 1) {
+			return false;
+		}
+
+		uint64_t words[WORDS];
+		for (std::size_t i = 0; i < WORDS; ++i) {
+			words[i] = data[i].load(std::memory_order_relaxed);
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (sequence.load(std::memory_order_relaxed) != s) {
+			return false;
+		}
+
+		std::memcpy(&out, words, sizeof(T));
+		return true;
+	}
+
+	// retries until no store overlaps. A value initialized T before the first store.
+	T load() const {
+		T res;
+		while (!this->try_load(res)) {}
+		return res;
+	}
+
+	// amount of stores so far, e.g. to see if there is a new value
+	std::size_t version() const { return sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+	static constexpr std::size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	std::atomic<std::size_t> sequence{ 0 };
+	std::atomic<uint64_t> data[WORDS]{};
+};
+
+template <typename T>
+constexpr std::size_t SeqLock<T>::WORDS;
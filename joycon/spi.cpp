@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "spi.h"
+
+constexpr std::size_t SPIReader::MAX_CHUNK;
+
+std::size_t SPIReader::add(unsigned int address, std::size_t length) {
+
+	if (planned) {
+		throw std::logic_error("Can not add ranges after planning the chunks.");
+	}
+
+	if (length == 0 || static_cast<unsigned long long>(address) + length > 0x100000000ULL) {
+		throw std::invalid_argument("Range is empty or exceeds the 4 byte address space.");
+	}
+
+	requests.push_back({ address, length });
+	return requests.size() - 1;
+}
+
+const std::vector<SPIRange>& SPIReader::chunks() {
+	if (!planned) {
+		plan();
+	}
+	return chunk_list;
+}
+
+void SPIReader::plan() {
+
+	std::vector<SPIRange> sorted(requests);
+	std::sort(sorted.begin(), sorted.end(), [](const SPIRange& a, const SPIRange& b) { return a.address < b.address; });
+
+	// merge
+	for (const SPIRange& r : sorted) {
+		unsigned long long end = static_cast<unsigned long long>(r.address) + r.length;
+
+		if (!regions.empty()) {
+			Region& last = regions.back();
+			unsigned long long last_end = static_cast<unsigned long long>(last.address) + last.data.size();
+
+			if (r.address <= last_end + max_gap) {
+				if (end > last_end) {
+					last.data.resize(static_cast<std::size_t>(end - last.address));
+				}
+				continue;
+			}
+		}
+
+		regions.push_back({ r.address, ByteVector(r.length) });
+	}
+
+	// split
+	for (std::size_t i = 0; i < regions.size(); ++i) {
+		const Region& region = regions[i];
+		for (std::size_t offset = 0; offset < region.data.size(); offset += MAX_CHUNK) {
+			chunk_list.push_back({ region.address + static_cast<unsigned int>(offset), std::min(MAX_CHUNK, region.data.size() - offset) });
+			chunk_region.push_back(i);
+		}
+	}
+
+	chunk_done.assign(chunk_list.size(), false);
+	planned = true;
+}
+
+void SPIReader::set_chunk_data(std::size_t chunk_idx, ByteView data) {
+
+	const SPIRange& chunk = chunks().at(chunk_idx);
+	if (data.size() != chunk.length) {
+		throw std::length_error("Chunk data has the wrong length.");
+	}
+
+	Region& region = regions[chunk_region[chunk_idx]];
+	std::copy(data.begin(), data.end(), region.data.begin() + (chunk.address - region.address));
+	chunk_done[chunk_idx] = true;
+}
+
+bool SPIReader::complete() const {
+	return planned && std::all_of(chunk_done.begin(), chunk_done.end(), [](bool done) { return done; });
+}
+
+ByteVector SPIReader::result(std::size_t idx) const {
+
+	if (!complete()) {
+		throw std::logic_error("Not all chunks have been read.");
+	}
+
+	const SPIRange& r = requests.at(idx);
+
+	// the region containing r
+	auto it = std::upper_bound(regions.begin(), regions.end(), r.address,
+		[](unsigned int address, const Region& region) { return address < region.address; });
+	const Region& region = *(it - 1);
+
+	auto begin = region.data.begin() + (r.address - region.address);
+	return ByteVector(begin, begin + r.length);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include "types.h"
+
+struct SPIRange {
+	unsigned int address;
+	std::size_t length;
+};
+
+// Plans SPI flash reads: adjacent, overlapping and nearby ranges (gap <= max_gap) are merged into one
+// region, regions are split into chunks of at most MAX_CHUNK bytes (one 0x10 subcommand each).
+// The chunk replies are written back with set_chunk_data(), result() cuts out the requested ranges.
+class SPIReader {
+public:
+	static constexpr std::size_t MAX_CHUNK = 0x1D;
+
+	explicit SPIReader(std::size_t max_gap = MAX_CHUNK) : max_gap(max_gap) {}
+
+	// returns the index for result()
+	std::size_t add(unsigned int address, std::size_t length);
+
+	const std::vector<SPIRange>& chunks();
+
+	void set_chunk_data(std::size_t chunk_idx, ByteView data);
+
+	// true if all chunks got their data
+	bool complete() const;
+
+	ByteVector result(std::size_t idx) const;
+
+private:
+	struct Region {
+		unsigned int address;
+		ByteVector data;
+	};
+
+	void plan();
+
+	std::size_t max_gap;
+	bool planned = false;
+
+	std::vector<SPIRange> requests;
+	std::vector<Region> regions;
+	std::vector<SPIRange> chunk_list;
+	std::vector<std::size_t> chunk_region;
+	std::vector<bool> chunk_done;
+};
@@ -0,0 +1,199 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "buffer.h"
+#include "joycon.h"
+#include "log.h"
+#include "rumble.h"
+
+//count every heap allocation of this process
+static std::atomic<std::size_t> allocations{ 0 };
+
+//while armed, also count the allocations of all threads but the one that armed it (e.g. the reader of a Joycon)
+static std::atomic<bool> others_armed{ false };
+static std::thread::id armed_by;
+static std::atomic<std::size_t> other_allocations{ 0 };
+
+void* operator new(std::size_t size) {
+	++allocations;
+	if (others_armed.load(std::memory_order_acquire) && std::this_thread::get_id() != armed_by) {
+		++other_allocations;
+	}
+	if (void* ptr = std::malloc(size ? size : 1)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+namespace {
+
+//InputBuffer/OutputBuffer live on the stack, so the per report path of the
+//reader thread (read into buffer, inspect, hand it on) must not touch the heap
+
+//read a standard report into an InputBuffer and inspect all fields
+TEST(BufferAllocation, TestInputBufferHotPath) {
+	std::size_t before = allocations;
+
+	for (unsigned int report = 0; report < 1000; ++report) {
+		InputBuffer buf_in;
+		for (unsigned char i = 0; i < 50; ++i)
+			buf_in.data()[i] = i; //simulate hid_read
+		buf_in.data()[0] = 0x30;
+
+		volatile byte sink = buf_in.get_ID();
+		sink = buf_in.get_timer();
+		sink = static_cast<byte>(buf_in.get_battery_level());
+
+		ByteView axis = buf_in.get_AxisData();
+		sink = axis[0];
+
+		//move it around, e.g. returned by value from send_command
+		InputBuffer moved(std::move(buf_in));
+		InputBuffer assigned;
+		assigned = std::move(moved);
+		assigned.clean();
+		(void)sink;
+	}
+
+	EXPECT_EQ(allocations - before, 0u);
+}
+
+//0x21 replies are parsed with views on the reply data
+TEST(BufferAllocation, TestInputBufferReplyData) {
+	InputBuffer buf_in;
+	for (unsigned char i = 0; i < 50; ++i)
+		buf_in.data()[i] = i;
+	buf_in.data()[0] = 0x21;
+
+	std::size_t before = allocations;
+
+	ByteView reply = buf_in.get_reply_data(0, 12);
+	unsigned long int value = to_int(reply, 0, 4, false);
+	volatile byte sink = buf_in.get_ACK();
+	sink = buf_in.get_subcommandID_reply();
+	sink = buf_in.get_reply_data_at(4);
+	(void)sink;
+
+	EXPECT_EQ(allocations - before, 0u);
+	EXPECT_EQ(value, 0x1211100Fu);
+}
+
+//NFC/IR reports use the larger inline storage
+TEST(BufferAllocation, TestInputBufferNFC) {
+	std::size_t before = allocations;
+
+	InputBuffer buf_in(true);
+	buf_in.data()[0] = 0x31;
+	ByteView nfc = buf_in.get_NFC_IR_input_report();
+	InputBuffer copy(buf_in);
+
+	EXPECT_EQ(allocations - before, 0u);
+	EXPECT_EQ(nfc.size(), 313u);
+	EXPECT_EQ(copy.size(), 362u);
+}
+
+//building an output report, as send_command does for every command/rumble
+TEST(BufferAllocation, TestOutputBufferHotPath) {
+	Rumble rumble(160.0, 0.5);
+
+	std::size_t before = allocations;
+
+	for (unsigned int report = 0; report < 1000; ++report) {
+		OutputBuffer buf_out(4);
+		buf_out.set_cmd(0x01);
+		buf_out.set_GP(report & 0x0F);
+		buf_out.set_subcmd(0x41);
+		buf_out.set_data({ 0x03, 0x00, 0x01, 0x01 });
+		buf_out.set_rumble_left(rumble);
+		buf_out.set_rumble_right(rumble);
+
+		OutputBuffer moved(std::move(buf_out));
+		volatile std::size_t sink = moved.size();
+		(void)sink;
+	}
+
+	EXPECT_EQ(allocations - before, 0u);
+}
+
+//a 0x30 report at rest (1g on z), as the scripted device delivers it to the reader
+ByteVector standard_report(byte timer) {
+	ByteVector report(49, 0x00);
+	report[0] = 0x30;
+	report[1] = timer;
+	report[2] = 0x8E;
+	for (std::size_t sample = 0; sample < 3; ++sample) {
+		report[report_offset::IMU + report_offset::IMU_SAMPLE_SIZE * sample + 5] = 0x10;
+	}
+	return report;
+}
+
+//pushes count reports into device and pops them from jc, returns the amount popped
+std::size_t feed(ScriptedDevice& device, Joycon& jc, byte& timer, std::size_t count) {
+	std::size_t popped = 0;
+	StandardReport report;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (popped < count && std::chrono::steady_clock::now() < deadline) {
+		//stay below the capacity of the report ring
+		const std::size_t batch = std::min<std::size_t>(32, count - popped);
+		for (std::size_t i = 0; i < batch; ++i) {
+			device.push_input(standard_report(timer++));
+		}
+		for (std::size_t got = 0; got < batch && std::chrono::steady_clock::now() < deadline;) {
+			if (jc.pop_report(report)) {
+				++got;
+				++popped;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	}
+	return popped;
+}
+
+//the whole reader path of a report: read, decode, button events, device clock, link monitor, IMU fusion,
+//latest state and report ring. The scripted device allocates in push_input(), which runs in this thread.
+TEST(BufferAllocation, TestReaderHotPath) {
+	auto device = ScriptedTransport::add_device({ JOYCON_L_BT, L"98:B6:E9:00:00:01", "scripted/0" });
+	{
+		Joycon jc(JOYCON_L_BT, const_cast<wchar_t*>(L"98:B6:E9:00:00:01"), "scripted/0");
+		jc.capture();
+
+		//until the device clock is synchronized
+		byte timer = 0;
+		ASSERT_EQ(feed(*device, jc, timer, 64), 64u);
+
+		//the writer thread of the log is done with the lines of the initialization
+		Logger::flush();
+		armed_by = std::this_thread::get_id();
+		others_armed.store(true, std::memory_order_release);
+		const std::size_t popped = feed(*device, jc, timer, 1000);
+		others_armed.store(false, std::memory_order_release);
+
+		EXPECT_EQ(popped, 1000u);
+		EXPECT_EQ(other_allocations.load(), 0u);
+		EXPECT_EQ(jc.metrics().lost_reports, 0u);
+	}
+	ScriptedTransport::remove_devices();
+}
+
+} //namespace
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,249 @@
+#include <chrono>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "buffer.h"
+#include "command.h"
+
+namespace {
+
+using namespace std::chrono;
+
+//records every written subcommand instead of sending it to a device
+struct FakeDevice {
+	CommandQueue::Writer writer() {
+		return [this](OutputBuffer& out) {
+			out.set_GP(gp++ & 0x0F);
+			written.push_back(out.data()[10]);
+		};
+	}
+
+	std::vector<byte> written;
+	unsigned int gp = 0;
+};
+
+OutputBuffer command(byte subcmd) {
+	OutputBuffer out(1);
+	out.set_cmd(0x01);
+	out.set_subcmd(subcmd);
+	return out;
+}
+
+InputBuffer reply(byte subcmd, byte payload = 0x00) {
+	InputBuffer in;
+	in.data()[0] = 0x21; //DONT CHANGE INPUT BUFFER IN PRODUCTION LIKE THIS!
+	in.data()[13] = 0x80;
+	in.data()[14] = subcmd;
+	in.data()[15] = payload;
+	return in;
+}
+
+//submit writes right away, the matching 0x21 reply fulfills the future
+TEST(CommandQueue, TestReply) {
+	FakeDevice device;
+	CommandQueue queue(device.writer());
+
+	std::future<InputBuffer> res = queue.submit(command(0x02), milliseconds(100), 0);
+	EXPECT_EQ(device.written, std::vector<byte>({ 0x02 }));
+	EXPECT_EQ(queue.in_flight(), 1u);
+	EXPECT_NE(res.wait_for(seconds(0)), std::future_status::ready);
+
+	//streamed reports and replies to other subcommands are not for us
+	InputBuffer standard;
+	standard.data()[0] = 0x30;
+	EXPECT_FALSE(queue.on_report(standard));
+	EXPECT_FALSE(queue.on_report(reply(0x03)));
+
+	EXPECT_TRUE(queue.on_report(reply(0x02, 0x42)));
+	ASSERT_EQ(res.wait_for(seconds(0)), std::future_status::ready);
+	EXPECT_EQ(res.get().get_reply_data_at(0), 0x42);
+	EXPECT_EQ(queue.in_flight(), 0u);
+}
+
+//several commands in flight, replies can come in any order
+TEST(CommandQueue, TestManyInFlight) {
+	FakeDevice device;
+	CommandQueue queue(device.writer());
+
+	std::future<InputBuffer> first = queue.submit(command(0x10), milliseconds(100), 0);
+	std::future<InputBuffer> second = queue.submit(command(0x10), milliseconds(100), 0);
+	std::future<InputBuffer> other = queue.submit(command(0x40), milliseconds(100), 0);
+	EXPECT_EQ(queue.in_flight(), 3u);
+
+	EXPECT_TRUE(queue.on_report(reply(0x40, 3)));
+	EXPECT_TRUE(queue.on_report(reply(0x10, 1))); //same subcommand -> oldest first
+	EXPECT_TRUE(queue.on_report(reply(0x10, 2)));
+
+	EXPECT_EQ(first.get().get_reply_data_at(0), 1);
+	EXPECT_EQ(second.get().get_reply_data_at(0), 2);
+	EXPECT_EQ(other.get().get_reply_data_at(0), 3);
+}
+
+//commands with the same subcommand are told apart by the echoed command data (e.g. SPI address)
+TEST(CommandQueue, TestEcho) {
+	FakeDevice device;
+	CommandQueue queue(device.writer());
+
+	OutputBuffer first(2);
+	first.set_subcmd(0x10);
+	first.set_data({ 0x20, 0x60 });
+	OutputBuffer second(2);
+	second.set_subcmd(0x10);
+	second.set_data({ 0x3D, 0x60 });
+
+	std::future<InputBuffer> res_first = queue.submit(std::move(first), milliseconds(100), 0, 2);
+	std::future<InputBuffer> res_second = queue.submit(std::move(second), milliseconds(100), 0, 2);
+
+	//reply to the second read comes first
+	InputBuffer in = reply(0x10, 0x3D);
+	in.data()[16] = 0x60; //DONT CHANGE INPUT BUFFER IN PRODUCTION LIKE THIS!
+	EXPECT_TRUE(queue.on_report(in));
+	EXPECT_EQ(res_second.wait_for(seconds(0)), std::future_status::ready);
+	EXPECT_NE(res_first.wait_for(seconds(0)), std::future_status::ready);
+
+	in.data()[15] = 0x55; //nobody asked for 0x6055
+	EXPECT_FALSE(queue.on_report(in));
+
+	OutputBuffer too_short(1);
+	EXPECT_THROW({queue.submit(std::move(too_short), milliseconds(100), 0, 2);}, std::invalid_argument);
+}
+
+//no free slot left
+TEST(CommandQueue, TestFull) {
+	FakeDevice device;
+	CommandQueue queue(device.writer());
+
+	std::vector<std::future<InputBuffer>> futures;
+	for (std::size_t i = 0; i < CommandQueue::MAX_IN_FLIGHT; ++i)
+		futures.push_back(queue.submit(command(0x40), milliseconds(100), 0));
+
+	EXPECT_THROW({queue.submit(command(0x40), milliseconds(100), 0);}, std::runtime_error);
+
+	//try_submit keeps the command until a slot is free again
+	OutputBuffer waiting = command(0x02);
+	std::future<InputBuffer> res;
+	EXPECT_FALSE(queue.try_submit(waiting, res, milliseconds(100), 0));
+	EXPECT_FALSE(queue.wait_free(milliseconds(1)));
+	EXPECT_EQ(waiting.data()[10], 0x02);
+
+	EXPECT_TRUE(queue.on_report(reply(0x40)));
+	EXPECT_TRUE(queue.wait_free(milliseconds(0)));
+	ASSERT_TRUE(queue.try_submit(waiting, res, milliseconds(100), 0));
+	EXPECT_TRUE(queue.on_report(reply(0x02)));
+	EXPECT_EQ(res.get().get_subcommandID_reply(), 0x02);
+}
+
+//the command is registered before it is written, a reply that comes back at once finds it
+TEST(CommandQueue, TestRegisterBeforeWrite) {
+	std::size_t in_flight_at_write = 0;
+	CommandQueue* queue_ptr = nullptr;
+	CommandQueue queue([&](OutputBuffer&) { in_flight_at_write = queue_ptr->in_flight(); });
+	queue_ptr = &queue;
+
+	std::future<InputBuffer> res = queue.submit(command(0x02), milliseconds(100), 0);
+	EXPECT_EQ(in_flight_at_write, 1u);
+	EXPECT_TRUE(queue.on_report(reply(0x02)));
+}
+
+//a failed write gives the slot back
+TEST(CommandQueue, TestWriteFails) {
+	bool fail = true;
+	CommandQueue queue([&fail](OutputBuffer&) {
+		if (fail) {
+			throw std::runtime_error("Device lost!");
+		}
+	});
+
+	bool active = false;
+	queue.set_activity_hook([&active](bool a) { active = a; });
+
+	for (std::size_t i = 0; i < CommandQueue::MAX_IN_FLIGHT + 1; ++i)
+		EXPECT_THROW({queue.submit(command(0x40), milliseconds(100), 0);}, std::runtime_error);
+	EXPECT_EQ(queue.in_flight(), 0u);
+	EXPECT_FALSE(active);
+	EXPECT_FALSE(queue.on_report(reply(0x40)));
+
+	fail = false;
+	std::vector<std::future<InputBuffer>> futures;
+	for (std::size_t i = 0; i < CommandQueue::MAX_IN_FLIGHT; ++i)
+		futures.push_back(queue.submit(command(0x40), milliseconds(100), 0));
+	EXPECT_TRUE(active);
+}
+
+//without reply the command is resent, after the last retry the future throws
+TEST(CommandQueue, TestTimeoutRetry) {
+	FakeDevice device;
+	CommandQueue queue(device.writer());
+
+	bool active = false;
+	queue.set_activity_hook([&active](bool a) { active = a; });
+
+	std::future<InputBuffer> res = queue.submit(command(0x02), milliseconds(10), 1);
+	EXPECT_TRUE(active);
+
+	auto now = CommandQueue::Clock::now();
+	EXPECT_EQ(queue.poll(now), 1u); //deadline not reached
+	EXPECT_EQ(device.written.size(), 1u);
+
+	EXPECT_EQ(queue.poll(now + milliseconds(20)), 1u); //retry
+	EXPECT_EQ(device.written, std::vector<byte>({ 0x02, 0x02 }));
+	EXPECT_EQ(device.gp, 2u); //resent with a new GP
+
+	EXPECT_EQ(queue.poll(now + milliseconds(40)), 0u); //out of retries
+	EXPECT_FALSE(active);
+	EXPECT_THROW({res.get();}, std::runtime_error);
+}
+
+//round trips, resends, failures and the most commands in flight go into the metrics
+TEST(CommandQueue, TestMetrics) {
+	FakeDevice device;
+	LinkMetrics metrics;
+	CommandQueue queue(device.writer(), &metrics);
+
+	std::future<InputBuffer> answered = queue.submit(command(0x30), milliseconds(10), 0);
+	std::future<InputBuffer> lost = queue.submit(command(0x02), milliseconds(10), 1);
+	EXPECT_TRUE(queue.on_report(reply(0x30)));
+
+	auto now = CommandQueue::Clock::now();
+	queue.poll(now + milliseconds(20)); //resend
+	queue.poll(now + milliseconds(40)); //failed
+	EXPECT_THROW({lost.get();}, std::runtime_error);
+
+	LinkSnapshot snapshot = metrics.snapshot();
+	EXPECT_EQ(snapshot.round_trip.count, 1u);
+	EXPECT_EQ(snapshot.command_resends, 1u);
+	EXPECT_EQ(snapshot.command_failures, 1u);
+	EXPECT_EQ(snapshot.commands_in_flight_max, 2u);
+}
+
+//a lost device fails everything in flight at once, the queue stays usable
+TEST(CommandQueue, TestAbort) {
+	FakeDevice device;
+	CommandQueue queue(device.writer());
+
+	bool active = false;
+	queue.set_activity_hook([&active](bool a) { active = a; });
+
+	std::future<InputBuffer> first = queue.submit(command(0x02), milliseconds(100), 2);
+	std::future<InputBuffer> second = queue.submit(command(0x10), milliseconds(100), 2);
+	queue.abort("Device lost!");
+
+	EXPECT_EQ(queue.in_flight(), 0u);
+	EXPECT_FALSE(active);
+	EXPECT_THROW({first.get();}, std::runtime_error);
+	EXPECT_THROW({second.get();}, std::runtime_error);
+	EXPECT_FALSE(queue.on_report(reply(0x02)));
+
+	std::future<InputBuffer> next = queue.submit(command(0x02), milliseconds(100), 0);
+	EXPECT_TRUE(queue.on_report(reply(0x02)));
+	EXPECT_EQ(next.get().get_subcommandID_reply(), 0x02);
+}
+
+} //namespace
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
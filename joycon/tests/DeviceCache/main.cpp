@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "cache.h"
+
+namespace {
+
+const std::string PATH = "devicecache_test.bin";
+
+DeviceRecord make_record(byte last_mac_byte, const std::string& firmware) {
+	DeviceRecord record;
+	record.mac = { 0x98, 0xB6, 0xE9, 0x01, 0x02, last_mac_byte };
+	record.info.firmwareVersion = firmware;
+	record.info.joyconType = 2;
+	record.info.mac = to_hex_string(record.mac, "", ":");
+	record.info.useColorsSPI = true;
+	record.body_color = { 0x1E, 0xDC, 0x00 };
+	record.button_color = { 0x0F, 0x0F, 0x0F };
+	record.calib.factory_sensor_cal = ByteVector(0x18, 0x11);
+	record.calib.factory_stick_cal = ByteVector(0x12, 0x22);
+	record.calib.sensor_model = ByteVector(0x06, 0x33);
+	record.calib.stick_model1 = ByteVector(0x12, 0x44);
+	record.calib.stick_model2 = ByteVector(0x12, 0x55);
+	record.calib.user_stick_cal = ByteVector(0x16, 0x66);
+	record.calib.user_sensor_cal = ByteVector(0x1A, 0x77);
+	record.checksum = 0xDEADBEEF;
+	return record;
+}
+
+class DeviceCacheTest : public ::testing::Test {
+protected:
+	void SetUp() override { std::remove(PATH.c_str()); }
+	void TearDown() override { std::remove(PATH.c_str()); }
+};
+
+} // namespace
+
+//standard CRC32 check value
+TEST(DeviceCache, TestChecksum) {
+	ByteVector data{ '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+	EXPECT_EQ(DeviceCache::checksum(data), 0xCBF43926u);
+
+	//incremental
+	ByteView view(data);
+	EXPECT_EQ(DeviceCache::checksum(view.sub(4, 5), DeviceCache::checksum(view.sub(0, 4))), 0xCBF43926u);
+}
+
+TEST(DeviceCache, TestParseMac) {
+	ByteArray<6> mac;
+	ASSERT_TRUE(parse_mac("98:b6:e9:01:02:0A", mac));
+	EXPECT_THAT(mac, ::testing::ElementsAre(0x98, 0xB6, 0xE9, 0x01, 0x02, 0x0A));
+
+	ASSERT_TRUE(parse_mac("98b6e901020b", mac));
+	EXPECT_EQ(mac[5], 0x0B);
+
+	EXPECT_FALSE(parse_mac("98b6e90102", mac));
+	EXPECT_FALSE(parse_mac("98b6e901020b0c", mac));
+	EXPECT_FALSE(parse_mac("not a mac!!!", mac));
+}
+
+TEST_F(DeviceCacheTest, TestRoundTrip) {
+	{
+		DeviceCache cache(PATH);
+		EXPECT_EQ(cache.size(), 0u);
+		cache.store(make_record(0x01, "3.86"));
+		cache.store(make_record(0x02, "3.72"));
+	}
+
+	DeviceCache cache(PATH);
+	ASSERT_EQ(cache.size(), 2u);
+
+	DeviceRecord expected = make_record(0x02, "3.72");
+	DeviceRecord record;
+	ASSERT_TRUE(cache.find(expected.mac, record));
+	EXPECT_EQ(record.info.firmwareVersion, "3.72");
+	EXPECT_EQ(record.info.joyconType, 2u);
+	EXPECT_EQ(record.info.mac, "98:b6:e9:01:02:02");
+	EXPECT_TRUE(record.info.useColorsSPI);
+	EXPECT_EQ(record.body_color.G, 0xDC);
+	EXPECT_EQ(record.button_color.B, 0x0F);
+	EXPECT_EQ(record.calib.factory_sensor_cal, expected.calib.factory_sensor_cal);
+	EXPECT_EQ(record.calib.user_sensor_cal, expected.calib.user_sensor_cal);
+	EXPECT_EQ(record.checksum, 0xDEADBEEFu);
+
+	ByteArray<6> unknown = { 0, 0, 0, 0, 0, 0 };
+	EXPECT_FALSE(cache.find(unknown, record));
+}
+
+//a new firmware replaces the record of the controller
+TEST_F(DeviceCacheTest, TestReplace) {
+	DeviceCache cache(PATH);
+	cache.store(make_record(0x01, "3.72"));
+	cache.store(make_record(0x01, "3.86"));
+	ASSERT_EQ(cache.size(), 1u);
+
+	DeviceRecord record;
+	ASSERT_TRUE(DeviceCache(PATH).find(make_record(0x01, "").mac, record));
+	EXPECT_EQ(record.info.firmwareVersion, "3.86");
+}
+
+//records that do not fit the fixed layout are not written
+TEST_F(DeviceCacheTest, TestInvalidRecord) {
+	DeviceRecord record = make_record(0x01, "3.86");
+	record.calib.sensor_model.pop_back();
+
+	DeviceCache(PATH).store(record);
+	EXPECT_EQ(DeviceCache(PATH).size(), 0u);
+}
+
+TEST_F(DeviceCacheTest, TestCorruptFile) {
+	DeviceCache(PATH).store(make_record(0x01, "3.86"));
+
+	//truncated
+	std::string content;
+	{
+		std::ifstream in(PATH, std::ios::binary);
+		content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+	{
+		std::ofstream out(PATH, std::ios::binary | std::ios::trunc);
+		out.write(content.data(), content.size() - 1);
+	}
+	EXPECT_EQ(DeviceCache(PATH).size(), 0u);
+
+	//garbage
+	{
+		std::ofstream out(PATH, std::ios::binary | std::ios::trunc);
+		out << "garbage";
+	}
+	EXPECT_EQ(DeviceCache(PATH).size(), 0u);
+}
+
+TEST(DeviceCache, TestMemoryOnly) {
+	DeviceCache cache("");
+	cache.store(make_record(0x01, "3.86"));
+	EXPECT_EQ(cache.size(), 1u);
+}
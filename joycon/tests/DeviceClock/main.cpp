@@ -0,0 +1,94 @@
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "deviceclock.h"
+
+namespace {
+
+//a device with a 5ms tick (50ppm fast against the host), a report every 3 ticks,
+//arriving after 4ms plus 0 - 3ms of jitter
+struct Device {
+	static constexpr double TICK_NS = 5000000.0 * (1.0 - 50e-6);
+	static constexpr uint64_t DELAY_NS = 4000000;
+
+	// the host time the report of tick was sent at
+	uint64_t sent(uint64_t tick) const { return START_NS + static_cast<uint64_t>(tick * TICK_NS); }
+
+	// next report, returns its timestamp
+	uint64_t report(DeviceClock& clock) {
+		random = random * 6364136223846793005ull + 1442695040888963407ull;
+		const uint64_t jitter = (random >> 33) % 3000000;
+		const uint64_t res = clock.on_report(static_cast<byte>(tick), sent(tick) + DELAY_NS + jitter);
+		last = tick;
+		tick += 3;
+		return res;
+	}
+
+	static constexpr uint64_t START_NS = 1000000000000ull;
+	uint64_t tick = 200;
+	uint64_t last = 0;
+	uint64_t random = 1;
+};
+
+constexpr double Device::TICK_NS;
+constexpr uint64_t Device::DELAY_NS;
+constexpr uint64_t Device::START_NS;
+
+} // namespace
+
+//until enough reports arrived the timestamp is the arrival
+TEST(DeviceClock, TestUnsynchronized) {
+	DeviceClock clock;
+	EXPECT_FALSE(clock.synchronized());
+	EXPECT_EQ(clock.tick_ns(), 0.0);
+	EXPECT_EQ(clock.on_report(10, 5000), 5000u);
+	EXPECT_EQ(clock.on_report(13, 15000), 15000u);
+	EXPECT_EQ(clock.ticks(), 3u);
+}
+
+//the timestamps follow the send time much closer than the arrivals, over many wraps of the timer
+TEST(DeviceClock, TestDejitter) {
+	DeviceClock clock;
+	Device device;
+
+	for (int i = 0; i < 2000; ++i) {
+		device.report(clock);
+	}
+	ASSERT_TRUE(clock.synchronized());
+	EXPECT_NEAR(clock.tick_ns(), Device::TICK_NS, Device::TICK_NS * 1e-4);
+
+	uint64_t previous = 0;
+	for (int i = 0; i < 1000; ++i) {
+		const uint64_t timestamp = device.report(clock);
+		const double error = static_cast<double>(timestamp) - static_cast<double>(device.sent(device.last) + Device::DELAY_NS);
+		EXPECT_LT(std::abs(error), 300000.0) << i;	// < 0.3ms, the arrivals spread over 3ms
+		EXPECT_GE(timestamp, previous);
+		previous = timestamp;
+	}
+	EXPECT_EQ(clock.ticks(), device.last - 200);
+}
+
+//a pause of several wraps is unwrapped with the host time
+TEST(DeviceClock, TestPause) {
+	DeviceClock clock;
+	Device device;
+	for (int i = 0; i < 500; ++i) {
+		device.report(clock);
+	}
+
+	device.tick += 1000;	// 5s without reports
+	const uint64_t timestamp = device.report(clock);
+	EXPECT_EQ(clock.ticks(), device.last - 200);
+	EXPECT_NEAR(static_cast<double>(timestamp), static_cast<double>(device.sent(device.last) + Device::DELAY_NS), 1000000.0);
+}
+
+//without tick estimate a long pause starts the model again
+TEST(DeviceClock, TestPauseUnsynchronized) {
+	DeviceClock clock;
+	clock.on_report(10, 5000);
+	clock.on_report(13, 15000);
+	EXPECT_EQ(clock.on_report(20, 15000 + DeviceClock::MAX_UNKNOWN_GAP + 1), 15000 + DeviceClock::MAX_UNKNOWN_GAP + 1);
+	EXPECT_EQ(clock.ticks(), 0u);
+}
@@ -0,0 +1,112 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "hapticclip.h"
+#include "rumble.h"
+
+using namespace std::chrono;
+
+namespace {
+
+const std::string PATH = "hapticclip_test.jchc";
+
+void write_file(const ByteVector& data) {
+	std::ofstream out(PATH, std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+ByteVector compile(const std::string& text) {
+	std::istringstream in(text);
+	return compile_haptic_clip(in);
+}
+
+class HapticClipTest : public ::testing::Test {
+protected:
+	void TearDown() override { std::remove(PATH.c_str()); }
+};
+
+} // namespace
+
+TEST_F(HapticClipTest, TestCompileAndMap) {
+	write_file(compile(
+		"# time freq amp [freq amp]\n"
+		"0    160 0.5\n"
+		"\n"
+		"20   320 1.0   80 0.2  # left/right\n"
+		"40   160 0\n"));
+
+	HapticClip clip(PATH);
+	ASSERT_EQ(clip.size(), 3u);
+	EXPECT_EQ(clip.duration(), milliseconds(40));
+
+	EXPECT_EQ(clip.time(0), milliseconds(0));
+	EXPECT_EQ(clip.left(0), Rumble(160.0, 0.5).getByte());
+	EXPECT_EQ(clip.right(0), Rumble(160.0, 0.5).getByte());
+
+	EXPECT_EQ(clip.time(1), milliseconds(20));
+	EXPECT_EQ(clip.left(1), Rumble(320.0, 1.0).getByte());
+	EXPECT_EQ(clip.right(1), Rumble(80.0, 0.2).getByte());
+
+	EXPECT_THROW(clip.time(3), std::out_of_range);
+}
+
+TEST(HapticClip, TestCompileErrors) {
+	EXPECT_THROW(compile("0 160\n"), std::runtime_error);				//amplitude missing
+	EXPECT_THROW(compile("0 160 0.5 80\n"), std::runtime_error);		//right amplitude missing
+	EXPECT_THROW(compile("0 160 0.5 x\n"), std::runtime_error);
+	EXPECT_THROW(compile("10 160 0.5\n5 160 0.5\n"), std::runtime_error);	//not sorted
+	EXPECT_THROW(compile("-1 160 0.5\n"), std::runtime_error);
+	EXPECT_THROW(compile("0 5000 0.5\n"), std::runtime_error);		//frequency out of range
+
+	try {
+		compile("0 160 0.5\nfoo\n");
+		FAIL();
+	} catch (std::runtime_error& e) {
+		EXPECT_THAT(e.what(), ::testing::HasSubstr("line 2"));
+	}
+
+	EXPECT_EQ(compile("# nothing\n").size(), HapticClip::HEADER_SIZE);
+}
+
+TEST_F(HapticClipTest, TestInvalidFile) {
+	EXPECT_THROW(HapticClip("does_not_exist.jchc"), std::runtime_error);
+
+	write_file(ByteVector{ 'n', 'o', 'p', 'e' });
+	EXPECT_THROW(HapticClip clip(PATH), std::runtime_error);
+
+	ByteVector data = compile("0 160 0.5\n10 160 0\n");
+	data.pop_back();
+	write_file(data);
+	EXPECT_THROW(HapticClip clip(PATH), std::runtime_error);
+}
+
+//the player writes the latest due frame once and skips overdue ones
+TEST_F(HapticClipTest, TestPlayer) {
+	write_file(compile("0 160 0.5\n10 320 0.5\n20 640 0.5\n30 160 0\n"));
+	HapticClip clip(PATH);
+
+	std::vector<ByteArray<4>> written;
+	HapticPlayer player(clip, [&written](const ByteArray<4>& left, const ByteArray<4>&) { written.push_back(left); });
+
+	HapticPlayer::Clock::time_point t0;
+	player.start(t0);
+	EXPECT_EQ(player.next_due(), t0);
+
+	EXPECT_TRUE(player.tick(t0 + milliseconds(5)));
+	EXPECT_TRUE(player.tick(t0 + milliseconds(6)));		//nothing new
+	EXPECT_EQ(player.next_due(), t0 + milliseconds(10));
+
+	EXPECT_TRUE(player.tick(t0 + milliseconds(25)));		//10 is overdue, 20 is played
+	EXPECT_FALSE(player.tick(t0 + milliseconds(30)));
+
+	ASSERT_EQ(written.size(), 3u);
+	EXPECT_EQ(written[0], clip.left(0));
+	EXPECT_EQ(written[1], clip.left(2));
+	EXPECT_EQ(written[2], clip.left(3));
+}
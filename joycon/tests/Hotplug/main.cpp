@@ -0,0 +1,154 @@
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "hotplug.h"
+
+namespace {
+
+const std::string DEVPATH = "/devices/virtual/misc/uhid/0005:057E:2007.0004/hidraw/hidraw3";
+
+// header and properties, each terminated by \0
+std::vector<char> kernel_message(const std::string& action, const std::string& devpath, const std::string& subsystem) {
+	std::string res = action + "@" + devpath;
+	res.push_back('\0');
+	for (const std::string& property : { "ACTION=" + action, "DEVPATH=" + devpath, "SUBSYSTEM=" + subsystem, std::string("DEVNAME=hidraw3"), std::string("SEQNUM=1234") }) {
+		res += property;
+		res.push_back('\0');
+	}
+	return std::vector<char>(res.begin(), res.end());
+}
+
+// as libudev sends it: header, then the properties at properties_off
+std::vector<char> udev_message(const std::string& action, const std::string& devpath) {
+	std::string properties;
+	for (const std::string& property : { "ACTION=" + action, "DEVPATH=" + devpath, std::string("SUBSYSTEM=hidraw"), std::string("DEVNAME=/dev/hidraw3") }) {
+		properties += property;
+		properties.push_back('\0');
+	}
+
+	std::vector<char> res(40 + properties.size(), 0);
+	std::memcpy(res.data(), "libudev", 8);
+	const unsigned char magic[4] = { 0xfe, 0xed, 0xca, 0xfe };
+	std::memcpy(res.data() + 8, magic, 4);
+	const uint32_t fields[3] = { 40, 40, static_cast<uint32_t>(properties.size()) };	// header size, properties offset, length
+	std::memcpy(res.data() + 12, fields, sizeof(fields));
+	std::memcpy(res.data() + 40, properties.data(), properties.size());
+	return res;
+}
+
+} // namespace
+
+//the kernel names the node relative to /dev, the ids come from the HID device in DEVPATH
+TEST(Hotplug, TestKernelMessage) {
+	std::vector<char> message = kernel_message("add", DEVPATH, "hidraw");
+	HotplugEvent event;
+	ASSERT_TRUE(parse_uevent(message.data(), message.size(), event));
+	EXPECT_EQ(event.action, HOTPLUG_ADD);
+	EXPECT_EQ(event.path, "/dev/hidraw3");
+	EXPECT_EQ(event.devpath, DEVPATH);
+	EXPECT_EQ(event.vendor_id, 0x057E);
+	EXPECT_EQ(event.product_id, 0x2007);
+	EXPECT_TRUE(event.serial_number.empty());
+
+	message = kernel_message("remove", DEVPATH, "hidraw");
+	ASSERT_TRUE(parse_uevent(message.data(), message.size(), event));
+	EXPECT_EQ(event.action, HOTPLUG_REMOVE);
+	EXPECT_EQ(event.path, "/dev/hidraw3");
+}
+
+TEST(Hotplug, TestUdevMessage) {
+	std::vector<char> message = udev_message("add", DEVPATH);
+	HotplugEvent event;
+	ASSERT_TRUE(parse_uevent(message.data(), message.size(), event));
+	EXPECT_EQ(event.action, HOTPLUG_ADD);
+	EXPECT_EQ(event.path, "/dev/hidraw3");
+	EXPECT_EQ(event.product_id, 0x2007);
+
+	//properties outside the message
+	reinterpret_cast<uint32_t*>(message.data() + 20)[0] += 1;
+	EXPECT_FALSE(parse_uevent(message.data(), message.size(), event));
+
+	message = udev_message("add", DEVPATH);
+	message[8] = 0x00; //magic
+	EXPECT_FALSE(parse_uevent(message.data(), message.size(), event));
+}
+
+//other subsystems and actions are no hotplug of a hidraw node
+TEST(Hotplug, TestIgnored) {
+	HotplugEvent event;
+	std::vector<char> message = kernel_message("add", "/devices/virtual/input/input7", "input");
+	EXPECT_FALSE(parse_uevent(message.data(), message.size(), event));
+
+	message = kernel_message("change", DEVPATH, "hidraw");
+	EXPECT_FALSE(parse_uevent(message.data(), message.size(), event));
+
+	const char garbage[] = "no header at all";
+	EXPECT_FALSE(parse_uevent(garbage, sizeof(garbage) - 1, event));
+
+	//a truncated message keeps the complete properties only
+	message = kernel_message("add", DEVPATH, "hidraw");
+	EXPECT_FALSE(parse_uevent(message.data(), 20, event));
+}
+
+//without HID id the node is still reported, with unknown ids
+TEST(Hotplug, TestUnknownIds) {
+	std::vector<char> message = kernel_message("add", "/devices/virtual/hidraw/hidraw3", "hidraw");
+	HotplugEvent event;
+	ASSERT_TRUE(parse_uevent(message.data(), message.size(), event));
+	EXPECT_EQ(event.vendor_id, 0);
+	EXPECT_EQ(event.product_id, 0);
+}
+
+TEST(Hotplug, TestQueue) {
+	HotplugQueue queue;
+	HotplugSource source = queue.source();
+
+	HotplugEvent event;
+	EXPECT_FALSE(source(event, std::chrono::milliseconds(1)));
+
+	HotplugEvent first;
+	first.path = "first";
+	HotplugEvent second;
+	second.action = HOTPLUG_REMOVE;
+	second.path = "second";
+	queue.push(first);
+	queue.push(second);
+	EXPECT_EQ(queue.pending(), 2u);
+
+	ASSERT_TRUE(source(event, std::chrono::milliseconds(0)));
+	EXPECT_EQ(event.path, "first");
+	ASSERT_TRUE(source(event, std::chrono::milliseconds(0)));
+	EXPECT_EQ(event.action, HOTPLUG_REMOVE);
+
+	//wakes a waiting source
+	std::thread producer([&queue, first]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		queue.push(first);
+	});
+	EXPECT_TRUE(source(event, std::chrono::seconds(5)));
+	producer.join();
+}
+
+#ifdef __linux__
+//needs netlink, which some sandboxes do not allow
+TEST(Hotplug, TestMonitor) {
+	try {
+		UeventMonitor monitor(UEVENT_KERNEL);
+		EXPECT_NE(monitor.fd(), -1);
+
+		HotplugEvent event;
+		auto start = std::chrono::steady_clock::now();
+		while (monitor.next(event, std::chrono::milliseconds(10))) {} //whatever happens on this machine
+		EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+	} catch (const std::runtime_error& e) {
+		GTEST_SKIP() << e.what();
+	}
+}
+#endif
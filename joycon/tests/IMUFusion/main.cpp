@@ -0,0 +1,140 @@
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "imufusion.h"
+
+namespace {
+
+const float PI = 3.14159265358979f;
+
+//0x30 report with three equal samples in raw units of the nominal calibration
+StandardReport make_report(float ax, float ay, float az, float gx_dps, float gy_dps, float gz_dps) {
+	StandardReport report{};
+	report.ID = 0x30;
+	report.IMU_samples = 3;
+	for (auto& sample : report.IMU) {
+		sample.accel[0] = static_cast<int16_t>(ax * 4096.0f);
+		sample.accel[1] = static_cast<int16_t>(ay * 4096.0f);
+		sample.accel[2] = static_cast<int16_t>(az * 4096.0f);
+		sample.gyro[0] = static_cast<int16_t>(std::round(gx_dps * 13371.0f / 936.0f));
+		sample.gyro[1] = static_cast<int16_t>(std::round(gy_dps * 13371.0f / 936.0f));
+		sample.gyro[2] = static_cast<int16_t>(std::round(gz_dps * 13371.0f / 936.0f));
+	}
+	return report;
+}
+
+//v rotated by q
+std::vector<float> rotate(const Quaternion& q, float x, float y, float z) {
+	//t = 2 * cross(q.xyz, v), v' = v + w * t + cross(q.xyz, t)
+	float tx = 2.0f * (q.y * z - q.z * y);
+	float ty = 2.0f * (q.z * x - q.x * z);
+	float tz = 2.0f * (q.x * y - q.y * x);
+	return { x + q.w * tx + (q.y * tz - q.z * ty), y + q.w * ty + (q.z * tx - q.x * tz), z + q.w * tz + (q.x * ty - q.y * tx) };
+}
+
+void put_int16(ByteVector& data, int16_t value) {
+	data.push_back(static_cast<byte>(value & 0xFF));
+	data.push_back(static_cast<byte>((value >> 8) & 0xFF));
+}
+
+ByteVector sensor_cal(int16_t acc_origin, int16_t acc_sens, int16_t gyro_origin, int16_t gyro_sens) {
+	ByteVector data;
+	for (int16_t value : { acc_origin, acc_sens, gyro_origin, gyro_sens })
+		for (int i = 0; i < 3; ++i)
+			put_int16(data, value);
+	return data;
+}
+
+} // namespace
+
+TEST(IMUCalibration, TestFactoryAndUser) {
+	SensorCalibration calib;
+	calib.factory_sensor_cal = sensor_cal(0, 16384, 10, 13381);
+	calib.user_sensor_cal = ByteVector(0x1A, 0xFF);	//erased: no user calibration
+
+	IMUCalibration factory(calib);
+	EXPECT_FLOAT_EQ(factory.accel_scale[0], 4.0f / 16384.0f);
+	EXPECT_FLOAT_EQ(factory.gyro_offset[1], 10.0f);
+	EXPECT_FLOAT_EQ(factory.gyro_scale[2], 936.0f / 13371.0f * PI / 180.0f);
+
+	calib.user_sensor_cal = { 0xB2, 0xA1 };
+	ByteVector user = sensor_cal(-100, 16284, -5, 13366);
+	calib.user_sensor_cal.insert(calib.user_sensor_cal.end(), user.begin(), user.end());
+
+	IMUCalibration user_cal(calib);
+	EXPECT_FLOAT_EQ(user_cal.accel_scale[0], 4.0f / 16384.0f);
+	EXPECT_FLOAT_EQ(user_cal.gyro_offset[0], -5.0f);
+
+	//nothing read -> nominal
+	IMUCalibration nominal(SensorCalibration{});
+	EXPECT_FLOAT_EQ(nominal.accel_scale[2], 4.0f / 16384.0f);
+}
+
+//at rest the orientation converges to the one that rotates the measured gravity onto +z
+//(up to the fixed gradient step of beta * dt)
+TEST(FusionBank, TestGravity) {
+	FusionBank bank(1, 0.5f);
+	StandardReport report = make_report(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+
+	for (int i = 0; i < 2000; ++i)
+		bank.update(0, report);
+
+	std::vector<float> up = rotate(bank.orientation(0), 1.0f, 0.0f, 0.0f);
+	EXPECT_NEAR(up[0], 0.0f, 5e-3f);
+	EXPECT_NEAR(up[1], 0.0f, 5e-3f);
+	EXPECT_NEAR(up[2], 1.0f, 1e-3f);
+}
+
+//without correction the gyro is integrated: 90 dps around z for 0.9s
+TEST(FusionBank, TestGyroIntegration) {
+	FusionBank bank(1, 0.0f);
+	StandardReport report = make_report(0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 90.0f);
+
+	for (int i = 0; i < 60; ++i)
+		bank.update(0, report);
+
+	Quaternion q = bank.orientation(0);
+	float angle = 81.0f * PI / 180.0f;
+	EXPECT_NEAR(q.w, std::cos(angle / 2), 1e-3f);
+	EXPECT_NEAR(q.x, 0.0f, 1e-4f);
+	EXPECT_NEAR(q.y, 0.0f, 1e-4f);
+	EXPECT_NEAR(q.z, std::sin(angle / 2), 1e-3f);
+
+	bank.reset(0);
+	EXPECT_FLOAT_EQ(bank.orientation(0).w, 1.0f);
+}
+
+//the batched update gives the same result as updating every filter on its own; filters without report stay
+TEST(FusionBank, TestBatch) {
+	std::vector<StandardReport> reports = {
+		make_report(0.0f, 0.0f, 1.0f, 10.0f, 0.0f, 0.0f),
+		make_report(0.3f, 0.0f, 0.9f, 0.0f, -20.0f, 5.0f),
+		make_report(0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f),
+	};
+	StandardReport simple{};	//no IMU samples
+	simple.ID = 0x3F;
+
+	FusionBank batch(5);
+	FusionBank single(5);
+	std::vector<const StandardReport*> ptrs = { &reports[0], &reports[1], &reports[2], nullptr, &simple };
+
+	for (int n = 0; n < 50; ++n) {
+		batch.update(ptrs.data());
+		for (std::size_t i = 0; i < 3; ++i)
+			single.update(i, reports[i]);
+	}
+
+	for (std::size_t i = 0; i < 3; ++i) {
+		EXPECT_FLOAT_EQ(batch.orientation(i).w, single.orientation(i).w);
+		EXPECT_FLOAT_EQ(batch.orientation(i).x, single.orientation(i).x);
+		EXPECT_FLOAT_EQ(batch.orientation(i).y, single.orientation(i).y);
+		EXPECT_FLOAT_EQ(batch.orientation(i).z, single.orientation(i).z);
+	}
+	for (std::size_t i = 3; i < 5; ++i) {
+		EXPECT_FLOAT_EQ(batch.orientation(i).w, 1.0f);
+		EXPECT_FLOAT_EQ(batch.orientation(i).x, 0.0f);
+	}
+}
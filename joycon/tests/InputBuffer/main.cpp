@@ -1,4 +1,5 @@
 #include <iostream>
+#include <sstream>
 #include <stdint.h> //for size_t SIZE_MAX macro
 
 #include "gtest/gtest.h"
@@ -135,7 +136,7 @@ TEST(InputBufferMember, Testget_reply_data) {
 	//set cmd id to 0x21, for testing!
 	buf_in.data()[0] = 0x21; //DONT CHANGE INPUT BUFFER IN PRODUCTION LIKE THIS!
 
-	ByteVector reply_data = buf_in.get_reply_data();
+	ByteView reply_data = buf_in.get_reply_data();
 
 	//calling reply data with no arguments, should read out the full reply data block
 	//which is 35bytes long
@@ -162,7 +163,7 @@ TEST(InputBufferMember, Testget_reply_data) {
 	EXPECT_THROW({buf_in.get_reply_data(-17, 15);}, std::out_of_range); //offset overflow & length in range
 	EXPECT_THROW({buf_in.get_reply_data(15, 21);}, std::out_of_range); //offset in range, length in range, but offset + length to big
 
-	ByteVector reply_data1 = buf_in.get_reply_data(10, 5);
+	ByteView reply_data1 = buf_in.get_reply_data(10, 5);
 
 	//reply data block starts at index 15 + offset 10 -> 0x19
 	//therefore it should contain {0x19, 0x20, 0x21, 0x22, 0x23}
@@ -172,7 +173,7 @@ TEST(InputBufferMember, Testget_reply_data) {
 	expected1.reserve(5);
 	for(unsigned char i = 0; i < 5; ++i) {
 		test1.push_back(i + 0x0f + 10);
-		expected1.push_back(expected[i+10]);
+		expected1.push_back(reply_data1[i]);
 	}
 
 	EXPECT_EQ(test1, expected1);
@@ -222,7 +223,7 @@ TEST(InputBufferMember, Testget_MCU_FW_update_report) {
 
 	//compare content
 	//should start from 0x0d until 0x31
-	ByteVector result = buf_in.get_MCU_FW_update_report();
+	ByteView result = buf_in.get_MCU_FW_update_report();
 
 	std::vector<unsigned char> expected(37);
 	std::vector<unsigned char> test(37);
@@ -260,7 +261,7 @@ TEST(InputBufferMember, Testget_AxisData) {
 	buf_in.data()[0] = 0x33; //DONT CHANGE INPUT BUFFER IN PRODUCTION LIKE THIS!
 	EXPECT_NO_THROW({buf_in.get_AxisData();}); //0x33 supported
 
-	ByteVector result = buf_in.get_AxisData();
+	ByteView result = buf_in.get_AxisData();
 
 	//compare content
 	//should start from 0x0d until 0x30
@@ -292,7 +293,7 @@ TEST(InputBufferMember, Testget_NFC_IR_input_report) {
 	//set cmd id to 0x31, for testing!
 	buf_in.data()[0] = 0x31; //DONT CHANGE INPUT BUFFER IN PRODUCTION LIKE THIS!
 
-	ByteVector result = buf_in.get_NFC_IR_input_report();
+	ByteView result = buf_in.get_NFC_IR_input_report();
 
 	//compare content
 	//should start from 0x31 until 0x69 (with one overflow 0xff, 0x00 in the middle)
@@ -308,6 +309,38 @@ TEST(InputBufferMember, Testget_NFC_IR_input_report) {
 }
 
 
+TEST(InputBufferMember, TestFormat) {
+	InputBuffer buf_in;
+	for (unsigned int i = 0; i < 50; ++i)
+		buf_in.data()[i] = i * 5; //DONT CHANGE INPUT BUFFER IN PRODUCTION LIKE THIS!
+	buf_in.data()[0] = 0x21;
+
+	const std::string expected = "21 | 05 | 0a | 0f 14 19 | 1e 23 28 | 2d 32 37 | 3c || 41|46|"
+		"4b 50 55 5a 5f 64 69 6e 73 78 7d 82 87 8c 91 96 9b a0 a5 aa af b4 b9 be c3 c8 cd d2 d7 dc e1 e6 eb f0 f5 ||";
+
+	char text[InputBuffer::FORMAT_SIZE];
+	EXPECT_EQ(std::string(text, buf_in.format(text, sizeof(text))), expected);
+
+	std::ostringstream os;
+	os << buf_in;
+	EXPECT_EQ(os.str(), expected);
+
+	//standard report: three IMU samples
+	buf_in.data()[0] = 0x30;
+	os.str("");
+	os << buf_in;
+	EXPECT_EQ(os.str().substr(51), "|| 41 46 4b 50 55 5a 5f 64 69 6e 73 78|7d 82 87 8c 91 96 9b a0 a5 aa af b4|"
+		"b9 be c3 c8 cd d2 d7 dc e1 e6 eb f0 ||");
+
+	//largest report fits
+	InputBuffer buf_nfc(true);
+	buf_nfc.data()[0] = 0x31;
+	std::size_t size = buf_nfc.format(text, sizeof(text));
+	EXPECT_LT(size, sizeof(text));
+	EXPECT_EQ(std::string(text + size - 5, 5), " 00 |");
+}
+
+
 } //namespace
 
 int main(int argc, char **argv) {
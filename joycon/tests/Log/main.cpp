@@ -0,0 +1,164 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "buffer.h"
+#include "log.h"
+
+namespace {
+
+class LogTest : public ::testing::Test {
+protected:
+	void SetUp() override {
+		Logger::flush();
+		Logger::set_sink(&out);
+		Logger::set_level(LOG_TRACE);
+	}
+
+	void TearDown() override {
+		Logger::flush();
+		Logger::set_sink(&std::clog);
+		Logger::set_level(LOG_DEBUG);
+	}
+
+	// the texts of the written lines, without timestamp and level
+	std::vector<std::string> lines() {
+		Logger::flush();
+		std::vector<std::string> res;
+		std::istringstream in(out.str());
+		std::string line;
+		while (std::getline(in, line)) {
+			res.push_back(line.substr(line.find(']') + 4));
+		}
+		return res;
+	}
+
+	std::ostringstream out;
+};
+
+int side_effects = 0;
+
+int count_call() {
+	return ++side_effects;
+}
+
+} // namespace
+
+//"[seconds.microseconds] level text"
+TEST_F(LogTest, TestLine) {
+	LOG(LOG_WARNING) << "text";
+	Logger::flush();
+
+	std::string line = out.str();
+	EXPECT_EQ(line.front(), '[');
+	EXPECT_EQ(line.substr(line.find(']')), "] W text\n");
+}
+
+TEST_F(LogTest, TestRuntimeLevel) {
+	Logger::set_level(LOG_INFO);
+	EXPECT_FALSE(Logger::enabled(LOG_DEBUG));
+	EXPECT_TRUE(Logger::enabled(LOG_ERROR));
+
+	LOG(LOG_DEBUG) << "debug " << count_call();
+	LOG(LOG_INFO) << "info";
+	LOG(LOG_ERROR) << "error";
+
+	EXPECT_THAT(lines(), ::testing::ElementsAre("info", "error"));
+	EXPECT_EQ(side_effects, 0); //arguments of disabled lines are not evaluated
+
+	Logger::set_level(LOG_OFF);
+	EXPECT_FALSE(Logger::enabled(LOG_ERROR));
+}
+
+TEST_F(LogTest, TestFormat) {
+	InputBuffer buff_in;
+	buff_in.data()[0] = 0x30;
+
+	LOG(LOG_INFO) << 42 << ' ' << -7 << ' ' << 0u << ' ' << 18446744073709551615ull;
+	LOG(LOG_INFO) << LogHex(0x2006) << ' ' << 0.5;
+	LOG(LOG_INFO) << std::string("mac ") << ByteVector{ 0x98, 0xB6, 0xE9 };
+	LOG(LOG_INFO) << L"SN : " << std::wstring(L"98ä");
+
+	std::ostringstream expected;
+	expected << "report: " << buff_in;
+	LOG(LOG_INFO) << "report: " << buff_in;
+
+	EXPECT_THAT(lines(), ::testing::ElementsAre("42 -7 0 18446744073709551615", "2006 0.5", "mac 98 b6 e9", "SN : 98?", expected.str()));
+}
+
+TEST_F(LogTest, TestTruncate) {
+	LOG(LOG_INFO) << std::string(LogEntry::TEXT_SIZE - 1, 'a') << "bcd";
+	LOG(LOG_INFO) << std::string(LogEntry::TEXT_SIZE - 4, 'a') << ByteVector{ 0x01, 0x02, 0x03 };
+
+	std::vector<std::string> res = lines();
+	ASSERT_EQ(res.size(), 2u);
+	EXPECT_EQ(res[0], std::string(LogEntry::TEXT_SIZE - 1, 'a') + "b");
+	EXPECT_EQ(res[1], std::string(LogEntry::TEXT_SIZE - 4, 'a') + "01"); //whole bytes only
+}
+
+//a line started while formatting another one is dropped
+TEST_F(LogTest, TestNested) {
+	std::size_t dropped = Logger::dropped();
+	auto nested = []() {
+		LOG(LOG_INFO) << "inner";
+		return 1;
+	};
+	{
+		LogLine line(LOG_INFO);
+		line << "outer " << nested();
+	}
+
+	std::vector<std::string> res = lines();
+	ASSERT_FALSE(res.empty());
+	EXPECT_EQ(res.front(), "outer 1");
+	EXPECT_EQ(Logger::dropped(), dropped + 1);
+}
+
+//every thread keeps its order, nothing gets lost without being counted
+TEST_F(LogTest, TestThreads) {
+	const int threads = 4;
+	const int count = 2000;
+
+	std::size_t written = Logger::written();
+	std::size_t dropped = Logger::dropped();
+
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; ++t) {
+		workers.emplace_back([t]() {
+			for (int i = 0; i < count; ++i) {
+				LOG(LOG_DEBUG) << t << ':' << i;
+			}
+		});
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	std::vector<int> last(threads, -1);
+	for (const std::string& line : lines()) {
+		if (line.compare(0, 4, "log:") == 0) {
+			continue; //drop report of the writer
+		}
+		int t = std::stoi(line.substr(0, line.find(':')));
+		int i = std::stoi(line.substr(line.find(':') + 1));
+		EXPECT_GT(i, last[t]);
+		last[t] = i;
+	}
+
+	EXPECT_EQ(Logger::written() - written + Logger::dropped() - dropped, static_cast<std::size_t>(threads * count));
+}
+
+TEST(Logger, TestParseLevel) {
+	LOG_LEVEL level = LOG_INFO;
+	EXPECT_TRUE(Logger::parse_level("trace", level));
+	EXPECT_EQ(level, LOG_TRACE);
+	EXPECT_TRUE(Logger::parse_level("off", level));
+	EXPECT_EQ(level, LOG_OFF);
+	EXPECT_FALSE(Logger::parse_level("verbose", level));
+	EXPECT_EQ(level, LOG_OFF);
+}
@@ -0,0 +1,161 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "metrics.h"
+
+namespace {
+
+using namespace std::chrono;
+
+//0x30 reports every 15ms, the timer counts up by 3
+struct Stream {
+	void report(byte ID = 0x30) {
+		monitor.on_report(ID, timer, time);
+	}
+	void next(int steps = 1) {
+		timer = static_cast<byte>(timer + 3 * steps);
+		time += milliseconds(15) * steps;
+	}
+
+	LinkMetrics metrics;
+	LinkMonitor monitor{ metrics };
+	byte timer = 0xF0;
+	LinkMonitor::Clock::time_point time = LinkMonitor::Clock::now();
+};
+
+} // namespace
+
+//exact below 2^SUB_BITS, above the bucket keeps the relative error small
+TEST(LatencyHistogram, TestBuckets) {
+	for (uint64_t value = 0; value < 32; ++value) {
+		EXPECT_EQ(HistogramSnapshot::bucket(value), value);
+	}
+
+	std::size_t last = 0;
+	for (uint64_t value = 1; value < (uint64_t(1) << HistogramSnapshot::MAX_EXPONENT); value = value * 9 / 8 + 1) {
+		std::size_t bucket = HistogramSnapshot::bucket(value);
+		EXPECT_GE(bucket, last);
+		EXPECT_LE(HistogramSnapshot::lowest(bucket), value);
+		EXPECT_GE(HistogramSnapshot::highest(bucket), value);
+		EXPECT_LE(HistogramSnapshot::highest(bucket) - HistogramSnapshot::lowest(bucket), value / 32);
+		last = bucket;
+	}
+
+	EXPECT_EQ(HistogramSnapshot::bucket(UINT64_MAX), HistogramSnapshot::BUCKETS - 1);
+	EXPECT_EQ(HistogramSnapshot::bucket((uint64_t(1) << HistogramSnapshot::MAX_EXPONENT) - 1), HistogramSnapshot::BUCKETS - 1);
+}
+
+TEST(LatencyHistogram, TestPercentile) {
+	LatencyHistogram histogram;
+	EXPECT_EQ(histogram.snapshot().percentile(50), 0u);
+
+	for (uint64_t value = 1; value <= 1000; ++value) {
+		histogram.record(value);
+	}
+	histogram.record(milliseconds(15));
+
+	HistogramSnapshot snapshot = histogram.snapshot();
+	EXPECT_EQ(snapshot.count, 1001u);
+	EXPECT_EQ(snapshot.min, 1u);
+	EXPECT_EQ(snapshot.max, 15000u);
+	EXPECT_NEAR(snapshot.percentile(50), 501, 501 / 32);
+	EXPECT_NEAR(snapshot.percentile(99), 991, 991 / 32);
+	EXPECT_EQ(snapshot.percentile(100), 15000u);
+	EXPECT_NEAR(snapshot.mean(), (500500.0 + 15000.0) / 1001, 0.001);
+
+	histogram.reset();
+	EXPECT_EQ(histogram.snapshot().count, 0u);
+}
+
+//concurrent recording loses nothing
+TEST(LatencyHistogram, TestConcurrent) {
+	LatencyHistogram histogram;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&histogram]() {
+			for (uint64_t value = 0; value < 10000; ++value) {
+				histogram.record(value);
+			}
+		});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+
+	HistogramSnapshot snapshot = histogram.snapshot();
+	EXPECT_EQ(snapshot.count, 40000u);
+	EXPECT_EQ(snapshot.sum, 4u * 9999u * 10000u / 2);
+	EXPECT_EQ(snapshot.max, 9999u);
+}
+
+TEST(LinkMonitor, TestInterArrival) {
+	Stream stream;
+	for (int i = 0; i < 10; ++i) {
+		stream.report();
+		stream.next();
+	}
+
+	LinkSnapshot snapshot = stream.metrics.snapshot();
+	EXPECT_EQ(snapshot.reports, 10u);
+	EXPECT_EQ(snapshot.lost_reports, 0u);
+	EXPECT_EQ(snapshot.inter_arrival.count, 9u);
+	EXPECT_EQ(snapshot.inter_arrival.min, 15000u);
+	EXPECT_EQ(snapshot.inter_arrival.max, 15000u);
+	EXPECT_EQ(snapshot.jitter_us, 0u);
+}
+
+//missing reports leave a gap in the timer, also across its wrap
+TEST(LinkMonitor, TestLostReports) {
+	Stream stream;
+	for (int i = 0; i < 10; ++i) {
+		stream.report();
+		stream.next();
+	}
+	stream.next(2); //2 lost
+	stream.report();
+	stream.next();
+	stream.report();
+
+	LinkSnapshot snapshot = stream.metrics.snapshot();
+	EXPECT_EQ(snapshot.reports, 12u);
+	EXPECT_EQ(snapshot.lost_reports, 2u);
+	EXPECT_NEAR(snapshot.loss_rate(), 2.0 / 14, 0.0001);
+	EXPECT_GT(snapshot.jitter_us, 0u);
+}
+
+//0x21 replies in the periodic stream take the place of a report, 0x3F reports are no stream
+TEST(LinkMonitor, TestReplies) {
+	Stream stream;
+	for (int i = 0; i < 5; ++i) {
+		stream.report(0x3F);
+		stream.next(7);
+		stream.report(0x21);
+		stream.next(5);
+	}
+	for (int i = 0; i < 10; ++i) {
+		stream.report(i % 3 == 0 ? 0x21 : 0x30);
+		stream.next();
+	}
+
+	LinkSnapshot snapshot = stream.metrics.snapshot();
+	EXPECT_EQ(snapshot.reports, 20u);
+	EXPECT_EQ(snapshot.lost_reports, 0u);
+}
+
+//after a long pause the timer may have wrapped, the gap is unknown
+TEST(LinkMonitor, TestResync) {
+	Stream stream;
+	for (int i = 0; i < 5; ++i) {
+		stream.report();
+		stream.next();
+	}
+	stream.time += seconds(2);
+	stream.timer = static_cast<byte>(stream.timer + 100);
+	stream.report();
+
+	EXPECT_EQ(stream.metrics.snapshot().lost_reports, 0u);
+}
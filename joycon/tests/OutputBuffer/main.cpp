@@ -1,4 +1,5 @@
 #include <iostream>
+#include <sstream>
 #include <stdint.h> //for size_t SIZE_MAX macro
 
 #include "gtest/gtest.h"
@@ -32,21 +33,19 @@ TEST(OutputBufferCTor, TestNormalCTor) {
 //construct with size = SIZE_MAX to trigger overflow
 //Our exception from BufferBase should be thrown
 TEST(OutputBufferCTor, TestOverflowCTor) {
-	EXPECT_THROW({OutputBuffer buf_out(SIZE_MAX);}, std::bad_alloc);
+	EXPECT_THROW({OutputBuffer buf_out(SIZE_MAX);}, std::length_error);
 }
 
 //construct with size = -1 to trigger overflow (usinged int)
 //Our exception from BufferBase should be thrown
 TEST(OutputBufferCTor, TestUnderflowCTor) {
-	EXPECT_THROW({OutputBuffer buf_out(-1);}, std::bad_alloc);
+	EXPECT_THROW({OutputBuffer buf_out(-1);}, std::length_error);
 }
 
 //construct with size = SIZE_MAX -12 to trigger overflow
-//Exception from std::vector should be thrown
-//This Test will fail, if you should have enough space, to create a vector with 2^64 - 2 elements
-//which is very unlikely (you need just about 18 petabyte), thats why we expect a throw here
+//No overflow, but far more than the inline storage holds: BufferBase should throw
 TEST(OutputBufferCTor, TestMaxSizeCTor) {
-	EXPECT_THROW({OutputBuffer buf_out(SIZE_MAX-12);}, std::bad_alloc);
+	EXPECT_THROW({OutputBuffer buf_out(SIZE_MAX-12);}, std::length_error);
 }
 
 //Testing Member functions of OutputBuffer
@@ -159,6 +158,53 @@ TEST(OutputBufferMember, TestSet_rumble_leftandright) {
 	EXPECT_EQ(expected_right_rumble_buf, test_right_rumble_buf);
 }
 
+TEST(OutputBufferMember, TestFormat) {
+	OutputBuffer buf_out(3);
+	buf_out.set_cmd(0x01);
+	buf_out.set_GP(0x02);
+	buf_out.set_subcmd(0x10);
+	buf_out.set_data({ 0x20, 0x60, 0xFF });
+
+	const std::string expected = "01 | 02 | 00 01 40 40 | 00 01 40 40 | 10 || 20 60 ff ||";
+
+	char text[OutputBuffer::FORMAT_SIZE];
+	EXPECT_EQ(std::string(text, buf_out.format(text, sizeof(text))), expected);
+
+	std::ostringstream os;
+	os << buf_out;
+	EXPECT_EQ(os.str(), expected);
+
+	//without data
+	os.str("");
+	os << OutputBuffer();
+	EXPECT_EQ(os.str(), "00 | 00 | 00 01 40 40 | 00 01 40 40 | 00 |");
+
+	//too small: cut, never written past size
+	text[10] = 'x';
+	EXPECT_EQ(buf_out.format(text, 10), 10u);
+	EXPECT_EQ(std::string(text, 10), "01 | 02 | ");
+	EXPECT_EQ(text[10], 'x');
+
+	//largest buffer fits
+	OutputBuffer buf_max(351);
+	EXPECT_LT(buf_max.format(text, sizeof(text)), sizeof(text));
+}
+
+TEST(HexString, TestEncode) {
+	ByteVector data{ 0x00, 0x0F, 0xA5, 0xFF };
+
+	char text[16];
+	EXPECT_EQ(hex_encode(data.begin(), data.end(), text) - text, 8);
+	EXPECT_EQ(std::string(text, 8), "000fa5ff");
+	EXPECT_EQ(hex_encode(data.begin(), data.end(), text, ", ", 2) - text, static_cast<long>(hex_length(4, 2)));
+	EXPECT_EQ(std::string(text, hex_length(4, 2)), "00, 0f, a5, ff");
+
+	EXPECT_EQ(to_hex_string(data), "0x000fa5ff");
+	EXPECT_EQ(to_hex_string(data, "", ":"), "00:0f:a5:ff");
+	EXPECT_EQ(to_hex_string(data, 1, 2, "#", " "), "#0f a5");
+	EXPECT_EQ(to_hex_string(ByteVector()), "");
+}
+
 } //namespace
 
 int main(int argc, char **argv) {
@@ -0,0 +1,68 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "pairing.h"
+
+namespace {
+
+StandardReport report(uint64_t timestamp_ns, uint32_t buttons, uint16_t stick, byte IMU_samples = 3) {
+	StandardReport res{};
+	res.ID = IMU_samples > 0 ? 0x30 : 0x21;
+	res.timestamp_ns = timestamp_ns;
+	res.buttons = buttons;
+	res.left_stick[0] = res.left_stick[1] = stick;
+	res.right_stick[0] = res.right_stick[1] = stick;
+	res.IMU_samples = IMU_samples;
+	for (byte i = 0; i < IMU_samples; ++i) {
+		res.IMU[i].accel[0] = static_cast<int16_t>(stick);
+	}
+	res.orientation[0] = 1.0f;
+	return res;
+}
+
+} // namespace
+
+//every report makes a frame with the latest report of the other side
+TEST(PairMerger, TestSampleAndHold) {
+	PairMerger merger;
+	EXPECT_EQ(merger.frame().left.orientation[0], 1.0f);
+
+	const PairedState& first = merger.add(report(1000, BUTTON_L | BUTTON_A, 100), true);
+	EXPECT_EQ(first.timestamp_ns, 1000u);
+	EXPECT_EQ(first.buttons, static_cast<uint32_t>(BUTTON_L)); //A is no button of the left Joy-Con
+	EXPECT_EQ(first.left.stick[0], 100);
+	EXPECT_EQ(first.left.IMU_samples, 3);
+
+	const PairedState& second = merger.add(report(1500, BUTTON_A | BUTTON_PLUS, 200), false);
+	EXPECT_EQ(second.timestamp_ns, 1500u);
+	EXPECT_EQ(second.buttons, static_cast<uint32_t>(BUTTON_L | BUTTON_A | BUTTON_PLUS));
+	EXPECT_EQ(second.left.stick[0], 100);
+	EXPECT_EQ(second.right.stick[0], 200);
+	EXPECT_EQ(second.left.IMU_samples, 0); //no new samples of the left side
+	EXPECT_EQ(second.right.IMU_samples, 3);
+	EXPECT_EQ(second.skew_ns(), 500u);
+
+	//a reply keeps the IMU data
+	const PairedState& third = merger.add(report(1600, 0, 300, 0), true);
+	EXPECT_EQ(third.buttons, static_cast<uint32_t>(BUTTON_A | BUTTON_PLUS));
+	EXPECT_EQ(third.left.stick[0], 300);
+	EXPECT_EQ(third.left.IMU[0].accel[0], 100);
+}
+
+//both streams are interleaved by timestamp, frames never go back in time
+TEST(PairMerger, TestMerge) {
+	PairMerger merger;
+	std::vector<StandardReport> left = { report(10, 0, 1), report(30, 0, 3), report(50, 0, 5) };
+	std::vector<StandardReport> right = { report(20, 0, 2), report(25, 0, 2), report(60, 0, 6) };
+
+	std::vector<uint64_t> timestamps;
+	merger.merge(left.data(), left.size(), right.data(), right.size(), [&timestamps](const PairedState& frame) {
+		timestamps.push_back(frame.timestamp_ns);
+	});
+	EXPECT_EQ(timestamps, std::vector<uint64_t>({ 10, 20, 25, 30, 50, 60 }));
+
+	//late report of one side
+	EXPECT_EQ(merger.add(report(40, 0, 4), true).timestamp_ns, 60u);
+}
@@ -0,0 +1,140 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "reactor.h"
+
+namespace {
+
+//non-blocking pipe, stands in for a /dev/hidrawX node
+struct Pipe {
+	Pipe() {
+		if (pipe2(fds, O_NONBLOCK) == -1)
+			throw std::runtime_error("pipe2 failed");
+	}
+	~Pipe() {
+		close(fds[0]);
+		if (fds[1] != -1)
+			close(fds[1]);
+	}
+	void send(unsigned char value) {
+		EXPECT_EQ(write(fds[1], &value, 1), 1);
+	}
+	void hang_up() {
+		close(fds[1]);
+		fds[1] = -1;
+	}
+	int in() const { return fds[0]; }
+
+	int fds[2];
+};
+
+//wait until pred is true or 2 seconds passed
+template <typename Pred>
+bool wait_for(Pred pred) {
+	auto end = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+	while (!pred()) {
+		if (std::chrono::steady_clock::now() > end)
+			return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+//handler like Joycon::on_readable: drain everything, false if the other side is gone
+Reactor::Handler drain(int fd, std::atomic<int>& counter) {
+	return [fd, &counter]() {
+		unsigned char value;
+		while (true) {
+			ssize_t res = read(fd, &value, 1);
+			if (res == 1) {
+				++counter;
+			} else if (res == -1 && errno == EAGAIN) {
+				return true;
+			} else {
+				return false;
+			}
+		}
+	};
+}
+
+//one reactor thread serves all registered fds
+TEST(Reactor, TestMultiplex) {
+	Pipe a, b, c;
+	std::atomic<int> count_a{ 0 }, count_b{ 0 }, count_c{ 0 };
+
+	Reactor reactor;
+	reactor.add(a.in(), drain(a.in(), count_a));
+	reactor.add(b.in(), drain(b.in(), count_b));
+	reactor.add(c.in(), drain(c.in(), count_c));
+	EXPECT_EQ(reactor.size(), 3u);
+	EXPECT_THROW({reactor.add(a.in(), drain(a.in(), count_a));}, std::invalid_argument); //already registered
+
+	reactor.start();
+
+	for (int i = 0; i < 10; ++i)
+		a.send(i);
+	b.send(1);
+
+	EXPECT_TRUE(wait_for([&]() { return count_a == 10 && count_b == 1; }));
+	EXPECT_EQ(count_c, 0);
+
+	reactor.stop();
+}
+
+//a handler returning false is unregistered, remove() works while the reactor runs
+TEST(Reactor, TestRemove) {
+	Pipe a, b;
+	std::atomic<int> count_a{ 0 }, count_b{ 0 };
+
+	Reactor reactor;
+	reactor.add(a.in(), drain(a.in(), count_a));
+	reactor.add(b.in(), drain(b.in(), count_b));
+	reactor.start();
+
+	a.hang_up(); //read returns 0 -> handler returns false
+	EXPECT_TRUE(wait_for([&]() { return reactor.size() == 1; }));
+
+	reactor.remove(b.in());
+	EXPECT_EQ(reactor.size(), 0u);
+	b.send(1);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	EXPECT_EQ(count_b, 0);
+}
+
+//the pool distributes fds round robin over its reactors
+TEST(ReactorPool, TestSharding) {
+	Pipe pipes[4];
+	std::atomic<int> counter{ 0 };
+
+	ReactorPool pool(2);
+	EXPECT_EQ(pool.size(), 2u);
+
+	for (auto& p : pipes)
+		pool.add(p.in(), drain(p.in(), counter));
+
+	EXPECT_EQ(pool.reactor(0).size(), 2u);
+	EXPECT_EQ(pool.reactor(1).size(), 2u);
+
+	pool.start();
+	for (auto& p : pipes)
+		p.send(0);
+
+	EXPECT_TRUE(wait_for([&]() { return counter == 4; }));
+	pool.stop();
+
+	EXPECT_THROW({ReactorPool empty(0);}, std::invalid_argument);
+}
+
+} //namespace
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
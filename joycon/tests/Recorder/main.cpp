@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "recorder.h"
+
+namespace {
+
+const std::string PATH = "recorder_test.jcrl";
+
+std::size_t file_size(const std::string& path) {
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
+	return static_cast<std::size_t>(in.tellg());
+}
+
+class RecorderTest : public ::testing::Test {
+protected:
+	void TearDown() override { std::remove(PATH.c_str()); }
+};
+
+} // namespace
+
+TEST_F(RecorderTest, TestRoundTrip) {
+	{
+		ReportRecorder recorder(PATH, 4096);
+		EXPECT_EQ(file_size(PATH), 4096u);	//preallocated
+
+		EXPECT_TRUE(recorder.record(RECORD_INPUT, 3, ByteVector{ 0x30, 0x01, 0x02 }, 1000));
+		EXPECT_TRUE(recorder.record(RECORD_OUTPUT, 7, ByteVector{ 0x01, 0x00 }, 2000));
+		EXPECT_TRUE(recorder.record(RECORD_INPUT, 3, ByteVector(49, 0xAB)));
+
+		//16 byte header + data, 8 byte aligned
+		EXPECT_EQ(recorder.used(), ReportRecorder::FILE_HEADER_SIZE + 24 + 24 + 72);
+	}
+
+	//cut to the used size
+	EXPECT_EQ(file_size(PATH), ReportRecorder::FILE_HEADER_SIZE + 24 + 24 + 72);
+
+	RecordReader reader(PATH);
+	Record record;
+
+	ASSERT_TRUE(reader.next(record));
+	EXPECT_EQ(record.direction, RECORD_INPUT);
+	EXPECT_EQ(record.device, 3);
+	EXPECT_EQ(record.timestamp_ns, 1000u);
+	EXPECT_EQ(static_cast<ByteVector>(record.data), ByteVector({ 0x30, 0x01, 0x02 }));
+
+	ASSERT_TRUE(reader.next(record));
+	EXPECT_EQ(record.direction, RECORD_OUTPUT);
+	EXPECT_EQ(record.device, 7);
+	EXPECT_EQ(record.timestamp_ns, 2000u);
+	EXPECT_EQ(record.data.size(), 2u);
+
+	ASSERT_TRUE(reader.next(record));
+	EXPECT_EQ(record.data.size(), 49u);
+	EXPECT_GT(record.timestamp_ns, 2000u);
+
+	EXPECT_FALSE(reader.next(record));
+}
+
+TEST_F(RecorderTest, TestFull) {
+	ReportRecorder recorder(PATH, ReportRecorder::FILE_HEADER_SIZE + 2 * 64);
+	ByteVector report(48, 0x11);	//64 byte per record
+
+	EXPECT_TRUE(recorder.record(RECORD_INPUT, 0, report));
+	EXPECT_TRUE(recorder.record(RECORD_INPUT, 0, report));
+	EXPECT_FALSE(recorder.record(RECORD_INPUT, 0, report));
+	EXPECT_FALSE(recorder.record(RECORD_INPUT, 0, ByteVector{ 0x01 }));
+	EXPECT_EQ(recorder.dropped(), 2u);
+	EXPECT_EQ(recorder.used(), recorder.capacity());
+}
+
+//the log is readable while it is written (or after a crash): the reader stops at the first record without size
+TEST_F(RecorderTest, TestLiveAndIncomplete) {
+	ReportRecorder recorder(PATH, 4096);
+	recorder.record(RECORD_INPUT, 1, ByteVector{ 0x30 });
+	recorder.record(RECORD_INPUT, 1, ByteVector{ 0x30 });
+
+	//a half written record: content without the committing size
+	{
+		std::fstream file(PATH, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(recorder.used() + 4);
+		file.write("\x01\x00\x00\x00\xFF\xFF\xFF\xFF", 8);
+	}
+
+	RecordReader reader(PATH);
+	Record record;
+	EXPECT_TRUE(reader.next(record));
+	EXPECT_TRUE(reader.next(record));
+	EXPECT_FALSE(reader.next(record));
+}
+
+//many readers (threads) record at once, nothing gets lost or mixed up
+TEST_F(RecorderTest, TestConcurrent) {
+	const int THREADS = 4;
+	const int RECORDS = 5000;
+	{
+		ReportRecorder recorder(PATH, 1 << 22);
+
+		std::vector<std::thread> threads;
+		for (int t = 0; t < THREADS; ++t) {
+			threads.emplace_back([&recorder, t]() {
+				for (int i = 0; i < RECORDS; ++i) {
+					ByteVector report(1 + i % 60, static_cast<byte>(t));
+					report[0] = static_cast<byte>(i);
+					recorder.record(RECORD_INPUT, static_cast<uint16_t>(t), report, i);
+				}
+			});
+		}
+		for (auto& thread : threads)
+			thread.join();
+		EXPECT_EQ(recorder.dropped(), 0u);
+	}
+
+	RecordReader reader(PATH);
+	Record record;
+	std::map<uint16_t, int> next;
+	while (reader.next(record)) {
+		int i = next[record.device]++;
+		ASSERT_EQ(record.timestamp_ns, static_cast<uint64_t>(i));	//in order per thread
+		ASSERT_EQ(record.data.size(), static_cast<std::size_t>(1 + i % 60));
+		ASSERT_EQ(record.data[0], static_cast<byte>(i));
+		for (std::size_t k = 1; k < record.data.size(); ++k)
+			ASSERT_EQ(record.data[k], record.device);
+	}
+
+	for (int t = 0; t < THREADS; ++t)
+		EXPECT_EQ(next[t], RECORDS);
+}
+
+TEST_F(RecorderTest, TestNoLog) {
+	{
+		std::ofstream out(PATH);
+		out << "no log";
+	}
+	EXPECT_THROW(RecordReader reader(PATH), std::runtime_error);
+}
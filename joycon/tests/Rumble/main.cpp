@@ -0,0 +1,94 @@
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "rumble.h"
+
+namespace {
+
+//the formulas from rumble_info.md
+byte reference_frequency_code(double frequency) {
+	return static_cast<byte>(std::round(std::log2(frequency / 10.0)*32.0));
+}
+
+byte reference_amplitude_code(double amplitude) {
+	if (amplitude < 0.008) {
+		return 0x00;
+	} else if (amplitude < 0.112491) {
+		return static_cast<byte>(std::round((std::log2(amplitude * 5.0 / 18.0) + 9.0)*4.0)) - 1;
+	} else if (amplitude < 0.224982) {
+		return static_cast<byte>(std::round((std::log2(amplitude * 5.0 / 18.0) + 6.0)*16.0)) - 1;
+	} else {
+		return static_cast<byte>(std::round((std::log2(amplitude * 5.0 / 18.0) + 5.0)*32.0)) - 1;
+	}
+}
+
+byte amplitude_code(const ByteArray<4>& data) {
+	return data[1] >> 1;
+}
+
+byte lf(const ByteArray<4>& data) {
+	return data[2] & 0x7F;
+}
+
+} // namespace
+
+//the tables give the same codes as the formulas
+TEST(Rumble, TestEncodeMatchesFormula) {
+	for (double f = 40.87; f <= 1252.57; f *= 1.0007) {
+		byte code = reference_frequency_code(f);
+		Rumble rumble(f, 0.5);
+		if (code < 0xC0) {
+			ASSERT_EQ(lf(rumble.getByte()), code - 0x40) << f;
+		} else {
+			ASSERT_EQ(rumble.getByte()[0] >> 2 | (rumble.getByte()[1] & 0x01) << 6, code - 0x60) << f;
+		}
+	}
+
+	for (double a = 0.0; a <= 1.0; a += 0.0001) {
+		ASSERT_EQ(amplitude_code(Rumble(160.0, a).getByte()), reference_amplitude_code(a)) << a;
+	}
+}
+
+TEST(Rumble, TestDecodeMatchesFormula) {
+	for (byte amp = 0x00; amp <= 0x64; ++amp) {
+		for (byte lf_code = 0x01; lf_code <= 0x7F; lf_code += 0x0E) {
+			ByteArray<4> data{ { 0x00, static_cast<byte>(amp << 1), static_cast<byte>((amp << 7) | lf_code), static_cast<byte>(0x40 | (amp >> 1)) } };
+			Rumble rumble(data);
+
+			double frequency = std::max(40.87, std::min(1252.57, 10.0*std::pow(2.0, (lf_code + 0x40) / 32.0)));
+			EXPECT_NEAR(rumble.getFreqeuncy(), frequency, 1e-9);
+		}
+	}
+
+	Rumble rumble(160.0, 1.0);
+	Rumble decoded(rumble.getByte());
+	EXPECT_DOUBLE_EQ(decoded.getFreqeuncy(), 160.0);
+	EXPECT_DOUBLE_EQ(decoded.getAmplitude(), 1.0);
+}
+
+//the fast path clamps instead of throwing
+TEST(Rumble, TestEncodeClamped) {
+	EXPECT_THROW(Rumble(2000.0, 0.5), std::invalid_argument);
+	EXPECT_THROW(Rumble(160.0, 1.5), std::invalid_argument);
+
+	EXPECT_EQ(Rumble::encode(2000.0, 1.5), Rumble(1252.57, 1.0).getByte());
+	EXPECT_EQ(Rumble::encode(-1.0, -1.0), Rumble(40.87, 0.0).getByte());
+	EXPECT_EQ(Rumble::encode(std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN()), Rumble(40.87, 0.0).getByte());
+	EXPECT_EQ(Rumble::encode(320.0, 0.3), Rumble(320.0, 0.3).getByte());
+}
+
+TEST(Rumble, TestEncodeBatch) {
+	std::vector<RumbleSample> samples{ { 40.87, 0.0 }, { 160.0, 0.5 }, { 320.0, 1.0 }, { 5000.0, 2.0 } };
+	std::vector<ByteArray<4>> frames(samples.size());
+
+	Rumble::encode(samples.data(), samples.size(), frames.data());
+
+	for (std::size_t i = 0; i < samples.size(); ++i) {
+		EXPECT_EQ(frames[i], Rumble::encode(samples[i].frequency, samples[i].amplitude));
+	}
+	EXPECT_EQ(frames[2], Rumble(320.0, 1.0).getByte());
+}
@@ -0,0 +1,212 @@
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "log.h"
+#include "rumble.h"
+#include "rumbleengine.h"
+
+using namespace std::chrono;
+
+namespace {
+
+const ByteArray<4> SILENT = Rumble().getByte();
+
+RumbleEffect effect(double frequency, double amplitude, int priority = 0, RUMBLE_CHANNEL channel = RUMBLE_BOTH) {
+	RumbleEffect e;
+	e.frequency = frequency;
+	e.amplitude = amplitude;
+	e.sustain = milliseconds(100);
+	e.priority = priority;
+	e.channel = channel;
+	return e;
+}
+
+} // namespace
+
+TEST(RumbleMixer, TestEnvelope) {
+	RumbleMixer mixer;
+	RumbleMixer::Clock::time_point t0;
+
+	RumbleEffect e = effect(160.0, 0.8);
+	e.attack = milliseconds(10);
+	e.sustain = milliseconds(20);
+	e.release = milliseconds(10);
+	mixer.play(e, t0);
+
+	ByteArray<4> left, right;
+	mixer.mix(t0 + milliseconds(5), left, right);		//attack: half way
+	EXPECT_EQ(left, Rumble::encode(160.0, 0.4));
+	EXPECT_EQ(right, left);
+
+	mixer.mix(t0 + milliseconds(20), left, right);		//sustain
+	EXPECT_EQ(left, Rumble::encode(160.0, 0.8));
+
+	mixer.mix(t0 + milliseconds(35), left, right);		//release: half way
+	EXPECT_EQ(left, Rumble::encode(160.0, 0.4));
+
+	mixer.mix(t0 + milliseconds(40), left, right);		//done
+	EXPECT_EQ(left, SILENT);
+	EXPECT_EQ(mixer.playing(), 0u);
+}
+
+TEST(RumbleMixer, TestCancel) {
+	RumbleMixer mixer;
+	RumbleMixer::Clock::time_point t0;
+
+	RumbleEffect e = effect(160.0, 0.8);
+	e.sustain = milliseconds(-1);	//until cancelled
+	e.release = milliseconds(20);
+	RumbleMixer::EffectID id = mixer.play(e, t0);
+
+	ByteArray<4> left, right;
+	mixer.mix(t0 + seconds(10), left, right);
+	EXPECT_EQ(left, Rumble::encode(160.0, 0.8));
+
+	mixer.cancel(id, t0 + seconds(10));
+	mixer.mix(t0 + seconds(10) + milliseconds(10), left, right);
+	EXPECT_EQ(left, Rumble::encode(160.0, 0.4));
+
+	mixer.mix(t0 + seconds(10) + milliseconds(20), left, right);
+	EXPECT_EQ(left, SILENT);
+}
+
+//higher priority masks lower ones, equal priorities add up and take the frequency of the loudest
+TEST(RumbleMixer, TestPriorityAndSum) {
+	RumbleMixer mixer;
+	RumbleMixer::Clock::time_point t0;
+	ByteArray<4> left, right;
+
+	mixer.play(effect(160.0, 0.3), t0);
+	mixer.play(effect(320.0, 0.4), t0);
+	mixer.mix(t0, left, right);
+	EXPECT_EQ(left, Rumble::encode(320.0, 0.7));
+
+	mixer.play(effect(80.0, 0.2, 1), t0);
+	mixer.mix(t0, left, right);
+	EXPECT_EQ(left, Rumble::encode(80.0, 0.2));
+
+	mixer.play(effect(640.0, 0.9), t0);
+	mixer.mix(t0, left, right);
+	EXPECT_EQ(left, Rumble::encode(80.0, 0.2));
+}
+
+TEST(RumbleMixer, TestChannels) {
+	RumbleMixer mixer;
+	RumbleMixer::Clock::time_point t0;
+	ByteArray<4> left, right;
+
+	mixer.play(effect(160.0, 0.5, 0, RUMBLE_LEFT), t0);
+	mixer.play(effect(320.0, 0.2, 0, RUMBLE_RIGHT), t0);
+	mixer.play(effect(640.0, 0.1, 5, RUMBLE_RIGHT), t0);
+	mixer.mix(t0, left, right);
+
+	EXPECT_EQ(left, Rumble::encode(160.0, 0.5));
+	EXPECT_EQ(right, Rumble::encode(640.0, 0.1));
+}
+
+//unchanged frames are not written
+TEST(RumbleEngine, TestSkipUnchanged) {
+	std::vector<std::pair<ByteArray<4>, ByteArray<4>>> written;
+	RumbleEngine engine([&written](const ByteArray<4>& l, const ByteArray<4>& r) { written.emplace_back(l, r); });
+
+	RumbleEngine::Clock::time_point now = RumbleEngine::Clock::now();
+	EXPECT_FALSE(engine.tick(now));		//silence is the initial state
+
+	RumbleEffect e = effect(160.0, 0.5);
+	e.sustain = milliseconds(-1);
+	RumbleEngine::EffectID id = engine.play(e);
+
+	EXPECT_TRUE(engine.tick(now + milliseconds(10)));
+	EXPECT_FALSE(engine.tick(now + milliseconds(20)));
+	EXPECT_FALSE(engine.tick(now + milliseconds(30)));
+
+	engine.cancel(id);
+	EXPECT_TRUE(engine.tick(now + milliseconds(40)));
+	EXPECT_FALSE(engine.tick(now + milliseconds(50)));
+
+	ASSERT_EQ(written.size(), 2u);
+	EXPECT_EQ(written[0].first, Rumble::encode(160.0, 0.5));
+	EXPECT_EQ(written[1].first, SILENT);
+	EXPECT_EQ(engine.writes(), 2u);
+	EXPECT_EQ(engine.skipped(), 4u);
+}
+
+//a failed write is retried with the next tick
+TEST(RumbleEngine, TestWriteFailure) {
+	int calls = 0;
+	RumbleEngine engine([&calls](const ByteArray<4>&, const ByteArray<4>&) {
+		if (calls++ == 0) throw std::runtime_error("write failed");
+	});
+
+	RumbleEffect e = effect(160.0, 0.5);
+	e.sustain = milliseconds(-1);
+	engine.play(e);
+
+	EXPECT_THROW(engine.tick(), std::runtime_error);
+	EXPECT_TRUE(engine.tick());
+	EXPECT_FALSE(engine.tick());
+}
+
+TEST(RumbleEngine, TestThread) {
+	std::atomic<int> writes{ 0 };
+	RumbleEngine engine([&writes](const ByteArray<4>&, const ByteArray<4>&) { ++writes; }, milliseconds(5));
+	engine.start();
+
+	RumbleEffect e = effect(160.0, 0.5);
+	e.sustain = milliseconds(20);
+	engine.play(e);
+
+	std::this_thread::sleep_for(milliseconds(200));
+	engine.stop();
+
+	//on + off, the ticks in between are skipped
+	EXPECT_EQ(writes.load(), 2);
+	EXPECT_GT(engine.skipped(), 10u);
+}
+
+//a device that is gone: the thread logs the first failure only and backs off until the writes work again
+TEST(RumbleEngine, TestThreadWriteFailure) {
+	std::ostringstream log;
+	Logger::flush();
+	Logger::set_sink(&log);
+
+	std::atomic<bool> fail{ true };
+	std::atomic<int> calls{ 0 };
+	RumbleEngine engine([&fail, &calls](const ByteArray<4>&, const ByteArray<4>&) {
+		++calls;
+		if (fail) throw std::runtime_error("Device lost!");
+	}, milliseconds(5));
+
+	RumbleEffect e = effect(160.0, 0.5);
+	e.sustain = milliseconds(-1);
+	engine.play(e);
+	engine.start();
+
+	//~60 ticks without backoff
+	std::this_thread::sleep_for(milliseconds(300));
+	EXPECT_LT(calls.load(), 15);
+
+	fail = false;
+	auto deadline = steady_clock::now() + seconds(3);
+	while (engine.writes() == 0 && steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(milliseconds(5));
+	}
+	engine.stop();
+	EXPECT_EQ(engine.writes(), 1u);
+
+	Logger::flush();
+	Logger::set_sink(&std::clog);
+	const std::string text = log.str();
+	std::size_t failed_lines = 0;
+	for (std::size_t pos = text.find("Rumble write failed"); pos != std::string::npos; pos = text.find("Rumble write failed", pos + 1)) {
+		++failed_lines;
+	}
+	EXPECT_EQ(failed_lines, 1u);
+	EXPECT_NE(text.find("Rumble writes work again"), std::string::npos);
+}
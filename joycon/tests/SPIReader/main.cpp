@@ -0,0 +1,111 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "spi.h"
+
+namespace {
+
+//fake flash: every byte holds the lower byte of its address
+ByteVector flash(unsigned int address, std::size_t length) {
+	ByteVector res(length);
+	for (std::size_t i = 0; i < length; ++i)
+		res[i] = static_cast<byte>((address + i) & 0xFF);
+	return res;
+}
+
+//answer every chunk like the Joy-Con would
+void read_all(SPIReader& reader) {
+	const std::vector<SPIRange>& chunks = reader.chunks();
+	for (std::size_t i = 0; i < chunks.size(); ++i) {
+		EXPECT_LE(chunks[i].length, SPIReader::MAX_CHUNK);
+		reader.set_chunk_data(i, flash(chunks[i].address, chunks[i].length));
+	}
+}
+
+//the seven calibration reads of Joycon::get_sensor_calibration need six round trips instead of seven,
+//and can go out in parallel
+TEST(SPIReader, TestCalibration) {
+	SPIReader reader;
+	reader.add(0x6020, 0x18);
+	reader.add(0x603D, 0x12);
+	reader.add(0x6080, 0x06);
+	reader.add(0x6086, 0x12);
+	reader.add(0x6098, 0x12);
+	reader.add(0x8010, 0x16);
+	reader.add(0x8026, 0x1A);
+
+	//0x6020 - 0x604F (gap of 5 byte is read along), 0x6080 - 0x60A9, 0x8010 - 0x803F
+	EXPECT_EQ(reader.chunks().size(), 6u);
+	EXPECT_EQ(reader.chunks()[0].address, 0x6020u);
+	EXPECT_EQ(reader.chunks()[0].length, 0x1Du);
+
+	EXPECT_FALSE(reader.complete());
+	EXPECT_THROW({reader.result(0);}, std::logic_error);
+
+	read_all(reader);
+	EXPECT_TRUE(reader.complete());
+
+	EXPECT_EQ(reader.result(0), flash(0x6020, 0x18));
+	EXPECT_EQ(reader.result(1), flash(0x603D, 0x12));
+	EXPECT_EQ(reader.result(4), flash(0x6098, 0x12));
+	EXPECT_EQ(reader.result(6), flash(0x8026, 0x1A));
+}
+
+//body and button color are adjacent -> one chunk
+TEST(SPIReader, TestAdjacentAndOverlapping) {
+	SPIReader reader;
+	std::size_t body = reader.add(0x6053, 3); //order of adding does not matter
+	std::size_t button = reader.add(0x6050, 3);
+	std::size_t both = reader.add(0x6051, 4);
+
+	ASSERT_EQ(reader.chunks().size(), 1u);
+	EXPECT_EQ(reader.chunks()[0].address, 0x6050u);
+	EXPECT_EQ(reader.chunks()[0].length, 6u);
+
+	read_all(reader);
+	EXPECT_EQ(reader.result(body), flash(0x6053, 3));
+	EXPECT_EQ(reader.result(button), flash(0x6050, 3));
+	EXPECT_EQ(reader.result(both), flash(0x6051, 4));
+
+	EXPECT_THROW({reader.add(0x7000, 1);}, std::logic_error); //already planned
+}
+
+//ranges further apart than max_gap are read separately
+TEST(SPIReader, TestMaxGap) {
+	SPIReader reader(0);
+	reader.add(0x6020, 0x18);
+	reader.add(0x603D, 0x12);
+	EXPECT_EQ(reader.chunks().size(), 2u);
+}
+
+//the whole 0x6000 - 0x6FFF factory region
+TEST(SPIReader, TestDump) {
+	SPIReader reader;
+	reader.add(0x6000, 0x1000);
+
+	EXPECT_EQ(reader.chunks().size(), (0x1000u + SPIReader::MAX_CHUNK - 1) / SPIReader::MAX_CHUNK);
+	EXPECT_EQ(reader.chunks().back().length, 0x1000u % SPIReader::MAX_CHUNK);
+
+	read_all(reader);
+	EXPECT_EQ(reader.result(0), flash(0x6000, 0x1000));
+}
+
+//invalid input
+TEST(SPIReader, TestInvalid) {
+	SPIReader reader;
+	EXPECT_THROW({reader.add(0x6000, 0);}, std::invalid_argument);
+	EXPECT_THROW({reader.add(0xFFFFFFFF, 2);}, std::invalid_argument);
+
+	reader.add(0x6000, 4);
+	EXPECT_THROW({reader.set_chunk_data(0, flash(0x6000, 3));}, std::length_error);
+	EXPECT_THROW({reader.set_chunk_data(1, flash(0x6000, 4));}, std::out_of_range);
+}
+
+} //namespace
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
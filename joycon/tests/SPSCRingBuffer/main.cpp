@@ -0,0 +1,131 @@
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "ringbuffer.h"
+
+namespace {
+
+//items come out in the same order they went in
+TEST(SPSCRingBuffer, TestFIFO) {
+	SPSCRingBuffer<int, 8> ring;
+	int item = -1;
+
+	EXPECT_TRUE(ring.empty());
+	EXPECT_FALSE(ring.pop(item)); //nothing to pop
+	EXPECT_EQ(item, -1);
+
+	for (int i = 0; i < 5; ++i)
+		EXPECT_TRUE(ring.push(i));
+	EXPECT_EQ(ring.size(), 5u);
+
+	for (int i = 0; i < 5; ++i) {
+		EXPECT_TRUE(ring.pop(item));
+		EXPECT_EQ(item, i);
+	}
+	EXPECT_TRUE(ring.empty());
+}
+
+//a full ring drops new items and counts them instead of blocking
+TEST(SPSCRingBuffer, TestOverflow) {
+	SPSCRingBuffer<int, 4> ring;
+
+	for (int i = 0; i < 4; ++i)
+		EXPECT_TRUE(ring.push(i));
+	EXPECT_FALSE(ring.push(4));
+	EXPECT_FALSE(ring.push(5));
+	EXPECT_EQ(ring.overflows(), 2u);
+	EXPECT_EQ(ring.size(), 4u);
+
+	//the oldest items survive
+	int item;
+	EXPECT_TRUE(ring.pop(item));
+	EXPECT_EQ(item, 0);
+
+	//one slot is free again
+	EXPECT_TRUE(ring.push(6));
+	EXPECT_EQ(ring.overflows(), 2u);
+}
+
+//drain takes up to max items in one go, also across the wrap-around
+TEST(SPSCRingBuffer, TestDrain) {
+	SPSCRingBuffer<int, 4> ring;
+	int out[4] = { 0 };
+
+	ring.push(0);
+	ring.push(1);
+	ring.push(2);
+	EXPECT_EQ(ring.drain(out, 2), 2u);
+	EXPECT_EQ(out[0], 0);
+	EXPECT_EQ(out[1], 1);
+
+	ring.push(3);
+	ring.push(4);
+	ring.push(5); //wraps around
+
+	std::vector<int> drained;
+	EXPECT_EQ(ring.drain([&drained](const int& item) { drained.push_back(item); }), 4u);
+	EXPECT_EQ(drained, std::vector<int>({ 2, 3, 4, 5 }));
+	EXPECT_EQ(ring.drain(out, 4), 0u);
+}
+
+//claim/commit fill the slot in place, a full ring gives no slot
+TEST(SPSCRingBuffer, TestClaim) {
+	SPSCRingBuffer<int, 2> ring;
+
+	int* slot = ring.claim();
+	ASSERT_NE(slot, nullptr);
+	*slot = 7;
+	EXPECT_TRUE(ring.empty()); //not published yet
+	ring.commit();
+	EXPECT_EQ(ring.size(), 1u);
+
+	ring.push(8);
+	EXPECT_EQ(ring.claim(), nullptr);
+	EXPECT_EQ(ring.overflows(), 1u);
+
+	int item;
+	EXPECT_TRUE(ring.pop(item));
+	EXPECT_EQ(item, 7);
+	EXPECT_NE(ring.claim(), nullptr);
+}
+
+//one producer and one consumer thread: nothing gets lost or reordered
+TEST(SPSCRingBuffer, TestConcurrent) {
+	SPSCRingBuffer<unsigned int, 64> ring;
+	const unsigned int amount = 200000;
+
+	std::thread producer([&ring, amount]() {
+		for (unsigned int i = 0; i < amount; ++i) {
+			while (!ring.push(i)) {
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	unsigned int expected = 0;
+	bool in_order = true;
+	while (expected < amount) {
+		std::size_t drained = ring.drain([&expected, &in_order](const unsigned int& item) {
+			in_order = in_order && (item == expected);
+			++expected;
+		});
+		if (drained == 0) {
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+
+	EXPECT_TRUE(in_order);
+	EXPECT_EQ(expected, amount);
+	EXPECT_TRUE(ring.empty());
+}
+
+} //namespace
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
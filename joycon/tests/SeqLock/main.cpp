@@ -0,0 +1,86 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "seqlock.h"
+
+namespace {
+
+//not a multiple of 8 byte, every field carries the same value
+struct State {
+	uint32_t values[13];
+	uint8_t tail;
+};
+
+State make_state(uint32_t value) {
+	State state;
+	for (auto& v : state.values) {
+		v = value;
+	}
+	state.tail = static_cast<uint8_t>(value);
+	return state;
+}
+
+} // namespace
+
+TEST(SeqLock, TestStoreLoad) {
+	SeqLock<State> lock;
+	EXPECT_EQ(lock.version(), 0u);
+	EXPECT_EQ(lock.load().values[0], 0u); //zero before the first store
+
+	lock.store(make_state(7));
+	EXPECT_EQ(lock.version(), 1u);
+
+	State state = lock.load();
+	EXPECT_EQ(state.values[12], 7u);
+	EXPECT_EQ(state.tail, 7);
+
+	ASSERT_TRUE(lock.try_load(state));
+	EXPECT_EQ(state.values[0], 7u);
+}
+
+//readers never see a half written state and the values only go forward
+TEST(SeqLock, TestConcurrent) {
+	SeqLock<State> lock;
+	std::atomic<bool> done{ false };
+
+	std::vector<std::thread> readers;
+	std::atomic<int> torn{ 0 };
+	std::atomic<int> backwards{ 0 };
+	for (int r = 0; r < 3; ++r) {
+		readers.emplace_back([&]() {
+			uint32_t last = 0;
+			while (!done) {
+				State state = lock.load();
+				for (auto v : state.values) {
+					if (v != state.values[0]) {
+						++torn;
+					}
+				}
+				if (state.tail != static_cast<uint8_t>(state.values[0])) {
+					++torn;
+				}
+				if (state.values[0] < last) {
+					++backwards;
+				}
+				last = state.values[0];
+			}
+		});
+	}
+
+	for (uint32_t i = 1; i <= 200000; ++i) {
+		lock.store(make_state(i));
+	}
+	done = true;
+	for (auto& reader : readers) {
+		reader.join();
+	}
+
+	EXPECT_EQ(torn, 0);
+	EXPECT_EQ(backwards, 0);
+	EXPECT_EQ(lock.version(), 200000u);
+}
@@ -0,0 +1,134 @@
+#include <iostream>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "buffer.h"
+#include "report.h"
+
+namespace {
+
+//fill the first 50 byte of buf_in with the given report
+void fill(InputBuffer& buf_in, std::initializer_list<byte> report) {
+	buf_in.clean();
+	std::copy(report.begin(), report.end(), buf_in.data()); //DONT CHANGE INPUT BUFFER IN PRODUCTION LIKE THIS!
+}
+
+//report IDs without a standard part are not decoded and leave the report untouched
+TEST(StandardReportDecode, TestUnsupportedID) {
+	InputBuffer buf_in;
+	StandardReport report{};
+	report.timer = 0x42;
+
+	buf_in.data()[0] = 0x23;
+	EXPECT_FALSE(decode_report(buf_in, JOYCON_L_BT, report));
+	buf_in.data()[0] = 0x00;
+	EXPECT_FALSE(decode_report(buf_in, JOYCON_L_BT, report));
+
+	EXPECT_EQ(report.timer, 0x42);
+}
+
+//full 0x30 report: header, buttons, 12 bit sticks and three IMU samples
+TEST(StandardReportDecode, TestStandardFullMode) {
+	InputBuffer buf_in;
+	fill(buf_in, {
+		0x30, 0x7A, 0x8E,					//ID, timer, battery (8 = full) + connection info (0xE)
+		0x09, 0x10, 0x42,					//buttons: Y + A | HOME | UP + L
+		0x12, 0x34, 0x56,					//left stick
+		0xFF, 0x0F, 0x80,					//right stick
+		0x0B,								//vibrator
+		0x01, 0x00, 0xFF, 0xFF, 0x00, 0x80,	//sample 0: accel
+		0x02, 0x00, 0xFE, 0xFF, 0xFF, 0x7F,	//sample 0: gyro
+		0x03, 0x00, 0x00, 0x00, 0x00, 0x00,	//sample 1: accel
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,	//sample 1: gyro
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00,	//sample 2: accel
+		0x00, 0x00, 0x00, 0x00, 0x34, 0x12	//sample 2: gyro
+	});
+
+	StandardReport report;
+	ASSERT_TRUE(decode_report(buf_in, JOYCON_L_BT, report));
+
+	EXPECT_EQ(report.ID, 0x30);
+	EXPECT_EQ(report.timer, 0x7A);
+	EXPECT_EQ(report.battery, 8);
+	EXPECT_EQ(get_battery_level(report), POWER::FULL);
+	EXPECT_EQ(report.connection_info, 0xE);
+	EXPECT_EQ(report.buttons, static_cast<uint32_t>(BUTTON_Y | BUTTON_A | BUTTON_HOME | BUTTON_UP | BUTTON_L));
+	EXPECT_EQ(report.vibrator, 0x0B);
+
+	//x = 0x412, y = 0x563
+	EXPECT_EQ(report.left_stick[0], 0x412);
+	EXPECT_EQ(report.left_stick[1], 0x563);
+	//x = 0xFFF, y = 0x800
+	EXPECT_EQ(report.right_stick[0], 0xFFF);
+	EXPECT_EQ(report.right_stick[1], 0x800);
+
+	ASSERT_EQ(report.IMU_samples, 3);
+	EXPECT_EQ(report.IMU[0].accel[0], 1);
+	EXPECT_EQ(report.IMU[0].accel[1], -1);
+	EXPECT_EQ(report.IMU[0].accel[2], -32768);
+	EXPECT_EQ(report.IMU[0].gyro[0], 2);
+	EXPECT_EQ(report.IMU[0].gyro[1], -2);
+	EXPECT_EQ(report.IMU[0].gyro[2], 32767);
+	EXPECT_EQ(report.IMU[1].accel[0], 3);
+	EXPECT_EQ(report.IMU[2].gyro[2], 0x1234);
+}
+
+//pressed, released and held masks, only if a button changed
+TEST(ButtonEvent, TestEdges) {
+	StandardReport report{};
+	report.timestamp_ns = 1234;
+	report.buttons = BUTTON_A | BUTTON_B;
+
+	ButtonEvent event{};
+	ASSERT_TRUE(button_edges(BUTTON_B | BUTTON_ZR, report, event));
+	EXPECT_EQ(event.timestamp_ns, 1234u);
+	EXPECT_EQ(event.pressed, static_cast<uint32_t>(BUTTON_A));
+	EXPECT_EQ(event.released, static_cast<uint32_t>(BUTTON_ZR));
+	EXPECT_EQ(event.held, static_cast<uint32_t>(BUTTON_B));
+
+	EXPECT_FALSE(button_edges(BUTTON_A | BUTTON_B, report, event));
+	EXPECT_EQ(event.pressed, static_cast<uint32_t>(BUTTON_A)); //unchanged
+}
+
+//0x21 replies share the standard part, but carry no IMU data
+TEST(StandardReportDecode, TestSubcommandReply) {
+	InputBuffer buf_in;
+	fill(buf_in, { 0x21, 0x05, 0x40, 0x00, 0x02, 0x00, 0x00, 0x08, 0x80, 0x00, 0x08, 0x80, 0x00, 0x80, 0x03 });
+
+	StandardReport report;
+	ASSERT_TRUE(decode_report(buf_in, JOYCON_R_BT, report));
+
+	EXPECT_EQ(report.ID, 0x21);
+	EXPECT_EQ(report.timer, 0x05);
+	EXPECT_EQ(get_battery_level(report), POWER::LOW);
+	EXPECT_EQ(report.buttons, static_cast<uint32_t>(BUTTON_PLUS));
+	EXPECT_EQ(report.left_stick[0], 0x800);
+	EXPECT_EQ(report.left_stick[1], 0x800);
+	EXPECT_EQ(report.IMU_samples, 0);
+}
+
+//0x3F simple HID mode: face buttons depend on the side of the Joy-Con
+TEST(StandardReportDecode, TestSimpleHIDMode) {
+	InputBuffer buf_in;
+	fill(buf_in, { 0x3F, 0x01 | 0x10, 0x10 | 0x40, 0x02, 0x00, 0x80, 0x00, 0x80, 0x00, 0x80, 0x00, 0x80 });
+
+	StandardReport left;
+	ASSERT_TRUE(decode_report(buf_in, JOYCON_L_BT, left));
+	EXPECT_EQ(left.buttons, static_cast<uint32_t>(BUTTON_DOWN | BUTTON_LEFT_SL | BUTTON_HOME | BUTTON_L));
+	EXPECT_EQ(left.stick_hat, 2);
+	EXPECT_EQ(left.left_stick[0], 0x800);
+	EXPECT_EQ(left.right_stick[1], 0x800);
+	EXPECT_EQ(left.IMU_samples, 0);
+
+	StandardReport right;
+	ASSERT_TRUE(decode_report(buf_in, JOYCON_R_BT, right));
+	EXPECT_EQ(right.buttons, static_cast<uint32_t>(BUTTON_A | BUTTON_RIGHT_SL | BUTTON_HOME | BUTTON_R));
+}
+
+} //namespace
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,547 @@
+#include <chrono>
+#include <cstdio>
+#include <set>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "joycon.h"
+
+namespace {
+
+const std::string LOG = "transport_test.jcrl";
+
+ByteVector standard_report(byte timer) {
+	ByteVector report(49, 0x00);
+	report[0] = 0x30;
+	report[1] = timer;
+	report[2] = 0x8E;
+	return report;
+}
+
+// waits for count reports with IMU samples of device
+std::vector<StandardReport> wait_reports(Joycon& device, std::size_t count) {
+	std::vector<StandardReport> res;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+	while (res.size() < count && std::chrono::steady_clock::now() < deadline) {
+		StandardReport report;
+		if (device.pop_report(report)) {
+			if (report.IMU_samples > 0) {
+				res.push_back(report);
+			}
+		} else {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+	return res;
+}
+
+class TransportTest : public ::testing::Test {
+protected:
+	void TearDown() override {
+		ScriptedTransport::remove_devices();
+		ReplayTransport::remove_devices();
+		std::remove(LOG.c_str());
+	}
+};
+
+} // namespace
+
+TEST_F(TransportTest, TestSubcommandReply) {
+	OutputBuffer buff_out(5);
+	buff_out.set_cmd(0x01);
+	buff_out.set_subcmd(0x10);
+	buff_out.set_data({ 0x20, 0x60, 0x00, 0x00, 0x18 });
+
+	ByteVector reply = subcommand_reply(buff_out.view(), JOYCON_L_BT, ByteArray<6>{}, 7);
+	ASSERT_EQ(reply.size(), 50u);
+	EXPECT_EQ(reply[0], 0x21);
+	EXPECT_EQ(reply[1], 7);
+	EXPECT_EQ(reply[13], 0x90);
+	EXPECT_EQ(reply[14], 0x10);
+	EXPECT_EQ(ByteVector(reply.begin() + 15, reply.begin() + 20), ByteVector({ 0x20, 0x60, 0x00, 0x00, 0x18 }));
+	EXPECT_EQ(reply[20], 0xFF);
+	EXPECT_EQ(reply[20 + 0x17], 0xFF);
+	EXPECT_EQ(reply[20 + 0x18], 0x00);
+}
+
+// the whole initialization and capture runs against an in memory device
+TEST_F(TransportTest, TestScriptedJoycon) {
+	auto device = ScriptedTransport::add_device({ JOYCON_R_BT, L"98:B6:E9:00:00:01", "scripted/0" });
+	ScriptedTransport::add_device({ PRO_CONTROLLER, L"98:B6:E9:00:00:02", "scripted/1" });
+
+	JoyconVec joycons("");
+	ASSERT_EQ(joycons.addDevices(), 0);
+	ASSERT_EQ(joycons.size(), 1u);
+	ASSERT_TRUE(joycons.init_report()[0].ok);
+
+	Joycon& jc = joycons.device(0);
+	EXPECT_EQ(jc.get_PID(), JOYCON_R_BT);
+	EXPECT_EQ(jc.device_info().joyconType, 0x02);
+	EXPECT_EQ(jc.body_color().R, 0xFF);	// erased flash
+
+	// enable vibration, enable IMU, input report mode 0x30, then the device data
+	std::vector<ByteVector> written = device->written();
+	ASSERT_GE(written.size(), 4u);
+	EXPECT_EQ(written[0][10], 0x48);
+	EXPECT_EQ(written[1][10], 0x40);
+	EXPECT_EQ(written[2][10], 0x03);
+	EXPECT_EQ(written[2][11], 0x30);
+	EXPECT_EQ(written[3][10], 0x02);
+
+	ASSERT_EQ(joycons.startDevices(), 0);
+	for (byte i = 0; i < 10; ++i) {
+		device->push_input(standard_report(i));
+	}
+	std::vector<StandardReport> reports = wait_reports(jc, 10);
+	EXPECT_EQ(reports.size(), 10u);
+
+	// host timestamps (see DeviceClock), in order
+	for (std::size_t i = 1; i < reports.size(); ++i) {
+		EXPECT_GT(reports[i - 1].timestamp_ns, 0u);
+		EXPECT_GE(reports[i].timestamp_ns, reports[i - 1].timestamp_ns);
+	}
+}
+
+// devices initialize in parallel: one that never answers fails alone, the report keeps the enumeration order
+TEST_F(TransportTest, TestParallelInit) {
+	ScriptedTransport::add_device({ JOYCON_L_BT, L"98:B6:E9:00:00:01", "scripted/0" });
+	auto silent = ScriptedTransport::add_device({ JOYCON_R_BT, L"98:B6:E9:00:00:02", "scripted/1" });
+	silent->set_responder([](ByteView, ScriptedDevice&) {});
+	ScriptedTransport::add_device({ JOYCON_L_BT, L"98:B6:E9:00:00:03", "scripted/2" });
+	ScriptedTransport::add_device({ JOYCON_R_BT, L"98:B6:E9:00:00:04", "scripted/3" });
+
+	JoyconVec joycons;
+	ASSERT_EQ(joycons.addDevices(4), 0);
+
+	std::vector<std::shared_ptr<Joycon>> devices = joycons.devices();
+	ASSERT_EQ(devices.size(), 3u);
+	EXPECT_EQ(devices[0]->get_path(), "scripted/0");
+	EXPECT_EQ(devices[1]->get_path(), "scripted/2");
+	EXPECT_EQ(devices[2]->get_path(), "scripted/3");
+
+	const std::vector<DeviceInitTiming> report = joycons.init_report();
+	ASSERT_EQ(report.size(), 4u);
+	for (std::size_t i = 0; i < report.size(); ++i) {
+		EXPECT_EQ(report[i].path, "scripted/" + std::to_string(i));
+		EXPECT_EQ(report[i].ok, i != 1) << i;
+		EXPECT_EQ(report[i].error.empty(), i != 1) << i;
+	}
+	EXPECT_EQ(report[1].PID, JOYCON_R_BT);
+	EXPECT_EQ(report[1].serial_number, L"98:B6:E9:00:00:02");
+
+	// the others did not wait for the timeouts of the silent one
+	EXPECT_LT(report[0].duration, report[1].duration);
+	EXPECT_LT(report[2].duration, report[1].duration);
+}
+
+// a cached device is captured while the validation of its data still reads: the reader takes over the reads
+TEST_F(TransportTest, TestCaptureDuringValidation) {
+	auto device = ScriptedTransport::add_device({ JOYCON_L_BT, L"98:B6:E9:00:00:01", "scripted/0" });
+	DeviceCache cache("");
+	{
+		Joycon first(JOYCON_L_BT, const_cast<wchar_t*>(L"98:B6:E9:00:00:01"), "scripted/0", &cache);
+	}
+	ASSERT_EQ(cache.size(), 1u);
+
+	Joycon jc(JOYCON_L_BT, const_cast<wchar_t*>(L"98:B6:E9:00:00:01"), "scripted/0", &cache);
+	jc.capture();
+	for (byte i = 0; i < 10; ++i) {
+		device->push_input(standard_report(i));
+	}
+	EXPECT_EQ(wait_reports(jc, 10).size(), 10u);
+	EXPECT_EQ(jc.device_info().mac, "98:b6:e9:00:00:01");
+}
+
+// commands of another thread fill the queue: the SPI reads wait for their slots instead of failing, before and after capture()
+TEST_F(TransportTest, TestSPIReadFullQueue) {
+	auto device = ScriptedTransport::add_device({ JOYCON_L_BT, L"98:B6:E9:00:00:01", "scripted/0" });
+	Joycon jc(JOYCON_L_BT, const_cast<wchar_t*>(L"98:B6:E9:00:00:01"), "scripted/0");
+
+	// the device info requests stay unanswered until their retries are used up
+	device->set_responder([](ByteView buff_out, ScriptedDevice& self) {
+		if (buff_out.size() > 10 && buff_out[0] == 0x01 && buff_out[10] != 0x02) {
+			self.push_input(subcommand_reply(buff_out, JOYCON_L_BT, ByteArray<6>{}, 0));
+		}
+	});
+
+	for (bool captured : { false, true }) {
+		if (captured) {
+			jc.capture();
+		}
+
+		std::vector<std::future<InputBuffer>> unanswered;
+		for (std::size_t i = 0; i < CommandQueue::MAX_IN_FLIGHT; ++i) {
+			unanswered.push_back(jc.send_command_async(0x01, 0x02, ByteVector{}));
+		}
+
+		std::vector<ByteVector> res = jc.SPI_flash_read({ { 0x6000, 0x10 }, { 0x6020, 0x18 }, { 0x8010, 0x16 } });
+		ASSERT_EQ(res.size(), 3u) << captured;
+		EXPECT_EQ(res[1].size(), 0x18u) << captured;
+		for (std::future<InputBuffer>& reply : unanswered) {
+			EXPECT_THROW({reply.get();}, std::runtime_error) << captured;
+		}
+	}
+}
+
+// the initialization subcommands and the captured reports show up in the link metrics
+TEST_F(TransportTest, TestLinkMetrics) {
+	auto device = ScriptedTransport::add_device({ JOYCON_L_BT, L"98:B6:E9:00:00:01", "scripted/0" });
+	Joycon jc(JOYCON_L_BT, const_cast<wchar_t*>(L"98:B6:E9:00:00:01"), "scripted/0");
+
+	LinkSnapshot before = jc.metrics();
+	EXPECT_GE(before.round_trip.count, 4u);
+	EXPECT_GE(before.commands_in_flight_max, 1u);	// SPI reads are pipelined
+	EXPECT_EQ(before.write_failures, 0u);
+
+	jc.capture();
+	for (byte i = 0; i < 10; ++i) {
+		device->push_input(standard_report(i));
+	}
+	device->push_input(standard_report(12));	// 2 reports lost
+	EXPECT_EQ(wait_reports(jc, 11).size(), 11u);
+
+	LinkSnapshot after = jc.metrics();
+	EXPECT_EQ(after.reports - before.reports, 11u);
+	EXPECT_EQ(after.lost_reports, 2u);
+	EXPECT_EQ(after.inter_arrival.count, 10u);
+	EXPECT_GE(after.report_queue_max, 1u);
+	EXPECT_EQ(after.report_queue, 0u);
+}
+
+// one button event per change, none for reports with the same buttons
+TEST_F(TransportTest, TestButtonEvents) {
+	auto device = ScriptedTransport::add_device({ JOYCON_R_BT, L"98:B6:E9:00:00:01", "scripted/0" });
+	Joycon jc(JOYCON_R_BT, const_cast<wchar_t*>(L"98:B6:E9:00:00:01"), "scripted/0");
+
+	jc.capture();
+	const byte buttons[] = { 0x00, BUTTON_A, BUTTON_A, BUTTON_A | BUTTON_B, BUTTON_A | BUTTON_B, 0x00 };
+	for (byte i = 0; i < sizeof(buttons); ++i) {
+		ByteVector report = standard_report(i);
+		report[report_offset::BUTTONS] = buttons[i];
+		device->push_input(report);
+	}
+	ASSERT_EQ(wait_reports(jc, sizeof(buttons)).size(), sizeof(buttons));
+
+	// the last report is also the latest state
+	EXPECT_GE(jc.state_version(), sizeof(buttons));
+	EXPECT_EQ(jc.state().timer, sizeof(buttons) - 1);
+	EXPECT_EQ(jc.state().buttons, 0u);
+
+	std::vector<ButtonEvent> events;
+	jc.drain_button_events([&events](const ButtonEvent& event) { events.push_back(event); });
+	ASSERT_EQ(events.size(), 3u);
+	EXPECT_EQ(events[0].pressed, static_cast<uint32_t>(BUTTON_A));
+	EXPECT_EQ(events[1].pressed, static_cast<uint32_t>(BUTTON_B));
+	EXPECT_EQ(events[1].held, static_cast<uint32_t>(BUTTON_A));
+	EXPECT_EQ(events[2].released, static_cast<uint32_t>(BUTTON_A | BUTTON_B));
+	EXPECT_GE(events[2].timestamp_ns, events[0].timestamp_ns);
+	EXPECT_EQ(jc.dropped_button_events(), 0u);
+}
+
+// a left and a right device as one controller
+TEST_F(TransportTest, TestPair) {
+	auto left_device = ScriptedTransport::add_device({ JOYCON_L_BT, L"98:B6:E9:00:00:01", "scripted/0" });
+	auto right_device = ScriptedTransport::add_device({ JOYCON_R_BT, L"98:B6:E9:00:00:02", "scripted/1" });
+
+	JoyconVec joycons("");
+	ASSERT_EQ(joycons.addDevices(), 0);
+	ASSERT_EQ(joycons.pairs().size(), 1u);
+	std::shared_ptr<Joycon> left = joycons.pairs()[0].first;
+	std::shared_ptr<Joycon> right = joycons.pairs()[0].second;
+	EXPECT_EQ(left->get_PID(), JOYCON_L_BT);
+	EXPECT_THROW({ JoyconPair wrong(right, left); }, std::invalid_argument);
+	EXPECT_THROW({ JoyconPair missing(left, nullptr); }, std::invalid_argument);
+
+	JoyconPair pair(left, right);
+	pair.poll();	// the replies of the initialization
+	ASSERT_EQ(joycons.startDevices(), 0);
+
+	ByteVector report = standard_report(1);
+	report[report_offset::BUTTONS + 2] = BUTTON_L >> 16;
+	left_device->push_input(report);
+	report = standard_report(1);
+	report[report_offset::BUTTONS] = BUTTON_A;
+	right_device->push_input(report);
+
+	std::size_t frames = 0;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+	while (frames < 2 && std::chrono::steady_clock::now() < deadline) {
+		frames += pair.poll();
+	}
+	EXPECT_EQ(frames, 2u);
+	EXPECT_EQ(pair.state().buttons, static_cast<uint32_t>(BUTTON_L | BUTTON_A));
+}
+
+// devices come and go while the others keep delivering
+TEST_F(TransportTest, TestHotplug) {
+	auto first = ScriptedTransport::add_device({ JOYCON_L_BT, L"98:B6:E9:00:00:01", "scripted/0" });
+
+	JoyconVec joycons("");
+	HotplugQueue events;
+	ASSERT_TRUE(joycons.watch(events.source()));
+	EXPECT_FALSE(joycons.watch(events.source()));
+	ASSERT_EQ(joycons.addDevices(), 0);
+	ASSERT_EQ(joycons.startDevices(), 0);
+	std::shared_ptr<Joycon> kept = joycons.devices().at(0);
+
+	auto wait_size = [&joycons](std::size_t size) {
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (joycons.size() != size && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return joycons.size() == size;
+	};
+
+	// known already, not added twice
+	HotplugEvent added;
+	added.vendor_id = JOYCON_VENDOR;
+	added.product_id = JOYCON_L_BT;
+	added.path = "scripted/0";
+	events.push(added);
+
+	// attached and started right away
+	auto second = ScriptedTransport::add_device({ JOYCON_R_BT, L"98:B6:E9:00:00:02", "scripted/1" });
+	added.product_id = JOYCON_R_BT;
+	added.serial_number = L"98:B6:E9:00:00:02";
+	added.path = "scripted/1";
+	events.push(added);
+	ASSERT_TRUE(wait_size(2));
+	EXPECT_EQ(joycons.init_report().size(), 2u);
+	std::shared_ptr<Joycon> attached = joycons.devices().at(1);
+	EXPECT_EQ(attached->get_PID(), JOYCON_R_BT);
+
+	second->push_input(standard_report(1));
+	first->push_input(standard_report(1));
+	EXPECT_EQ(wait_reports(*attached, 1).size(), 1u);
+	EXPECT_EQ(wait_reports(*kept, 1).size(), 1u);
+
+	// the reader notices the loss, retired without an event, the others keep going
+	second->disconnect();
+	attached.reset();
+	ASSERT_TRUE(wait_size(1));
+	first->push_input(standard_report(2));
+	EXPECT_EQ(wait_reports(*kept, 1).size(), 1u);
+
+	// retired by its event, the pointer of the consumer stays valid
+	HotplugEvent removed;
+	removed.action = HOTPLUG_REMOVE;
+	removed.path = "scripted/0";
+	events.push(removed);
+	ASSERT_TRUE(wait_size(0));
+	EXPECT_EQ(kept->get_PID(), JOYCON_L_BT);
+
+	// a blocking command of a lost device fails instead of waiting forever
+	first->set_responder(nullptr);
+	std::thread lose([&first]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		first->disconnect();
+	});
+	auto start = std::chrono::steady_clock::now();
+	EXPECT_THROW(kept->request_device_info(), std::runtime_error);
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(250)); // before the timeouts (3 x 100ms)
+	lose.join();
+	EXPECT_FALSE(kept->connected());
+
+	joycons.unwatch();
+}
+
+// the same object comes back with its settings, without the initialization
+TEST_F(TransportTest, TestReconnect) {
+	auto before = ScriptedTransport::add_device({ JOYCON_L_BT, L"98:B6:E9:00:00:01", "scripted/0" });
+
+	JoyconVec joycons("");
+	HotplugQueue events;
+	ASSERT_TRUE(joycons.watch(events.source()));
+	ASSERT_EQ(joycons.addDevices(), 0);
+	ASSERT_EQ(joycons.startDevices(), 0);
+	std::shared_ptr<Joycon> jc = joycons.devices().at(0);
+	jc->set_player_lights(P0_KEEP_ON | P3_FLASH);
+	jc->set_IMU_sensitivity(0x01, 0x02, 0x01, 0x00);
+	EXPECT_TRUE(jc->configured_state().has_player_lights);
+
+	auto wait_size = [&joycons](std::size_t size) {
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (joycons.size() != size && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return joycons.size() == size;
+	};
+
+	before->disconnect();
+	ASSERT_TRUE(wait_size(0));
+	EXPECT_EQ(joycons.detached_size(), 1u);
+	EXPECT_FALSE(jc->connected());
+	EXPECT_THROW(jc->set_player_lights(P1_KEEP_ON), std::runtime_error);
+
+	// back at another node
+	auto after = ScriptedTransport::add_device({ JOYCON_L_BT, L"98:B6:E9:00:00:01", "scripted/7" });
+	HotplugEvent added;
+	added.vendor_id = JOYCON_VENDOR;
+	added.product_id = JOYCON_L_BT;
+	added.serial_number = L"98:b6:e9:00:00:01";
+	added.path = "scripted/7";
+	events.push(added);
+	ASSERT_TRUE(wait_size(1));
+	EXPECT_EQ(joycons.devices().at(0), jc);
+	EXPECT_EQ(joycons.detached_size(), 0u);
+	EXPECT_TRUE(jc->connected());
+	EXPECT_EQ(jc->get_path(), "scripted/7");
+
+	const DeviceInitTiming timing = joycons.init_report().back();
+	EXPECT_TRUE(timing.reconnect);
+	EXPECT_TRUE(timing.ok);
+
+	// the settings only: no device info, no SPI reads (a slow answer may be sent again)
+	std::set<byte> subcommands;
+	for (const ByteVector& report : after->written()) {
+		subcommands.insert(report[10]);
+	}
+	EXPECT_EQ(subcommands, std::set<byte>({ 0x03, 0x40, 0x41, 0x48, 0x30 }));
+	EXPECT_EQ(after->written()[0][11], 0x30);
+	EXPECT_EQ(after->written()[2][11], 0x01);
+	EXPECT_EQ(after->written()[2][12], 0x02);
+	EXPECT_EQ(after->written()[4][11], static_cast<byte>(P0_KEEP_ON | P3_FLASH));
+
+	// the consumer keeps reading from the same object
+	after->push_input(standard_report(1));
+	EXPECT_EQ(wait_reports(*jc, 1).size(), 1u);
+	EXPECT_EQ(jc->metrics().reconnects, 1u);
+
+	joycons.unwatch();
+}
+
+// removed before startDevices(), back after it: reopened without a reader, captured by the start
+TEST_F(TransportTest, TestReconnectBeforeStart) {
+	ScriptedTransport::add_device({ JOYCON_L_BT, L"98:B6:E9:00:00:01", "scripted/0" });
+
+	JoyconVec joycons("");
+	HotplugQueue events;
+	ASSERT_TRUE(joycons.watch(events.source()));
+	ASSERT_EQ(joycons.addDevices(), 0);
+	std::shared_ptr<Joycon> jc = joycons.devices().at(0);
+	jc->set_player_lights(P1_KEEP_ON);
+
+	auto wait_size = [&joycons](std::size_t size) {
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (joycons.size() != size && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return joycons.size() == size;
+	};
+
+	HotplugEvent removed;
+	removed.action = HOTPLUG_REMOVE;
+	removed.path = "scripted/0";
+	events.push(removed);
+	ASSERT_TRUE(wait_size(0));
+	EXPECT_EQ(joycons.detached_size(), 1u);
+	EXPECT_EQ(joycons.startDevices(), -1);
+
+	auto after = ScriptedTransport::add_device({ JOYCON_L_BT, L"98:B6:E9:00:00:01", "scripted/7" });
+	HotplugEvent added;
+	added.vendor_id = JOYCON_VENDOR;
+	added.product_id = JOYCON_L_BT;
+	added.serial_number = L"98:b6:e9:00:00:01";
+	added.path = "scripted/7";
+	events.push(added);
+	ASSERT_TRUE(wait_size(1));
+	EXPECT_EQ(joycons.devices().at(0), jc);
+	EXPECT_EQ(joycons.detached_size(), 0u);
+	EXPECT_EQ(jc->get_path(), "scripted/7");
+	EXPECT_TRUE(jc->connected());
+	EXPECT_TRUE(jc->captured());
+	EXPECT_TRUE(joycons.init_report().back().ok);
+
+	std::set<byte> subcommands;
+	for (const ByteVector& report : after->written()) {
+		subcommands.insert(report[10]);
+	}
+	EXPECT_EQ(subcommands.count(0x30), 1u);
+	EXPECT_EQ(subcommands.count(0x10), 0u);
+
+	after->push_input(standard_report(1));
+	EXPECT_EQ(wait_reports(*jc, 1).size(), 1u);
+
+	joycons.unwatch();
+}
+
+// recorded with a Joycon, read back through the replay transport
+TEST_F(TransportTest, TestRecordAndReplay) {
+	auto device = ScriptedTransport::add_device({ JOYCON_L_BT, L"98:B6:E9:00:00:03", "scripted/0" });
+
+	InputBuffer info_reply;
+	{
+		ReportRecorder recorder(LOG, 1 << 16);
+		Joycon jc(JOYCON_L_BT, const_cast<wchar_t*>(L"98:B6:E9:00:00:03"), "scripted/0");
+		jc.set_recorder(&recorder, 5);
+
+		info_reply = jc.send_command(0x01, 0x02, {});
+		jc.capture();
+		for (byte i = 0; i < 20; ++i) {
+			device->push_input(standard_report(i));
+		}
+		EXPECT_EQ(wait_reports(jc, 20).size(), 20u);
+		jc.set_recorder(nullptr, 0);
+	}
+
+	auto session = ReplayTransport::add_device({ JOYCON_L_BT, L"98:B6:E9:00:00:03", "replay/0" }, LOG, 5, REPLAY_MAXIMUM);
+	EXPECT_EQ(session->size(), 21u);	// device info reply + 20 reports
+
+	ReplayTransport transport;
+	ASSERT_TRUE(transport.open(JOYCON_L_BT, nullptr, "replay/0"));
+
+	InputBuffer buff_in;
+
+	// answered with the recorded reply
+	OutputBuffer buff_out;
+	buff_out.set_cmd(0x01);
+	buff_out.set_subcmd(0x02);
+	EXPECT_EQ(transport.write(buff_out.data(), buff_out.size()), static_cast<int>(buff_out.size()));
+	EXPECT_EQ(transport.read_timeout(buff_in.data(), buff_in.size(), 10), 50);
+	EXPECT_EQ(static_cast<ByteVector>(buff_in.view()), static_cast<ByteVector>(info_reply.view()));
+
+	// no stream before capture
+	EXPECT_EQ(transport.read_timeout(buff_in.data(), buff_in.size(), 5), 0);
+
+	transport.set_nonblocking(1);
+	EXPECT_EQ(transport.read(buff_in.data(), buff_in.size()), 50);
+	EXPECT_EQ(buff_in.get_ID(), 0x21);
+	for (byte i = 0; i < 20; ++i) {
+		buff_in.clean();
+		ASSERT_EQ(transport.read(buff_in.data(), buff_in.size()), 50);	// the recorder logs the whole input buffer
+		EXPECT_EQ(buff_in.get_ID(), 0x30);
+		EXPECT_EQ(buff_in.get_timer(), i);
+	}
+	EXPECT_EQ(transport.read(buff_in.data(), buff_in.size()), 0);
+	EXPECT_TRUE(session->finished());
+}
+
+TEST_F(TransportTest, TestReplayOriginalSpeed) {
+	{
+		ReportRecorder recorder(LOG, 4096);
+		for (byte i = 0; i < 4; ++i) {
+			recorder.record(RECORD_INPUT, 0, standard_report(i), 1000000000ull + i * 20000000ull);	// 20ms apart
+		}
+		recorder.record(RECORD_OUTPUT, 0, ByteVector{ 0x10, 0x00 }, 1000000000ull);
+	}
+
+	auto session = ReplayTransport::add_device({ JOYCON_R_BT, L"", "replay/0" }, LOG, 0, REPLAY_ORIGINAL);
+	ASSERT_EQ(session->size(), 4u);
+
+	ReplayTransport transport;
+	ASSERT_TRUE(transport.open(JOYCON_R_BT, L"", ""));
+
+	InputBuffer buff_in;
+	transport.set_nonblocking(1);
+	auto start = std::chrono::steady_clock::now();
+	for (byte i = 0; i < 4; ++i) {
+		ASSERT_EQ(transport.read_timeout(buff_in.data(), buff_in.size(), 1000), 49);
+		EXPECT_EQ(buff_in.get_timer(), i);
+		EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20 * i));
+	}
+
+	// nothing left
+	EXPECT_EQ(transport.read_timeout(buff_in.data(), buff_in.size(), 1), 0);
+}
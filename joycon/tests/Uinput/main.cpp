@@ -0,0 +1,137 @@
+#include <array>
+#include <chrono>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "uinput.h"
+
+namespace {
+
+const uint16_t CENTER[2] = { EvdevMapper::STICK_CENTER, EvdevMapper::STICK_MAX - EvdevMapper::STICK_CENTER };
+
+bool has(const input_event* events, std::size_t count, uint16_t type, uint16_t code, int32_t value) {
+	for (std::size_t i = 0; i < count; ++i) {
+		if (events[i].type == type && events[i].code == code && events[i].value == value) {
+			return true;
+		}
+	}
+	return false;
+}
+
+} // namespace
+
+//a frame without changes is no write at all
+TEST(EvdevMapper, TestUnchanged) {
+	EvdevMapper mapper;
+	std::array<input_event, EvdevMapper::MAX_EVENTS> events;
+	EXPECT_EQ(mapper.map(0, LEFT_BUTTONS | RIGHT_BUTTONS, CENTER, CENTER, events.data()), 0u);
+}
+
+//only the changed keys and axes, the SYN_REPORT last
+TEST(EvdevMapper, TestChanges) {
+	EvdevMapper mapper;
+	std::array<input_event, EvdevMapper::MAX_EVENTS> events;
+
+	const uint16_t left[2] = { 100, 200 };
+	std::size_t count = mapper.map(BUTTON_A | BUTTON_L, LEFT_BUTTONS | RIGHT_BUTTONS, left, CENTER, events.data());
+	ASSERT_EQ(count, 5u);
+	EXPECT_TRUE(has(events.data(), count, EV_KEY, BTN_EAST, 1));
+	EXPECT_TRUE(has(events.data(), count, EV_KEY, BTN_TL, 1));
+	EXPECT_TRUE(has(events.data(), count, EV_ABS, ABS_X, 100));
+	EXPECT_TRUE(has(events.data(), count, EV_ABS, ABS_Y, EvdevMapper::STICK_MAX - 200)); //up is negative in evdev
+	EXPECT_EQ(events[count - 1].type, EV_SYN);
+	EXPECT_EQ(events[count - 1].code, SYN_REPORT);
+
+	count = mapper.map(BUTTON_L, LEFT_BUTTONS | RIGHT_BUTTONS, left, CENTER, events.data());
+	ASSERT_EQ(count, 2u);
+	EXPECT_TRUE(has(events.data(), count, EV_KEY, BTN_EAST, 0));
+
+	EXPECT_EQ(mapper.map(BUTTON_L, LEFT_BUTTONS | RIGHT_BUTTONS, left, CENTER, events.data()), 0u);
+}
+
+//the two sides of a pair update one device without resetting each other
+TEST(EvdevMapper, TestMask) {
+	EvdevMapper mapper;
+	std::array<input_event, EvdevMapper::MAX_EVENTS> events;
+
+	const uint16_t stick[2] = { 0, 0 };
+	std::size_t count = mapper.map(BUTTON_L | BUTTON_A, LEFT_BUTTONS, stick, nullptr, events.data());
+	ASSERT_EQ(count, 4u); //A is no button of the left Joy-Con
+	EXPECT_TRUE(has(events.data(), count, EV_KEY, BTN_TL, 1));
+
+	//the right Joy-Con does not report L, it stays down
+	count = mapper.map(BUTTON_R, RIGHT_BUTTONS, nullptr, stick, events.data());
+	ASSERT_EQ(count, 4u);
+	EXPECT_TRUE(has(events.data(), count, EV_KEY, BTN_TR, 1));
+	EXPECT_TRUE(has(events.data(), count, EV_ABS, ABS_RX, 0));
+	EXPECT_TRUE(has(events.data(), count, EV_ABS, ABS_RY, EvdevMapper::STICK_MAX));
+
+	count = mapper.map(0, LEFT_BUTTONS, stick, nullptr, events.data());
+	ASSERT_EQ(count, 2u);
+	EXPECT_TRUE(has(events.data(), count, EV_KEY, BTN_TL, 0));
+}
+
+//every button has an own key (the charging grip is no button)
+TEST(EvdevMapper, TestAllKeys) {
+	EvdevMapper mapper;
+	std::array<input_event, EvdevMapper::MAX_EVENTS> events;
+
+	uint32_t all = 0;
+	for (const auto& key : EvdevMapper::keys()) {
+		EXPECT_EQ(all & key.first, 0u);
+		all |= key.first;
+	}
+	EXPECT_EQ(all, (LEFT_BUTTONS | RIGHT_BUTTONS) & ~static_cast<uint32_t>(BUTTON_CHARGING_GRIP));
+
+	const uint16_t stick[2] = { 0, 0 };
+	EXPECT_EQ(mapper.map(all, all, stick, stick, events.data()), EvdevMapper::keys().size() + 4 + 1);
+}
+
+//the timestamp with every sample, the axes only when changed
+TEST(EvdevMapper, TestMotion) {
+	EvdevMapper mapper;
+	std::array<input_event, EvdevMapper::MAX_MOTION_EVENTS> events;
+
+	IMUSample sample{};
+	sample.accel[2] = 4096;
+	sample.gyro[0] = -16;
+	std::size_t count = mapper.map_motion(sample, 5000000, events.data());
+	ASSERT_EQ(count, 4u);
+	EXPECT_TRUE(has(events.data(), count, EV_MSC, MSC_TIMESTAMP, 5000));
+	EXPECT_TRUE(has(events.data(), count, EV_ABS, ABS_Z, 4096));
+	EXPECT_TRUE(has(events.data(), count, EV_ABS, ABS_RX, -16));
+	EXPECT_EQ(events[count - 1].type, EV_SYN);
+
+	count = mapper.map_motion(sample, 10000000, events.data());
+	ASSERT_EQ(count, 2u);
+	EXPECT_TRUE(has(events.data(), count, EV_MSC, MSC_TIMESTAMP, 10000));
+}
+
+TEST(UinputGamepad, TestMissingDevice) {
+	EXPECT_THROW(UinputGamepad("test", MOTION_NONE, "/nonexistent/uinput"), std::runtime_error);
+}
+
+//needs write access to /dev/uinput
+TEST(UinputGamepad, TestEmit) {
+	if (access("/dev/uinput", W_OK) != 0) {
+		GTEST_SKIP() << "/dev/uinput is not writable";
+	}
+
+	UinputGamepad gamepad("Joy-Con test", MOTION_RIGHT);
+	StandardReport report{};
+	report.ID = 0x30;
+	report.buttons = BUTTON_A;
+	report.right_stick[0] = 100;
+	report.right_stick[1] = 100;
+	report.IMU_samples = 3;
+	report.timestamp_ns = 100000000;
+
+	gamepad.emit(report, JOYCON_R_BT, std::chrono::steady_clock::now());
+	gamepad.emit(report, JOYCON_R_BT, std::chrono::steady_clock::now()); //no change
+	EXPECT_EQ(gamepad.write_failures(), 0u);
+	EXPECT_EQ(gamepad.latency().count, 1u);
+}
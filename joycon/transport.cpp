@@ -0,0 +1,430 @@
+#include <algorithm>
+#include <cstring>
+
+#include "cache.h"
+#include "transport.h"
+
+namespace {
+
+const unsigned short NINTENDO = 0x057e;
+
+// simulated devices of ScriptedTransport / ReplayTransport
+template <typename T>
+struct Registry {
+	std::mutex mutex;
+	std::vector<std::shared_ptr<T>> devices;
+};
+
+template <typename T>
+Registry<T>& registry() {
+	static Registry<T> reg;
+	return reg;
+}
+
+template <typename T>
+std::vector<TransportDevice> enumerate_registered(unsigned short vendor_id) {
+	Registry<T>& reg = registry<T>();
+	std::lock_guard<std::mutex> lock(reg.mutex);
+
+	std::vector<TransportDevice> res;
+	if (vendor_id == 0 || vendor_id == NINTENDO) {
+		for (const auto& device : reg.devices) {
+			res.push_back(device->info());
+		}
+	}
+	return res;
+}
+
+// by path, else by PID and serial number (as hid_open_path / hid_open)
+template <typename T>
+std::shared_ptr<T> find_registered(JOY_PID PID, const wchar_t* serial_number, const std::string& path) {
+	Registry<T>& reg = registry<T>();
+	std::lock_guard<std::mutex> lock(reg.mutex);
+
+	for (const auto& device : reg.devices) {
+		const TransportDevice& info = device->info();
+		if (path.empty() ? (info.product_id == PID && (serial_number == nullptr || info.serial_number == serial_number)) : info.path == path) {
+			return device;
+		}
+	}
+	return nullptr;
+}
+
+ByteArray<6> mac_of(const TransportDevice& device) {
+	std::string serial(device.serial_number.begin(), device.serial_number.end());
+	ByteArray<6> mac{};
+	parse_mac(serial, mac);
+	return mac;
+}
+
+int copy_report(ByteView report, byte* data, std::size_t length) {
+	std::size_t n = std::min(report.size(), length);
+	std::memcpy(data, report.data(), n);
+	return static_cast<int>(n);
+}
+
+int copy_string(const std::wstring& str, wchar_t* out, std::size_t maxlen) {
+	if (maxlen == 0) {
+		return -1;
+	}
+	std::size_t n = std::min(str.size(), maxlen - 1);
+	std::copy_n(str.begin(), n, out);
+	out[n] = L'\0';
+	return 0;
+}
+
+std::wstring product_name(unsigned short PID) {
+	switch (PID) {
+	case JOYCON_L_BT:
+		return L"Joy-Con (L)";
+	case JOYCON_R_BT:
+		return L"Joy-Con (R)";
+	default:
+		return L"Wireless Gamepad";
+	}
+}
+
+// subcommand 0x10: the reply echoes address (4 byte) and length
+bool is_spi_read(ByteView buff_out) {
+	return buff_out.size() >= 16 && buff_out[0] == 0x01 && buff_out[10] == 0x10;
+}
+
+} // namespace
+
+ByteVector subcommand_reply(ByteView buff_out, JOY_PID PID, const ByteArray<6>& mac, byte timer) {
+
+	const byte subcmd = buff_out.at(10);
+
+	ByteVector reply(50, 0x00);
+	reply[0] = 0x21;
+	reply[1] = timer;
+	reply[2] = 0x8E;	// battery full, Joy-Con
+	reply[12] = 0x80;	// vibrator input report
+	reply[14] = subcmd;
+
+	byte* data = &reply[15];
+	switch (subcmd) {
+	case 0x02:		// device info
+		reply[13] = 0x82;
+		data[0] = 0x03;
+		data[1] = 0x48;
+		data[2] = PID == JOYCON_L_BT ? 0x01 : PID == JOYCON_R_BT ? 0x02 : 0x03;
+		data[3] = 0x02;
+		std::copy(mac.begin(), mac.end(), data + 4);
+		data[10] = 0x01;
+		data[11] = 0x01;	// colors in SPI
+		break;
+	case 0x04:		// trigger buttons elapsed time
+		reply[13] = 0x83;
+		break;
+	case 0x10:		// SPI flash read: address, length, erased flash
+		reply[13] = 0x90;
+		if (is_spi_read(buff_out)) {
+			std::copy(buff_out.begin() + 11, buff_out.begin() + 16, data);
+			std::fill_n(data + 5, std::min<std::size_t>(buff_out[15], 0x1D), 0xFF);
+		}
+		break;
+	case 0x31:		// player lights
+		reply[13] = 0xB0;
+		break;
+	case 0x50:		// regulated voltage
+		reply[13] = 0xD0;
+		break;
+	default:
+		reply[13] = 0x80;
+		break;
+	}
+
+	return reply;
+}
+
+#ifdef JOYCON_TRANSPORT_HID
+
+/* ------ HIDTRANSPORT ------ */
+
+constexpr unsigned short HIDTransport::vendor_id;
+
+std::vector<TransportDevice> HIDTransport::enumerate(unsigned short vendor_id) {
+
+	std::vector<TransportDevice> res;
+
+	hid_device_info* devs = hid_enumerate(vendor_id, 0x0);
+	for (hid_device_info* current = devs; current != nullptr; current = current->next) {
+		res.push_back({ current->product_id, current->serial_number ? current->serial_number : L"", current->path ? current->path : "" });
+	}
+	hid_free_enumeration(devs);
+
+	return res;
+}
+
+#endif
+
+/* ------ SCRIPTEDDEVICE ------ */
+
+ScriptedDevice::ScriptedDevice(const TransportDevice& device) : device(device), mac(mac_of(device)) {
+	responder = [](ByteView buff_out, ScriptedDevice& self) {
+		if (buff_out.size() > 10 && buff_out[0] == 0x01) {
+			self.push_input(subcommand_reply(buff_out, static_cast<JOY_PID>(self.device.product_id), self.mac, self.timer++));
+		}
+	};
+}
+
+void ScriptedDevice::push_input(ByteView report) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		input.emplace_back(report.begin(), report.end());
+	}
+	input_ready.notify_all();
+}
+
+void ScriptedDevice::set_responder(Responder responder) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->responder = std::move(responder);
+}
+
+std::vector<ByteVector> ScriptedDevice::written() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return output;
+}
+
+std::size_t ScriptedDevice::pending() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return input.size();
+}
+
+void ScriptedDevice::disconnect() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		connected = false;
+	}
+	input_ready.notify_all();
+}
+
+bool ScriptedDevice::on_write(ByteView buff_out) {
+	Responder respond;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!connected) {
+			return false;
+		}
+		output.emplace_back(buff_out.begin(), buff_out.end());
+		respond = responder;
+	}
+
+	// unlocked: the responder pushes input
+	if (respond) {
+		respond(buff_out, *this);
+	}
+	return true;
+}
+
+int ScriptedDevice::read(byte* data, std::size_t length, int milliseconds) {
+
+	std::unique_lock<std::mutex> lock(mutex);
+	auto ready = [this]() { return !input.empty() || !connected; };
+	if (milliseconds < 0) {
+		input_ready.wait(lock, ready);
+	} else if (!input_ready.wait_for(lock, std::chrono::milliseconds(milliseconds), ready)) {
+		return 0;
+	}
+	if (!connected) {
+		return -1;
+	}
+
+	int res = copy_report(input.front(), data, length);
+	input.pop_front();
+	return res;
+}
+
+/* ------ SCRIPTEDTRANSPORT ------ */
+
+std::shared_ptr<ScriptedDevice> ScriptedTransport::add_device(const TransportDevice& device) {
+	auto res = std::make_shared<ScriptedDevice>(device);
+
+	Registry<ScriptedDevice>& reg = registry<ScriptedDevice>();
+	std::lock_guard<std::mutex> lock(reg.mutex);
+	reg.devices.push_back(res);
+	return res;
+}
+
+void ScriptedTransport::remove_devices() {
+	Registry<ScriptedDevice>& reg = registry<ScriptedDevice>();
+	std::lock_guard<std::mutex> lock(reg.mutex);
+	reg.devices.clear();
+}
+
+std::vector<TransportDevice> ScriptedTransport::enumerate(unsigned short vendor_id) {
+	return enumerate_registered<ScriptedDevice>(vendor_id);
+}
+
+bool ScriptedTransport::open(JOY_PID PID, const wchar_t* serial_number, const std::string& path) {
+	device = find_registered<ScriptedDevice>(PID, serial_number, path);
+	return device != nullptr;
+}
+
+int ScriptedTransport::write(const byte* data, std::size_t length) {
+	return device->on_write(ByteView(data, length)) ? static_cast<int>(length) : -1;
+}
+
+int ScriptedTransport::get_manufacturer_string(wchar_t* str, std::size_t maxlen) const {
+	return copy_string(L"Nintendo", str, maxlen);
+}
+
+int ScriptedTransport::get_product_string(wchar_t* str, std::size_t maxlen) const {
+	return copy_string(product_name(device->info().product_id), str, maxlen);
+}
+
+int ScriptedTransport::get_serial_number_string(wchar_t* str, std::size_t maxlen) const {
+	return copy_string(device->info().serial_number, str, maxlen);
+}
+
+/* ------ REPLAYSESSION ------ */
+
+ReplaySession::ReplaySession(const TransportDevice& device, const std::string& log, uint16_t recorded_device, REPLAY_SPEED speed)
+	: device(device), mac(mac_of(device)), speed(speed), reader(log) {
+
+	Record record;
+	while (reader.next(record)) {
+		if (record.device != recorded_device || record.direction != RECORD_INPUT || record.data.empty()) {
+			continue;
+		}
+		stream.push_back(record);
+		if (record.data[0] == 0x21 && record.data.size() > 14) {
+			replies.push_back(record);
+		}
+	}
+}
+
+std::size_t ReplaySession::delivered() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return next;
+}
+
+void ReplaySession::on_write(ByteView buff_out) {
+
+	if (buff_out.size() <= 10 || buff_out[0] != 0x01) {
+		return;		// rumble only
+	}
+
+	const byte subcmd = buff_out[10];
+	const std::size_t echo = is_spi_read(buff_out) ? 5 : 0;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto recorded = std::find_if(replies.begin(), replies.end(), [&](const Record& reply) {
+		return reply.data[14] == subcmd && reply.data.size() >= 15 + echo &&
+			std::equal(buff_out.begin() + 11, buff_out.begin() + 11 + echo, reply.data.begin() + 15);
+	});
+
+	if (recorded != replies.end()) {
+		pending_replies.emplace_back(recorded->data.begin(), recorded->data.end());
+	} else {
+		pending_replies.push_back(subcommand_reply(buff_out, static_cast<JOY_PID>(device.product_id), mac, 0));
+	}
+	input_ready.notify_all();
+}
+
+void ReplaySession::start() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!started) {
+		started = true;
+		start_time = std::chrono::steady_clock::now();
+	}
+	input_ready.notify_all();
+}
+
+int ReplaySession::read(byte* data, std::size_t length, int milliseconds) {
+
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(std::max(milliseconds, 0));
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		if (!pending_replies.empty()) {
+			int res = copy_report(pending_replies.front(), data, length);
+			pending_replies.pop_front();
+			return res;
+		}
+
+		// the next recorded report is due
+		Clock::time_point wake = Clock::time_point::max();
+		if (started && next < stream.size()) {
+			wake = start_time;
+			if (speed == REPLAY_ORIGINAL) {
+				wake += std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(stream[next].timestamp_ns - stream[0].timestamp_ns));
+			}
+			if (wake <= Clock::now()) {
+				return copy_report(stream[next++].data, data, length);
+			}
+		}
+
+		if (milliseconds == 0) {
+			return 0;
+		}
+		if (milliseconds > 0) {
+			if (Clock::now() >= deadline) {
+				return 0;
+			}
+			wake = std::min(wake, deadline);
+		}
+
+		if (wake == Clock::time_point::max()) {
+			input_ready.wait(lock);
+		} else {
+			input_ready.wait_until(lock, wake);
+		}
+	}
+}
+
+/* ------ REPLAYTRANSPORT ------ */
+
+std::shared_ptr<ReplaySession> ReplayTransport::add_device(const TransportDevice& device, const std::string& log,
+	uint16_t recorded_device, REPLAY_SPEED speed) {
+
+	auto res = std::make_shared<ReplaySession>(device, log, recorded_device, speed);
+
+	Registry<ReplaySession>& reg = registry<ReplaySession>();
+	std::lock_guard<std::mutex> lock(reg.mutex);
+	reg.devices.push_back(res);
+	return res;
+}
+
+void ReplayTransport::remove_devices() {
+	Registry<ReplaySession>& reg = registry<ReplaySession>();
+	std::lock_guard<std::mutex> lock(reg.mutex);
+	reg.devices.clear();
+}
+
+std::vector<TransportDevice> ReplayTransport::enumerate(unsigned short vendor_id) {
+	return enumerate_registered<ReplaySession>(vendor_id);
+}
+
+bool ReplayTransport::open(JOY_PID PID, const wchar_t* serial_number, const std::string& path) {
+	session = find_registered<ReplaySession>(PID, serial_number, path);
+	return session != nullptr;
+}
+
+int ReplayTransport::write(const byte* data, std::size_t length) {
+	session->on_write(ByteView(data, length));
+	return static_cast<int>(length);
+}
+
+int ReplayTransport::set_nonblocking(int nonblock) {
+	nonblocking = nonblock != 0;
+	if (nonblocking) {
+		session->start();
+	}
+	return 0;
+}
+
+int ReplayTransport::get_manufacturer_string(wchar_t* str, std::size_t maxlen) const {
+	return copy_string(L"Nintendo", str, maxlen);
+}
+
+int ReplayTransport::get_product_string(wchar_t* str, std::size_t maxlen) const {
+	return copy_string(product_name(session->info().product_id), str, maxlen);
+}
+
+int ReplayTransport::get_serial_number_string(wchar_t* str, std::size_t maxlen) const {
+	return copy_string(session->info().serial_number, str, maxlen);
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "recorder.h"
+#include "types.h"
+
+// The transport Joycon reads and writes the reports through, chosen at compile time (no virtual calls):
+//	default						HIDTransport		hidapi, the real devices
+//	JOYCON_TRANSPORT_SCRIPTED	ScriptedTransport	in memory devices, e.g. for tests
+//	JOYCON_TRANSPORT_REPLAY		ReplayTransport		sessions recorded with ReportRecorder
+// Every transport has the same (hidapi like) interface:
+//	static int init(), exit()
+//	static std::vector<TransportDevice> enumerate(unsigned short vendor_id)
+//	bool open(JOY_PID, const wchar_t* serial_number, const std::string& path), void close()
+//	int write(const byte*, size_t), read(byte*, size_t), read_timeout(byte*, size_t, int ms), set_nonblocking(int)
+//	int get_manufacturer_string(wchar_t*, size_t), get_product_string(...), get_serial_number_string(...)
+// The int functions return -1 on error, read 0 if there is no report (yet).
+#if !defined(JOYCON_TRANSPORT_SCRIPTED) && !defined(JOYCON_TRANSPORT_REPLAY)
+#define JOYCON_TRANSPORT_HID
+#endif
+
+// epoll reactors read the hidraw nodes directly, only possible with real devices
+#if defined(__linux__) && defined(JOYCON_TRANSPORT_HID)
+#define JOYCON_HIDRAW_REACTOR
+#endif
+
+#ifdef JOYCON_TRANSPORT_HID
+#ifdef _WIN32
+#include "hidapi.h"
+#elif __linux__
+#include <hidapi/hidapi.h>
+#endif
+#endif
+
+struct TransportDevice {
+	unsigned short product_id;
+	std::wstring serial_number;
+	std::string path;
+};
+
+// 0x21 reply of a device to the subcommand of buff_out (cmd 0x01): ACK, the echo of SPI reads (with erased flash as data)
+// and a device info of mac. Lets simulated devices pass the initialization of Joycon.
+ByteVector subcommand_reply(ByteView buff_out, JOY_PID PID, const ByteArray<6>& mac, byte timer);
+
+/* ------ HID ------ */
+
+#ifdef JOYCON_TRANSPORT_HID
+class HIDTransport {
+public:
+	HIDTransport() = default;
+	HIDTransport(const HIDTransport&) = delete;
+	HIDTransport& operator=(const HIDTransport&) = delete;
+	~HIDTransport() { this->close(); }
+
+	static int init() { return hid_init(); }
+	static int exit() { return hid_exit(); }
+	static std::vector<TransportDevice> enumerate(unsigned short vendor_id);
+
+	bool open(JOY_PID PID, const wchar_t* serial_number, const std::string& path) {
+		handle = path.empty() ? hid_open(vendor_id, PID, serial_number) : hid_open_path(path.c_str());
+		return handle != nullptr;
+	}
+	void close() {
+		if (handle != nullptr) {
+			hid_close(handle);
+			handle = nullptr;
+		}
+	}
+
+	int write(const byte* data, std::size_t length) { return hid_write(handle, data, length); }
+	int read(byte* data, std::size_t length) { return hid_read(handle, data, length); }
+	int read_timeout(byte* data, std::size_t length, int milliseconds) { return hid_read_timeout(handle, data, length, milliseconds); }
+	int set_nonblocking(int nonblock) { return hid_set_nonblocking(handle, nonblock); }
+
+	int get_manufacturer_string(wchar_t* str, std::size_t maxlen) const { return hid_get_manufacturer_string(handle, str, maxlen); }
+	int get_product_string(wchar_t* str, std::size_t maxlen) const { return hid_get_product_string(handle, str, maxlen); }
+	int get_serial_number_string(wchar_t* str, std::size_t maxlen) const { return hid_get_serial_number_string(handle, str, maxlen); }
+
+private:
+	static constexpr unsigned short vendor_id = 0x057e;
+
+	hid_device* handle = nullptr;
+};
+#endif
+
+/* ------ SCRIPTED ------ */
+
+// In memory device. The test queues input reports, the responder sees every written report (and may queue the answer).
+// Thread safe.
+class ScriptedDevice {
+public:
+	using Responder = std::function<void(ByteView buff_out, ScriptedDevice& device)>;
+
+	// The default responder answers every subcommand with subcommand_reply().
+	explicit ScriptedDevice(const TransportDevice& device);
+
+	const TransportDevice& info() const { return device; }
+
+	void push_input(ByteView report);
+	void set_responder(Responder responder);
+
+	// copy of all reports written so far
+	std::vector<ByteVector> written() const;
+
+	// input reports not read yet
+	std::size_t pending() const;
+
+	// as if the controller was switched off: reads (also blocked ones) and writes fail from now on
+	void disconnect();
+
+private:
+	friend class ScriptedTransport;
+
+	bool on_write(ByteView buff_out);
+	int read(byte* data, std::size_t length, int milliseconds);
+
+	TransportDevice device;
+	ByteArray<6> mac{};
+	byte timer = 0;
+	bool connected = true;
+
+	mutable std::mutex mutex;
+	std::condition_variable input_ready;
+	std::deque<ByteVector> input;
+	std::vector<ByteVector> output;
+	Responder responder;
+};
+
+class ScriptedTransport {
+public:
+	// Registers a device for enumerate() and open(). The serial number should be the MAC (as of a Bluetooth controller).
+	static std::shared_ptr<ScriptedDevice> add_device(const TransportDevice& device);
+	static void remove_devices();
+
+	static int init() { return 0; }
+	static int exit() { return 0; }
+	static std::vector<TransportDevice> enumerate(unsigned short vendor_id);
+
+	bool open(JOY_PID PID, const wchar_t* serial_number, const std::string& path);
+	void close() { device.reset(); }
+
+	int write(const byte* data, std::size_t length);
+	int read(byte* data, std::size_t length) { return device->read(data, length, nonblocking ? 0 : -1); }
+	int read_timeout(byte* data, std::size_t length, int milliseconds) { return device->read(data, length, milliseconds); }
+	int set_nonblocking(int nonblock) { nonblocking = nonblock != 0; return 0; }
+
+	int get_manufacturer_string(wchar_t* str, std::size_t maxlen) const;
+	int get_product_string(wchar_t* str, std::size_t maxlen) const;
+	int get_serial_number_string(wchar_t* str, std::size_t maxlen) const;
+
+private:
+	std::shared_ptr<ScriptedDevice> device;
+	bool nonblocking = false;
+};
+
+/* ------ REPLAY ------ */
+
+enum REPLAY_SPEED {
+	REPLAY_ORIGINAL,	// the reports are due at their recorded time
+	REPLAY_MAXIMUM		// as fast as they are read
+};
+
+// The input reports of one recorded device. The stream starts with set_nonblocking() (that is Joycon::capture()),
+// before that only subcommands are answered: with the first recorded reply to the same subcommand (and SPI address),
+// else with subcommand_reply(). Thread safe.
+class ReplaySession {
+public:
+	// Throws std::runtime_error if log is no report log.
+	ReplaySession(const TransportDevice& device, const std::string& log, uint16_t recorded_device, REPLAY_SPEED speed);
+
+	const TransportDevice& info() const { return device; }
+
+	std::size_t size() const { return stream.size(); }			// recorded input reports
+	std::size_t delivered() const;								// ... read so far
+	bool finished() const { return this->delivered() == this->size(); }
+
+private:
+	friend class ReplayTransport;
+
+	void on_write(ByteView buff_out);
+	void start();
+	int read(byte* data, std::size_t length, int milliseconds);
+
+	TransportDevice device;
+	ByteArray<6> mac{};
+	REPLAY_SPEED speed;
+
+	RecordReader reader;
+	std::vector<Record> stream;
+	std::vector<Record> replies;	// recorded 0x21 reports
+
+	mutable std::mutex mutex;
+	std::condition_variable input_ready;
+	std::deque<ByteVector> pending_replies;
+	std::size_t next = 0;
+	bool started = false;
+	std::chrono::steady_clock::time_point start_time;
+};
+
+class ReplayTransport {
+public:
+	// Registers the input of recorded_device in log as device for enumerate() and open().
+	static std::shared_ptr<ReplaySession> add_device(const TransportDevice& device, const std::string& log,
+		uint16_t recorded_device = 0, REPLAY_SPEED speed = REPLAY_ORIGINAL);
+	static void remove_devices();
+
+	static int init() { return 0; }
+	static int exit() { return 0; }
+	static std::vector<TransportDevice> enumerate(unsigned short vendor_id);
+
+	bool open(JOY_PID PID, const wchar_t* serial_number, const std::string& path);
+	void close() { session.reset(); }
+
+	int write(const byte* data, std::size_t length);
+	int read(byte* data, std::size_t length) { return session->read(data, length, nonblocking ? 0 : -1); }
+	int read_timeout(byte* data, std::size_t length, int milliseconds) { return session->read(data, length, milliseconds); }
+	int set_nonblocking(int nonblock);
+
+	int get_manufacturer_string(wchar_t* str, std::size_t maxlen) const;
+	int get_product_string(wchar_t* str, std::size_t maxlen) const;
+	int get_serial_number_string(wchar_t* str, std::size_t maxlen) const;
+
+private:
+	std::shared_ptr<ReplaySession> session;
+	bool nonblocking = false;
+};
+
+/* ------ SELECTION ------ */
+
+#if defined(JOYCON_TRANSPORT_SCRIPTED)
+using Transport = ScriptedTransport;
+#elif defined(JOYCON_TRANSPORT_REPLAY)
+using Transport = ReplayTransport;
+#else
+using Transport = HIDTransport;
+#endif
@@ -3,7 +3,9 @@
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <initializer_list>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -16,6 +18,53 @@ using ByteVector = std::vector<byte>;
 template <std::size_t N>
 using ByteArray = std::array<byte, N>;
 
+// non-owning, read-only view on contiguous bytes. The viewed memory must outlive the view!
+class ByteView {
+public:
+	using value_type = byte;
+	using iterator = const byte*;
+	using const_iterator = const byte*;
+
+	constexpr ByteView() : ptr(nullptr), len(0) {}
+	constexpr ByteView(const byte* data, std::size_t size) : ptr(data), len(size) {}
+	ByteView(const ByteVector& vec) : ptr(vec.data()), len(vec.size()) {}
+
+	template <std::size_t N>
+	ByteView(const ByteArray<N>& arr) : ptr(arr.data()), len(N) {}
+
+	// the list only lives until the end of the full expression, e.g. send_command(0x01, 0x40, { 0x01 })
+	ByteView(std::initializer_list<byte> list) : ByteView(list.begin(), list.size()) {}
+
+	const byte* data() const { return ptr; }
+	std::size_t size() const { return len; }
+	bool empty() const { return len == 0; }
+
+	const_iterator begin() const { return ptr; }
+	const_iterator end() const { return ptr + len; }
+
+	const byte& operator[](std::size_t idx) const { return ptr[idx]; }
+	const byte& at(std::size_t idx) const {
+		if (!(idx < len)) {
+			throw std::out_of_range("Index is outside the view.");
+		}
+		return ptr[idx];
+	}
+
+	ByteView sub(std::size_t offset, std::size_t length) const {
+		if (offset > len || length > len - offset) {
+			throw std::out_of_range("'offset' or 'offset + length' are outside the view.");
+		}
+		return ByteView(ptr + offset, length);
+	}
+
+	// copies the viewed bytes
+	explicit operator ByteVector() const { return ByteVector(begin(), end()); }
+
+private:
+	const byte* ptr;
+	std::size_t len;
+};
+
 /* TYPE TRAITS */
 
 template <typename T>
@@ -46,7 +95,7 @@ struct is_valid_container<ByteArray<N>> {
 /* HELPER FUNCTIONS */
 
 template <typename const_iterator>
-typename std::enable_if<std::is_same<typename const_iterator::value_type, byte>::value, unsigned long int>::type
+typename std::enable_if<std::is_same<typename std::iterator_traits<const_iterator>::value_type, byte>::value, unsigned long int>::type
 to_int(const_iterator it_begin, const_iterator it_end, bool bigEndian = true) {
 
 	unsigned long int res{ 0 };
@@ -89,35 +138,65 @@ to_int(const T& container, std::size_t start, std::size_t length, bool bigEndian
 	return to_int(container.begin() + start, container.begin() + start + length, bigEndian);
 }
 
-template <typename const_iterator>
-typename std::enable_if<std::is_same<typename const_iterator::value_type, byte>::value, std::string>::type
-to_hex_string(const_iterator it_begin, const_iterator it_end, std::string prefix = "0x", std::string delimiter = "") {
+// "00" - "ff": the two (lower case) hex digits of every byte
+struct HexTable {
+	char digits[512];
 
-	int length = std::distance(it_begin, it_end);
-	if (length < 0) {
-		throw std::underflow_error("it_begin > it_end");
+	constexpr HexTable() : digits() {
+		for (int i = 0; i < 256; ++i) {
+			digits[2 * i] = "0123456789abcdef"[i >> 4];
+			digits[2 * i + 1] = "0123456789abcdef"[i & 0xF];
+		}
 	}
+};
 
-	std::ostringstream sstream;
-	if (it_begin != it_end) {
-		sstream << prefix;
-	}
+inline const char* hex_digits() {
+	static constexpr HexTable table;
+	return table.digits;
+}
+
+// chars hex_encode() writes for length bytes
+constexpr std::size_t hex_length(std::size_t length, std::size_t delimiter_length = 0) {
+	return length == 0 ? 0 : 2 * length + delimiter_length * (length - 1);
+}
 
-	std::string del = "";
+// Table driven, never allocates: writes the bytes as hex with delimiter between them to out (not 0 terminated).
+// out needs room for hex_length() chars. Returns the end of the written chars.
+template <typename const_iterator>
+char* hex_encode(const_iterator it_begin, const_iterator it_end, char* out, const char* delimiter = "", std::size_t delimiter_length = 0) {
 
+	const char* digits = hex_digits();
 	for (const_iterator it = it_begin; it != it_end; ++it) {
+		if (it != it_begin) {
+			out = std::copy_n(delimiter, delimiter_length, out);
+		}
+		const char* pair = digits + 2 * static_cast<byte>(*it);
+		out[0] = pair[0];
+		out[1] = pair[1];
+		out += 2;
+	}
+	return out;
+}
 
-		const byte& current_byte = *it;
-
-		std::string fill = "";
-		if (current_byte <= 0x0F) { fill = "0"; }
+template <typename const_iterator>
+typename std::enable_if<std::is_same<typename std::iterator_traits<const_iterator>::value_type, byte>::value, std::string>::type
+to_hex_string(const_iterator it_begin, const_iterator it_end, std::string prefix = "0x", std::string delimiter = "") {
 
-		sstream << del << fill << std::hex << static_cast<unsigned int>(current_byte);
+	int length = std::distance(it_begin, it_end);
+	if (length < 0) {
+		throw std::underflow_error("it_begin > it_end");
+	}
 
-		del = delimiter;
+	if (length == 0) {
+		return "";
 	}
 
-	return sstream.str();
+	// one allocation, the digits are written in place
+	std::string res(prefix.size() + hex_length(length, delimiter.size()), '\0');
+	std::copy(prefix.begin(), prefix.end(), res.begin());
+	hex_encode(it_begin, it_end, &res[prefix.size()], delimiter.data(), delimiter.size());
+
+	return res;
 }
 
 template <typename T>
@@ -136,7 +215,7 @@ to_hex_string(const T& container, std::size_t start, std::size_t length, std::st
 }
 
 template <typename iterator>
-typename std::enable_if<std::is_same<typename iterator::value_type, byte>::value, void>::type
+typename std::enable_if<std::is_same<typename std::iterator_traits<iterator>::value_type, byte>::value, void>::type
 to_byte_container(unsigned long int data, iterator it_begin, iterator it_end, bool bigEndian = true) {
 	int length = std::distance(it_begin, it_end);
 	if (length < 0) {
@@ -152,7 +231,8 @@ to_byte_container(unsigned long int data, iterator it_begin, iterator it_end, bo
 		throw std::runtime_error("data did not completely fit into container!");
 	}
 
-	if (!bigEndian) {
+	// filled from the least significant byte on (little endian)
+	if (bigEndian) {
 		std::reverse(it_begin, it_end);
 	}
 }
@@ -209,6 +289,21 @@ enum POWER {
 	FULL
 };
 
+// battery_level: high nibble of the battery/connection byte (8=full, 6=medium, 4=low, 2=critical, 0=empty. +1 if charging)
+inline POWER to_power(byte battery_level) {
+	if (battery_level == 0) {
+		return POWER::EMPTY;
+	} else if (battery_level <= 2) {
+		return POWER::CRITICAL;
+	} else if (battery_level <= 4) {
+		return POWER::LOW;
+	} else if (battery_level <= 6) {
+		return POWER::MEDIUM;
+	} else {
+		return POWER::FULL;
+	}
+}
+
 struct JoyconDeviceInfo {
 	std::string firmwareVersion;	// Firmware Version. Latest is 3.86 (from 4.0.0 and up).
 	unsigned int joyconType;		// 1=Left Joy-Con, 2=Right Joy-Con, 3=Pro Controller
@@ -0,0 +1,265 @@
+#ifdef __linux__
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "uinput.h"
+
+constexpr std::size_t EvdevMapper::MAX_EVENTS;
+constexpr int32_t EvdevMapper::STICK_MAX;
+constexpr int32_t EvdevMapper::STICK_CENTER;
+constexpr std::size_t EvdevMapper::MAX_MOTION_EVENTS;
+
+static_assert(3 * EvdevMapper::MAX_MOTION_EVENTS <= EvdevMapper::MAX_EVENTS, "The motion events of a report must fit.");
+
+namespace {
+
+const uint16_t STICK_AXES[4] = { ABS_X, ABS_Y, ABS_RX, ABS_RY };
+const uint16_t MOTION_AXES[6] = { ABS_X, ABS_Y, ABS_Z, ABS_RX, ABS_RY, ABS_RZ };
+
+// as the kernel driver: nominal +-8g and +-2000dps
+const int32_t ACCEL_RESOLUTION = 4096;	// per g
+const int32_t GYRO_RESOLUTION = 16;		// per degree/s
+
+// the 3 samples of a report are 5ms apart
+const uint64_t SAMPLE_PERIOD_NS = 5000000;
+
+input_event event(uint16_t type, uint16_t code, int32_t value) {
+	input_event res;
+	std::memset(&res, 0, sizeof(res));	// the kernel sets the time
+	res.type = type;
+	res.code = code;
+	res.value = value;
+	return res;
+}
+
+void control(int fd, unsigned long request, unsigned long value, const char* name) {
+	if (ioctl(fd, request, value) == -1) {
+		throw std::runtime_error(std::string(name) + " failed: " + std::strerror(errno));
+	}
+}
+
+void setup_axis(int fd, uint16_t code, int32_t min, int32_t max, int32_t fuzz, int32_t flat, int32_t resolution) {
+	control(fd, UI_SET_ABSBIT, code, "UI_SET_ABSBIT");
+
+	uinput_abs_setup setup;
+	std::memset(&setup, 0, sizeof(setup));
+	setup.code = code;
+	setup.absinfo.minimum = min;
+	setup.absinfo.maximum = max;
+	setup.absinfo.fuzz = fuzz;
+	setup.absinfo.flat = flat;
+	setup.absinfo.resolution = resolution;
+	if (ioctl(fd, UI_ABS_SETUP, &setup) == -1) {
+		throw std::runtime_error(std::string("UI_ABS_SETUP failed: ") + std::strerror(errno));
+	}
+}
+
+void create_device(int fd, const std::string& name) {
+	uinput_setup setup;
+	std::memset(&setup, 0, sizeof(setup));
+	setup.id.bustype = BUS_VIRTUAL;
+	setup.id.vendor = 0x057e;
+	setup.id.product = 0x2008;	// as a pair of Joy-Cons
+	std::strncpy(setup.name, name.c_str(), UINPUT_MAX_NAME_SIZE - 1);
+
+	if (ioctl(fd, UI_DEV_SETUP, &setup) == -1) {
+		throw std::runtime_error(std::string("UI_DEV_SETUP failed: ") + std::strerror(errno));
+	}
+	control(fd, UI_DEV_CREATE, 0, "UI_DEV_CREATE");
+}
+
+int open_uinput(const std::string& path) {
+	int fd = open(path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fd == -1) {
+		throw std::runtime_error("Could not open " + path + ": " + std::strerror(errno));
+	}
+	return fd;
+}
+
+void destroy(int fd) {
+	if (fd != -1) {
+		ioctl(fd, UI_DEV_DESTROY);
+		close(fd);
+	}
+}
+
+} // namespace
+
+/* ------ MAPPER ------ */
+
+const std::array<std::pair<uint32_t, uint16_t>, 22>& EvdevMapper::keys() {
+	static const std::array<std::pair<uint32_t, uint16_t>, 22> KEYS{ {
+		{ BUTTON_Y, BTN_WEST }, { BUTTON_X, BTN_NORTH }, { BUTTON_B, BTN_SOUTH }, { BUTTON_A, BTN_EAST },
+		{ BUTTON_RIGHT_SR, BTN_TRIGGER_HAPPY3 }, { BUTTON_RIGHT_SL, BTN_TRIGGER_HAPPY4 }, { BUTTON_R, BTN_TR }, { BUTTON_ZR, BTN_TR2 },
+		{ BUTTON_MINUS, BTN_SELECT }, { BUTTON_PLUS, BTN_START }, { BUTTON_RIGHT_STICK, BTN_THUMBR }, { BUTTON_LEFT_STICK, BTN_THUMBL },
+		{ BUTTON_HOME, BTN_MODE }, { BUTTON_CAPTURE, BTN_Z },
+		{ BUTTON_DOWN, BTN_DPAD_DOWN }, { BUTTON_UP, BTN_DPAD_UP }, { BUTTON_RIGHT, BTN_DPAD_RIGHT }, { BUTTON_LEFT, BTN_DPAD_LEFT },
+		{ BUTTON_LEFT_SR, BTN_TRIGGER_HAPPY1 }, { BUTTON_LEFT_SL, BTN_TRIGGER_HAPPY2 }, { BUTTON_L, BTN_TL }, { BUTTON_ZL, BTN_TL2 }
+	} };
+	return KEYS;
+}
+
+std::size_t EvdevMapper::map(uint32_t buttons, uint32_t mask, const uint16_t* left_stick, const uint16_t* right_stick, input_event* out) {
+	std::size_t count = 0;
+
+	const uint32_t next = (key_state & ~mask) | (buttons & mask);
+	const uint32_t changed = next ^ key_state;
+	key_state = next;
+	if (changed != 0) {
+		for (const auto& key : keys()) {
+			if (changed & key.first) {
+				out[count++] = event(EV_KEY, key.second, (next & key.first) ? 1 : 0);
+			}
+		}
+	}
+
+	int32_t values[4];
+	std::copy(axes.begin(), axes.end(), values);
+	if (left_stick != nullptr) {
+		values[0] = left_stick[0];
+		values[1] = STICK_MAX - left_stick[1];
+	}
+	if (right_stick != nullptr) {
+		values[2] = right_stick[0];
+		values[3] = STICK_MAX - right_stick[1];
+	}
+	for (std::size_t i = 0; i < 4; ++i) {
+		if (values[i] != axes[i]) {
+			axes[i] = values[i];
+			out[count++] = event(EV_ABS, STICK_AXES[i], values[i]);
+		}
+	}
+
+	if (count == 0) {
+		return 0;
+	}
+	out[count++] = event(EV_SYN, SYN_REPORT, 0);
+	return count;
+}
+
+std::size_t EvdevMapper::map_motion(const IMUSample& sample, uint64_t timestamp_ns, input_event* out) {
+	std::size_t count = 0;
+	out[count++] = event(EV_MSC, MSC_TIMESTAMP, static_cast<int32_t>(static_cast<uint32_t>(timestamp_ns / 1000)));
+
+	const int32_t values[6] = { sample.accel[0], sample.accel[1], sample.accel[2], sample.gyro[0], sample.gyro[1], sample.gyro[2] };
+	for (std::size_t i = 0; i < 6; ++i) {
+		if (values[i] != motion[i]) {
+			motion[i] = values[i];
+			out[count++] = event(EV_ABS, MOTION_AXES[i], values[i]);
+		}
+	}
+
+	out[count++] = event(EV_SYN, SYN_REPORT, 0);
+	return count;
+}
+
+/* ------ GAMEPAD ------ */
+
+UinputGamepad::UinputGamepad(const std::string& name, MOTION_SOURCE motion, const std::string& path) : motion_source(motion) {
+	try {
+		gamepad_fd = open_uinput(path);
+		control(gamepad_fd, UI_SET_EVBIT, EV_KEY, "UI_SET_EVBIT");
+		for (const auto& key : EvdevMapper::keys()) {
+			control(gamepad_fd, UI_SET_KEYBIT, key.second, "UI_SET_KEYBIT");
+		}
+		control(gamepad_fd, UI_SET_EVBIT, EV_ABS, "UI_SET_EVBIT");
+		for (uint16_t axis : STICK_AXES) {
+			setup_axis(gamepad_fd, axis, 0, EvdevMapper::STICK_MAX, 16, 128, 0);
+		}
+		create_device(gamepad_fd, name);
+
+		// the axes start centered, as the mapper assumes
+		input_event center[5];
+		for (std::size_t i = 0; i < 4; ++i) {
+			center[i] = event(EV_ABS, STICK_AXES[i], EvdevMapper::STICK_CENTER);
+		}
+		center[4] = event(EV_SYN, SYN_REPORT, 0);
+		this->write_events(gamepad_fd, center, 5);
+
+		if (motion != MOTION_NONE) {
+			motion_fd = open_uinput(path);
+			control(motion_fd, UI_SET_PROPBIT, INPUT_PROP_ACCELEROMETER, "UI_SET_PROPBIT");
+			control(motion_fd, UI_SET_EVBIT, EV_ABS, "UI_SET_EVBIT");
+			for (std::size_t i = 0; i < 6; ++i) {
+				setup_axis(motion_fd, MOTION_AXES[i], -32768, 32767, 0, 0, i < 3 ? ACCEL_RESOLUTION : GYRO_RESOLUTION);
+			}
+			control(motion_fd, UI_SET_EVBIT, EV_MSC, "UI_SET_EVBIT");
+			control(motion_fd, UI_SET_MSCBIT, MSC_TIMESTAMP, "UI_SET_MSCBIT");
+			create_device(motion_fd, name + " IMU");
+		}
+	} catch (...) {
+		destroy(motion_fd);
+		destroy(gamepad_fd);
+		throw;
+	}
+}
+
+UinputGamepad::~UinputGamepad() {
+	destroy(motion_fd);
+	destroy(gamepad_fd);
+}
+
+void UinputGamepad::emit(const StandardReport& report, JOY_PID PID, std::chrono::steady_clock::time_point arrival) {
+	const bool left = PID == JOYCON_L_BT;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	const std::size_t count = mapper.map(report.buttons, left ? LEFT_BUTTONS : RIGHT_BUTTONS,
+		left ? report.left_stick : nullptr, left ? nullptr : report.right_stick, events.data());
+	if (count > 0) {
+		this->write_events(gamepad_fd, events.data(), count);
+		latency_histogram.record(std::chrono::steady_clock::now() - arrival);
+	}
+
+	if (motion_source == (left ? MOTION_LEFT : MOTION_RIGHT)) {
+		this->emit_motion(report.IMU, report.IMU_samples, report.timestamp_ns);
+	}
+}
+
+void UinputGamepad::emit(const PairedState& state, std::chrono::steady_clock::time_point arrival) {
+	std::lock_guard<std::mutex> lock(mutex);
+	const std::size_t count = mapper.map(state.buttons, LEFT_BUTTONS | RIGHT_BUTTONS, state.left.stick, state.right.stick, events.data());
+	if (count > 0) {
+		this->write_events(gamepad_fd, events.data(), count);
+		latency_histogram.record(std::chrono::steady_clock::now() - arrival);
+	}
+
+	if (motion_source != MOTION_NONE) {
+		const PairedSide& side = motion_source == MOTION_LEFT ? state.left : state.right;
+		this->emit_motion(side.IMU, side.IMU_samples, side.timestamp_ns);
+	}
+}
+
+// mutex must be held
+void UinputGamepad::emit_motion(const IMUSample* samples, byte count, uint64_t timestamp_ns) {
+	std::size_t size = 0;
+	for (byte i = 0; i < count; ++i) {
+		// timestamp_ns belongs to the last sample
+		const uint64_t sample_ns = timestamp_ns - (count - 1 - i) * SAMPLE_PERIOD_NS;
+		size += motion_mapper.map_motion(samples[i], sample_ns, events.data() + size);
+	}
+	if (size > 0) {
+		this->write_events(motion_fd, events.data(), size);
+	}
+}
+
+void UinputGamepad::write_events(int fd, const input_event* data, std::size_t count) {
+	const std::size_t size = count * sizeof(input_event);
+	ssize_t res;
+	do {
+		res = write(fd, data, size);
+	} while (res == -1 && errno == EINTR);
+
+	if (res != static_cast<ssize_t>(size)) {
+		failures.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+#endif
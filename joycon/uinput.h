@@ -0,0 +1,98 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include <linux/input.h>
+
+#include "metrics.h"
+#include "pairing.h"
+#include "report.h"
+#include "types.h"
+
+// Maps controller states to evdev events, only the keys and axes that changed since the last state.
+// Keys: A B X Y -> BTN_EAST SOUTH NORTH WEST, L ZL R ZR -> BTN_TL TL2 TR TR2, - + -> BTN_SELECT START, HOME -> BTN_MODE,
+// capture -> BTN_Z, stick clicks -> BTN_THUMBL THUMBR, D-pad -> BTN_DPAD_*, SL SR -> BTN_TRIGGER_HAPPY1 - 4.
+// Axes: left stick ABS_X ABS_Y, right stick ABS_RX ABS_RY, raw 12 bit (0 - 4095), y pointing down as evdev expects.
+class EvdevMapper {
+public:
+	// a whole frame: every key, every stick axis and the SYN_REPORT
+	static constexpr std::size_t MAX_EVENTS = 32;
+	static constexpr int32_t STICK_MAX = 0xFFF;
+	static constexpr int32_t STICK_CENTER = 0x800;
+
+	// BUTTONS bit -> key code
+	static const std::array<std::pair<uint32_t, uint16_t>, 22>& keys();
+
+	// The events of the changed keys and axes plus one SYN_REPORT to out (room for MAX_EVENTS). Returns the amount,
+	// 0 if nothing changed. Only the buttons in mask and the sticks that are not nullptr are taken from the arguments,
+	// so the Joy-Cons of a pair can update one device report by report.
+	std::size_t map(uint32_t buttons, uint32_t mask, const uint16_t* left_stick, const uint16_t* right_stick, input_event* out);
+
+	// MSC_TIMESTAMP (us), the changed accel (ABS_X, Y, Z) and gyro (ABS_RX, RY, RZ) axes of one sample and SYN_REPORT
+	// (room for MAX_MOTION_EVENTS). Returns the amount.
+	static constexpr std::size_t MAX_MOTION_EVENTS = 8;
+	std::size_t map_motion(const IMUSample& sample, uint64_t timestamp_ns, input_event* out);
+
+private:
+	uint32_t key_state = 0;
+	std::array<int32_t, 4> axes{ { STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER } };
+	std::array<int32_t, 6> motion{};
+};
+
+enum MOTION_SOURCE {
+	MOTION_NONE,
+	MOTION_LEFT,	// IMU of the left Joy-Con
+	MOTION_RIGHT
+};
+
+// Virtual gamepad through /dev/uinput (needs write access to it), fed from the reader of a Joycon (Joycon::set_gamepad())
+// or by a JoyconPair consumer. Every report is one write() of the changed events and a single SYN_REPORT.
+// With a motion source, the IMU samples of that Joy-Con go to a second device (INPUT_PROP_ACCELEROMETER, as the kernel driver
+// of the Joy-Con does), all samples of a report in one write.
+class UinputGamepad {
+public:
+	// Throws std::runtime_error if the devices can not be created.
+	explicit UinputGamepad(const std::string& name = "Joy-Con (virtual)", MOTION_SOURCE motion = MOTION_NONE,
+		const std::string& path = "/dev/uinput");
+	UinputGamepad(const UinputGamepad&) = delete;
+	UinputGamepad& operator=(const UinputGamepad&) = delete;
+	~UinputGamepad();
+
+	// The buttons and the stick of PID only: the two Joy-Cons of a pair may share one gamepad.
+	// arrival: when the read of the report returned, the start of the measured latency
+	void emit(const StandardReport& report, JOY_PID PID, std::chrono::steady_clock::time_point arrival);
+	void emit(const PairedState& state, std::chrono::steady_clock::time_point arrival);
+
+	// us from the arrival of a report to the return of its write(). Reports without change are not counted.
+	HistogramSnapshot latency() const { return latency_histogram.snapshot(); }
+
+	// writes that failed (e.g. EAGAIN), the events of the report are lost
+	std::size_t write_failures() const { return failures.load(std::memory_order_relaxed); }
+
+private:
+	void write_events(int fd, const input_event* events, std::size_t count);
+	void emit_motion(const IMUSample* samples, byte count, uint64_t timestamp_ns);
+
+	MOTION_SOURCE motion_source;
+	int gamepad_fd = -1;
+	int motion_fd = -1;
+
+	// the devices of a pair are read by different threads
+	std::mutex mutex;
+	EvdevMapper mapper;
+	EvdevMapper motion_mapper;
+	std::array<input_event, EvdevMapper::MAX_EVENTS> events;	// also fits the 3 motion samples of a report
+
+	LatencyHistogram latency_histogram;
+	std::atomic<std::size_t> failures{ 0 };
+};
+
+#endif